@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Lock free single producer / single consumer ring buffer for audio samples.
+// The emulator thread pushes samples and the SDL audio callback pops them.
+template <typename T>
+class AudioRingBuffer
+{
+private:
+  T *buffer;
+  size_t capacity;
+  size_t mask;
+  // only written by the producer
+  std::atomic<size_t> head{0};
+  // only written by the consumer
+  std::atomic<size_t> tail{0};
+  // what we play if we run dry
+  T lastSample = {};
+  std::atomic<uint32_t> underruns{0};
+  std::atomic<uint32_t> overruns{0};
+
+public:
+  // capacity must be a power of two
+  AudioRingBuffer(size_t capacity) : capacity(capacity), mask(capacity - 1)
+  {
+    buffer = new T[capacity]();
+  }
+  ~AudioRingBuffer()
+  {
+    delete[] buffer;
+  }
+  // number of samples waiting to be played
+  size_t size() const
+  {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  size_t getCapacity() const
+  {
+    return capacity;
+  }
+  // called from the producer - returns the number of samples that fitted, anything else is dropped
+  size_t push(const T *samples, size_t count)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t space = capacity - (h - tail.load(std::memory_order_acquire));
+    if (count > space)
+    {
+      overruns++;
+      count = space;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+      buffer[(h + i) & mask] = samples[i];
+    }
+    head.store(h + count, std::memory_order_release);
+    return count;
+  }
+  // called from the consumer - always fills count samples, repeating the last sample if we run dry
+  void pop(T *samples, size_t count)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t available = head.load(std::memory_order_acquire) - t;
+    size_t n = count < available ? count : available;
+    for (size_t i = 0; i < n; i++)
+    {
+      samples[i] = buffer[(t + i) & mask];
+    }
+    if (n > 0)
+    {
+      lastSample = samples[n - 1];
+    }
+    tail.store(t + n, std::memory_order_release);
+    if (n < count)
+    {
+      underruns++;
+      for (size_t i = n; i < count; i++)
+      {
+        samples[i] = lastSample;
+      }
+    }
+  }
+  uint32_t getUnderruns() const
+  {
+    return underruns;
+  }
+  uint32_t getOverruns() const
+  {
+    return overruns;
+  }
+};
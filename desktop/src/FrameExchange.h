@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+// A copy of everything the display needs from a completed frame
+struct DisplayFrame
+{
+  uint8_t screen[6912];
+  uint8_t borderColor;
+};
+
+// Triple buffered hand over of frames from the emulator thread to the render loop.
+// The emulator always has a buffer to draw into and the renderer always sees a complete frame
+// - neither side ever waits for the other.
+class FrameExchange
+{
+private:
+  static const int FRESH = 4;
+  DisplayFrame frames[3] = {};
+  // owned by the emulator thread
+  int back = 0;
+  // the buffer in the middle - the FRESH bit is set when it holds a frame the renderer hasn't seen
+  std::atomic<int> middle{1};
+  // owned by the render loop
+  int front = 2;
+
+public:
+  // the emulator thread fills this in and then calls publish
+  DisplayFrame *backBuffer()
+  {
+    return &frames[back];
+  }
+  void publish()
+  {
+    back = middle.exchange(back | FRESH) & 3;
+  }
+  // the render loop gets the most recently published frame
+  const DisplayFrame *latest(bool *isNew = nullptr)
+  {
+    bool fresh = middle.load() & FRESH;
+    if (fresh)
+    {
+      front = middle.exchange(front) & 3;
+    }
+    if (isNew)
+    {
+      *isNew = fresh;
+    }
+    return &frames[front];
+  }
+};
@@ -4,6 +4,7 @@
 #include "stdio.h"
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #define TZX_WAV_FREQUENCY 44100
 #define TICKS_TO_SAMPLES(ticks) (ticks * TZX_WAV_FREQUENCY / CPU_FREQ)
@@ -77,6 +78,33 @@ class RawAudioListener: public TapeListener {
       runForTicks(MILLI_SECOND);
     }
 
+    void playPulses(const uint32_t *pulses, int count) {
+      for (int i = 0; i < count; i++) {
+        uint32_t ticks = PULSE_TICKS(pulses[i]);
+        totalTicks += ticks;
+        // write the samples for the whole pulse in one go
+        uint32_t numSamples = TICKS_TO_SAMPLES((uint64_t) ticks);
+        int16_t sample = micLevel;
+        size_t end = wavFile.size();
+        wavFile.resize(end + numSamples * sizeof(int16_t));
+        int16_t *samples = reinterpret_cast<int16_t *>(wavFile.data() + end);
+        std::fill(samples, samples + numSamples, sample);
+        switch (PULSE_LEVEL(pulses[i])) {
+          case PULSE_TOGGLE:
+            micLevel = (micLevel == WAVE_LOW) ? WAVE_HIGH : WAVE_LOW;
+            break;
+          case PULSE_LOW:
+            micLevel = WAVE_LOW;
+            break;
+          case PULSE_HIGH:
+            micLevel = WAVE_HIGH;
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
     void finish() {
       // Update file size and data size in header
       uint32_t dataSize = wavFile.size() - dataOffset;
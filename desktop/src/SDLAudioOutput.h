@@ -1,47 +1,40 @@
 #pragma once
 #include "AudioOutput.h"
-#include "spectrum.h"
-#include <thread>
-#include <chrono>
+#include "AudioRingBuffer.h"
+#include "Resampler.h"
+#include <SDL.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
 
-// Define constants
-constexpr size_t INPUT_SIZE = 312;         // Fixed input size
-constexpr size_t OUTPUT_SIZE = 882;       // Fixed output size (calculated based on resampling ratio)
-constexpr float INPUT_RATE = 15600.0f;    // Input sample rate
-constexpr float OUTPUT_RATE = 44100.0f;   // Output sample rate
+// The machine produces 312 samples every 69888 t-states at 3.5MHz
+constexpr double MACHINE_SAMPLE_RATE = 15625.0;
+// Size of the SDL audio callback buffer - keep this small for low latency
+constexpr int SDL_AUDIO_SAMPLES = 512;
+// How much audio we try and keep queued up in the ring buffer
+constexpr size_t TARGET_FILL = 2048;
+// The most we'll bend the playback rate to keep the ring buffer at the target fill
+constexpr double MAX_RATE_ADJUST = 0.005;
 
+// Audio output for the desktop build.
+//
+// The emulator thread calls write with each frame's samples, these are run through a polyphase
+// resampler to the device rate and pushed into a lock free ring buffer that the SDL audio callback
+// drains. The resampling ratio is nudged up or down depending on how full the ring buffer is so
+// that the emulator and sound card clocks don't drift apart.
 class SDLAudioOutput : public AudioOutput
 {
 protected:
-  ZXSpectrum *mMachine;
   SDL_AudioDeviceID audioDevice;
-  uint32_t buffer_size;
-  // Resample uint8_t audio data with fixed input and output buffer sizes
-  void resample(const uint8_t* input, uint8_t* output) {
-      // Calculate the resampling ratio
-      const float resampleRatio = OUTPUT_RATE / INPUT_RATE;
+  AudioRingBuffer<int16_t> ringBuffer;
+  Resampler resampler;
+  // the current rate adjustment applied by the rate control - the UI thread reads it for the stats
+  std::atomic<double> rateAdjust{0};
+  std::vector<int16_t> resampled;
 
-      // Perform linear interpolation
-      for (size_t i = 0; i < OUTPUT_SIZE; ++i) {
-          // Map the output index to the input index
-          float inputIdx = i / resampleRatio;
-          size_t idx = static_cast<size_t>(inputIdx);
-          float frac = inputIdx - idx;
-
-          // Interpolate between the two nearest samples
-          if (idx < INPUT_SIZE - 1) {
-              output[i] = static_cast<uint8_t>(
-                  (1.0f - frac) * input[idx] + frac * input[idx + 1]
-              );
-          } else {
-              // Handle the last sample
-              output[i] = input[idx];
-          }
-      }
-  }
-  uint8_t audioBuffer[INPUT_SIZE] = {0};
 public:
-  SDLAudioOutput(ZXSpectrum *machine) : AudioOutput(nullptr), mMachine(machine), audioDevice(0), buffer_size(0)
+  SDLAudioOutput() : AudioOutput(nullptr), audioDevice(0), ringBuffer(16384), resampler(MACHINE_SAMPLE_RATE, 44100)
   {
   };
   virtual ~SDLAudioOutput() {
@@ -49,22 +42,17 @@ public:
   }
   static void fillAudioBuffer(void *userdata, uint8_t *stream, int len) {
     SDLAudioOutput *audioOutput = static_cast<SDLAudioOutput *>(userdata);
-    // run the machine for a frame - this will populate the audio buffer
-    audioOutput->mMachine->runForFrame(audioOutput, nullptr);
-    // resample the audio to 44100
-    uint8_t resampledBuffer[OUTPUT_SIZE] = {0};
-    audioOutput->resample(audioOutput->audioBuffer, resampledBuffer);
-    // and copy it to the SDL audio buffer
-    memcpy(stream, resampledBuffer, len);
+    // mono 16 bit so two bytes per sample
+    audioOutput->ringBuffer.pop((int16_t *)stream, len / sizeof(int16_t));
   }
   virtual void start(uint32_t dummy) {
     (void)dummy;
     SDL_AudioSpec desiredSpec;
     SDL_zero(desiredSpec);
-    desiredSpec.freq = OUTPUT_RATE;
-    desiredSpec.format = AUDIO_U8;
+    desiredSpec.freq = 44100;
+    desiredSpec.format = AUDIO_S16SYS;
     desiredSpec.channels = 1;
-    desiredSpec.samples = OUTPUT_SIZE;
+    desiredSpec.samples = SDL_AUDIO_SAMPLES;
     desiredSpec.callback = fillAudioBuffer;
     desiredSpec.userdata = this;
 
@@ -75,6 +63,7 @@ public:
         std::cerr << "SDL_OpenAudioDevice failed: " << SDL_GetError() << std::endl;
         SDL_Quit();
     }
+    resampler.setRates(MACHINE_SAMPLE_RATE, obtainedSpec.freq);
     printf("Opened audio device\n");
     printf("Desired Audio Sample Rate is: %d\n", desiredSpec.freq);
     printf("Desired Audio Format is: %d\n", desiredSpec.format);
@@ -96,32 +85,36 @@ public:
   virtual void resume() {
     SDL_PauseAudioDevice(audioDevice, 0);
   }
-  // override this in derived classes to turn the sample into
-  // something the output device expects - for the default case
-  // this is simply a pass through
-  virtual int16_t process_sample(int16_t sample) { return sample; }
+  // called from the emulator thread with a frame's worth of samples
   virtual void write(const uint8_t *samples, int count) {
-    memcpy(audioBuffer, samples, count);
+    if (count <= 0) {
+      return;
+    }
+    // dynamic rate control - if we're running ahead of the sound card produce slightly fewer samples and vice versa
+    double error = ((double)ringBuffer.size() - (double)TARGET_FILL) / TARGET_FILL;
+    double adjust = std::max(-MAX_RATE_ADJUST, std::min(MAX_RATE_ADJUST, error * MAX_RATE_ADJUST));
+    rateAdjust = adjust;
+    resampler.setRateAdjust(adjust);
+    resampled.resize(resampler.maxOutput(count));
+    int outputCount = resampler.process(samples, count, resampled.data(), resampled.size());
+    ringBuffer.push(resampled.data(), outputCount);
   }
 
-  void setVolume(int volume){
-    if (volume > 10 || volume < 0) mVolume = 10;
-    else mVolume = volume;
+  // how many samples are queued up waiting to be played
+  size_t getBufferFill() {
+    return ringBuffer.size();
   }
-
-  void volumeUp() {
-    if (mVolume == 10) {
-      return;
-    }
-    mVolume++;
+  // is there enough audio queued up or should the emulator run another frame
+  bool needsMoreAudio() {
+    return ringBuffer.size() < TARGET_FILL;
   }
-  void volumeDown() {
-    if (mVolume == 0) {
-      return;
-    }
-    mVolume--;
+  uint32_t getUnderruns() {
+    return ringBuffer.getUnderruns();
+  }
+  uint32_t getOverruns() {
+    return ringBuffer.getOverruns();
   }
-  int getVolume() {
-    return mVolume;
+  double getRateAdjust() {
+    return rateAdjust;
   }
 };
@@ -0,0 +1,323 @@
+// Checks that skipping over tape loader loops leaves the machine exactly as running them does.
+//
+// Each case loads a tape twice with flash loading off, once with the loader acceleration and once without, and
+// the registers and every RAM bank have to be the same once it has loaded. The made up cases call LD-BYTES in the
+// ROM, a copy of it in RAM - which is how a lot of custom loaders start out - and a copy changed to read a turbo
+// block at twice the normal speed from a TZX. JetSet.tzx is played on a 48K and a 128K if it's there, along with
+// any tapes given. The T-states that were skipped are shown against how long each tape took.
+//
+//   accel_bench [tape ...]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "spectrum.h"
+#include "TapeSource.h"
+#include "BootImage.h"
+#include "loadgame.h"
+
+// where the program is, where it ends up when the loader returns, where the data goes and where loaders are copied to
+const uint16_t PROGRAM = 0x8000;
+const uint16_t DONE = PROGRAM + 0x15;
+const uint16_t DESTINATION = 0x9000;
+const uint16_t STACK = PROGRAM;
+const uint16_t LOADER = 0x6000;
+// LD-BYTES up to the end of LD-EDGE-1
+const uint16_t LD_BYTES = 0x0556;
+const uint16_t LD_BYTES_END = 0x0605;
+
+enum Loader {
+    ROM_LOADER,
+    RAM_LOADER,
+    TURBO_LOADER
+};
+
+struct Case {
+    const char *name;
+    Loader loader;
+    uint8_t flag;
+    int length;
+};
+
+const Case cases[] = {
+    {"ROM header", ROM_LOADER, 0x00, 17},
+    {"ROM a screen", ROM_LOADER, 0xFF, 6912},
+    {"ROM 20000 bytes", ROM_LOADER, 0xFF, 20000},
+    {"loader in RAM", RAM_LOADER, 0xFF, 6912},
+    {"turbo header", TURBO_LOADER, 0x00, 17},
+    {"turbo 20000 bytes", TURBO_LOADER, 0xFF, 20000},
+};
+
+// the emulator logs what it's doing - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+struct Result {
+    Z80Regs regs;
+    std::vector<uint8_t> ram;
+    int frames = 0;
+    uint64_t skipped = 0;
+    // did the data end up where it should - the made up cases only
+    bool loaded = true;
+};
+
+void add16(std::vector<uint8_t> &tape, int value) {
+    tape.push_back(value & 0xFF);
+    tape.push_back(value >> 8);
+}
+
+std::vector<uint8_t> makeBlock(uint8_t flag, const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> block = {flag};
+    uint8_t parity = flag;
+    for (uint8_t value : data) {
+        block.push_back(value);
+        parity ^= value;
+    }
+    block.push_back(parity);
+    return block;
+}
+
+// a TAP for the ROM timings or a TZX with a turbo block at twice the speed
+std::vector<uint8_t> makeTape(const Case &test, const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> block = makeBlock(test.flag, data);
+    std::vector<uint8_t> tape;
+    if (test.loader != TURBO_LOADER) {
+        add16(tape, block.size());
+    } else {
+        const uint8_t header[] = {'Z', 'X', 'T', 'a', 'p', 'e', '!', 0x1A, 1, 20};
+        tape.insert(tape.end(), header, header + sizeof(header));
+        // turbo speed data - pilot, two syncs, zero and one pulses, the pilot length, bits in the last byte
+        // and a one second pause
+        tape.push_back(0x11);
+        add16(tape, 1084);
+        add16(tape, 333);
+        add16(tape, 367);
+        add16(tape, 428);
+        add16(tape, 855);
+        add16(tape, test.flag < 0x80 ? 8063 : 3223);
+        tape.push_back(8);
+        add16(tape, 1000);
+        tape.push_back(block.size() & 0xFF);
+        tape.push_back((block.size() >> 8) & 0xFF);
+        tape.push_back(block.size() >> 16);
+    }
+    tape.insert(tape.end(), block.begin(), block.end());
+    return tape;
+}
+
+// copy LD-BYTES into RAM - the calls and jumps into itself have to move with it. For the turbo loader the
+// timing constants are changed for pulses half as long
+uint16_t copyLoader(ZXSpectrum *machine, bool turbo) {
+    std::vector<uint8_t> code;
+    for (int address = LD_BYTES; address < LD_BYTES_END; address++) {
+        code.push_back(machine->z80_peek(address));
+    }
+    for (size_t i = 0; i + 2 < code.size(); i++) {
+        int target = code[i + 1] | (code[i + 2] << 8);
+        // CALL nn and JP NC,nn
+        if ((code[i] == 0xCD || code[i] == 0xD2) && target >= LD_BYTES && target < LD_BYTES_END) {
+            target += LOADER - LD_BYTES;
+            code[i + 1] = target & 0xFF;
+            code[i + 2] = target >> 8;
+        }
+    }
+    if (turbo) {
+        // where each constant is, what it was and what it becomes - the second that LD-START waits for (a turbo
+        // pilot doesn't last that long), the counts that the leader, the first sync pulse and each bit are timed
+        // from, and the delay before looking for an edge
+        const int changes[][3] = {{0x0573, 0x04, 0x01}, {0x0581, 0x9C, 0xB4}, {0x0590, 0xC9, 0xCE}, {0x05A6, 0xB0, 0xC0},
+            {0x05C7, 0xB2, 0xC2}, {0x05D4, 0xB0, 0xC0}, {0x05E8, 0x16, 0x0B}};
+        for (const int *change : changes) {
+            if (code[change[0] - LD_BYTES] != change[1]) {
+                fprintf(stderr, "The ROM isn't the one we expected\n");
+                exit(1);
+            }
+            code[change[0] - LD_BYTES] = change[2];
+        }
+    }
+    for (size_t i = 0; i < code.size(); i++) {
+        machine->z80_poke(LOADER + i, code[i]);
+    }
+    return LOADER;
+}
+
+void finish(ZXSpectrum *machine, Result &result) {
+    result.skipped = machine->tapeDeck.getSkippedTStates();
+    machine->tapeDeck.eject();
+    result.regs = *machine->z80Regs;
+    for (int bank = 0; bank < 8; bank++) {
+        result.ram.insert(result.ram.end(), machine->mem.banks[bank]->data, machine->mem.banks[bank]->data + 0x4000);
+    }
+    result.ram.push_back(machine->mem.hwBank);
+}
+
+Result run(const Case &test, const std::vector<uint8_t> &tape, const std::vector<uint8_t> &data, bool accelerate) {
+    // a new machine each time so both runs start from exactly the same place
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(SPECMDL_48K);
+    machine->reset_spectrum(machine->z80Regs);
+    for (int frame = 0; frame < 100; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    uint16_t loader = test.loader == ROM_LOADER ? LD_BYTES : copyLoader(machine, test.loader == TURBO_LOADER);
+    // DI, IM 2, LD A,FE, LD I,A, LD IX,DESTINATION, LD DE,length, LD A,flag, SCF, CALL loader, DI, JR $ - the
+    // interrupts go to an EI, RETI so they leave everything alone
+    const uint8_t program[] = {0xF3, 0xED, 0x5E, 0x3E, 0xFE, 0xED, 0x47, 0xDD, 0x21, DESTINATION & 0xFF,
+        DESTINATION >> 8, 0x11, (uint8_t) (test.length & 0xFF), (uint8_t) (test.length >> 8), 0x3E, test.flag, 0x37,
+        0xCD, (uint8_t) (loader & 0xFF), (uint8_t) (loader >> 8), 0xF3, 0x18, 0xFE};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        machine->z80_poke(PROGRAM + i, program[i]);
+    }
+    for (int address = 0xFE00; address <= 0xFF00; address++) {
+        machine->z80_poke(address, 0xFD);
+    }
+    machine->z80_poke(0xFDFD, 0xFB);
+    machine->z80_poke(0xFDFE, 0xED);
+    machine->z80_poke(0xFDFF, 0x4D);
+    machine->z80Regs->SP.W = STACK;
+    machine->z80Regs->PC.W = PROGRAM;
+
+    machine->tapeDeck.insert(new TapeSource(tape.data(), tape.size()), test.loader != TURBO_LOADER);
+    machine->tapeDeck.setFlashLoad(false);
+    machine->tapeDeck.setLoaderAcceleration(accelerate);
+    machine->tapeDeck.play();
+    Result result;
+    // a block of 20000 bytes takes just under two minutes
+    for (result.frames = 0; result.frames < 50 * 180 && machine->z80Regs->PC.W != DONE; result.frames++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    // the carry is set if it loaded
+    result.loaded = machine->z80Regs->PC.W == DONE && (machine->z80Regs->AF.B.l & 0x01);
+    for (int i = 0; i < test.length; i++) {
+        result.loaded = result.loaded && machine->z80_peek(DESTINATION + i) == data[i];
+    }
+    finish(machine, result);
+    delete machine;
+    return result;
+}
+
+// play a whole tape from LOAD "" until it stops
+Result runTape(const std::string &filename, models_enum model, bool accelerate) {
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(model);
+    machine->reset_spectrum(machine->z80Regs);
+    readyToLoad(machine);
+    Result result;
+    if (!insertTape(filename, machine, false)) {
+        result.loaded = false;
+        delete machine;
+        return result;
+    }
+    machine->tapeDeck.setLoaderAcceleration(accelerate);
+    // give up after ten minutes of tape
+    for (result.frames = 0; result.frames < 50 * 600 && machine->tapeDeck.isPlaying(); result.frames++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    finish(machine, result);
+    delete machine;
+    return result;
+}
+
+// the registers that differ - and an empty string if they're the same
+std::string differences(const Z80Regs &slow, const Z80Regs &fast) {
+    std::string different;
+    auto check = [&](const char *name, uint16_t a, uint16_t b) {
+        if (a != b) {
+            char text[40];
+            snprintf(text, sizeof(text), " %s %04X/%04X", name, a, b);
+            different += text;
+        }
+    };
+    check("AF", slow.AF.W, fast.AF.W);
+    check("BC", slow.BC.W, fast.BC.W);
+    check("DE", slow.DE.W, fast.DE.W);
+    check("HL", slow.HL.W, fast.HL.W);
+    check("IX", slow.IX.W, fast.IX.W);
+    check("IY", slow.IY.W, fast.IY.W);
+    check("SP", slow.SP.W, fast.SP.W);
+    check("PC", slow.PC.W, fast.PC.W);
+    check("AF'", slow.AFs.W, fast.AFs.W);
+    check("BC'", slow.BCs.W, fast.BCs.W);
+    check("DE'", slow.DEs.W, fast.DEs.W);
+    check("HL'", slow.HLs.W, fast.HLs.W);
+    check("R", slow.R.W, fast.R.W);
+    check("I", slow.I, fast.I);
+    check("IFF", (slow.IFF1 << 1) | slow.IFF2, (fast.IFF1 << 1) | fast.IFF2);
+    return different;
+}
+
+// compare a run without acceleration against one with it and print the result - returns true if they match
+bool report(const std::string &name, const Result &slow, const Result &fast) {
+    std::string different = differences(slow.regs, fast.regs);
+    int ramDifferences = 0;
+    for (size_t i = 0; i < slow.ram.size(); i++) {
+        ramDifferences += slow.ram[i] != fast.ram[i];
+    }
+    if (ramDifferences) {
+        different += " RAM " + std::to_string(ramDifferences) + " bytes";
+    }
+    if (slow.frames != fast.frames) {
+        different += " frames " + std::to_string(slow.frames) + "/" + std::to_string(fast.frames);
+    }
+    if (!slow.loaded || !fast.loaded) {
+        different += " (didn't load)";
+    }
+    double tapeTStates = (double) fast.frames * FRAME_TSTATES;
+    printf("%-24s %8d %14llu %8.1f%%  %s%s\n", name.c_str(), fast.frames, (unsigned long long) fast.skipped,
+        tapeTStates > 0 ? fast.skipped * 100.0 / tapeTStates : 0, different.empty() ? "ok" : "FAILED", different.c_str());
+    return different.empty();
+}
+
+int main(int argc, char *argv[]) {
+    printf("%-24s %8s %14s %9s  %s\n", "case", "frames", "skipped", "of tape", "check");
+    int failures = 0;
+    for (const Case &test : cases) {
+        srand(test.length);
+        std::vector<uint8_t> data(test.length);
+        for (uint8_t &value : data) {
+            value = rand();
+        }
+        std::vector<uint8_t> tape = makeTape(test, data);
+        int saved = quiet();
+        Result slow = run(test, tape, data, false);
+        Result fast = run(test, tape, data, true);
+        loud(saved);
+        failures += report(test.name, slow, fast) ? 0 : 1;
+    }
+    std::vector<std::string> tapes;
+    if (access("../firmware/data/JetSet.tzx", R_OK) == 0) {
+        tapes.push_back("../firmware/data/JetSet.tzx");
+    }
+    for (int i = 1; i < argc; i++) {
+        tapes.push_back(argv[i]);
+    }
+    for (const std::string &tape : tapes) {
+        std::string name = tape.substr(tape.find_last_of('/') + 1);
+        for (models_enum model : {SPECMDL_48K, SPECMDL_128K}) {
+            int saved = quiet();
+            Result slow = runTape(tape, model, false);
+            Result fast = runTape(tape, model, true);
+            loud(saved);
+            failures += report(name + (model == SPECMDL_128K ? " 128K" : " 48K"), slow, fast) ? 0 : 1;
+        }
+    }
+    printf("%s\n", failures == 0 ? "All ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
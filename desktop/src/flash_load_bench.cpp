@@ -0,0 +1,225 @@
+// Checks that flash loading a block leaves the machine exactly as the ROM loader does.
+//
+// Each case is a tape with one standard speed block and a little program that calls LD-BYTES (0x0556) for
+// it. The program runs once with the tape played edge by edge through the ROM and once with the block flash
+// loaded by ZXSpectrum::trapLoadBlock, and the registers and memory are compared when LD-BYTES returns. The
+// cases cover loading and verifying, the wrong flag byte, a verify that fails part way, blocks that are
+// shorter or longer than asked for, bad parity and a signal that starts off high.
+//
+//   flash_load_bench
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "spectrum.h"
+#include "TapeSource.h"
+
+// where the program is, where it ends up when LD-BYTES returns and where the data goes
+const uint16_t PROGRAM = 0x8000;
+const uint16_t DONE = PROGRAM + 0x15;
+const uint16_t DESTINATION = 0x9000;
+const uint16_t STACK = PROGRAM;
+
+struct Case {
+    const char *name;
+    uint8_t flag;
+    int length;
+    // what LD-BYTES is asked for
+    uint8_t wantedFlag;
+    int wantedLength;
+    bool verify;
+    // for verify - the byte that's different in memory or -1 if it all matches
+    int differentByte;
+    bool badParity;
+    bool noParity;
+    // a TZX that sets the signal high before the block
+    bool startHigh;
+};
+
+const Case cases[] = {
+    {"load 1 byte", 0xFF, 1, 0xFF, 1, false, -1, false, false, false},
+    {"load 100 bytes", 0xFF, 100, 0xFF, 100, false, -1, false, false, false},
+    {"load a screen", 0xFF, 6912, 0xFF, 6912, false, -1, false, false, false},
+    {"load 20000 bytes", 0xFF, 20000, 0xFF, 20000, false, -1, false, false, false},
+    {"load a header", 0x00, 17, 0x00, 17, false, -1, false, false, false},
+    {"wrong flag", 0x00, 17, 0xFF, 17, false, -1, false, false, false},
+    {"verify", 0xFF, 100, 0xFF, 100, true, -1, false, false, false},
+    {"verify fails", 0xFF, 100, 0xFF, 100, true, 50, false, false, false},
+    {"verify first fails", 0xFF, 100, 0xFF, 100, true, 0, false, false, false},
+    {"verify short block", 0xFF, 100, 0xFF, 200, true, -1, false, false, false},
+    {"short block", 0xFF, 100, 0xFF, 200, false, -1, false, false, false},
+    {"long block", 0xFF, 200, 0xFF, 100, false, -1, false, false, false},
+    {"bad parity", 0xFF, 100, 0xFF, 100, false, -1, true, false, false},
+    {"no parity byte", 0xFF, 100, 0xFF, 100, false, -1, false, true, false},
+    {"just a flag", 0xFF, 0, 0xFF, 100, false, -1, false, true, false},
+    {"nothing wanted", 0xFF, 100, 0xFF, 0, false, -1, false, false, false},
+    {"starts high", 0xFF, 100, 0xFF, 100, false, -1, false, false, true},
+    {"starts high short", 0xFF, 100, 0xFF, 200, false, -1, false, false, true},
+    {"starts high wrong", 0x00, 17, 0xFF, 17, false, -1, false, false, true},
+};
+
+// the emulator logs what it's doing - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+struct Result {
+    Z80Regs regs;
+    std::vector<uint8_t> memory;
+    int frames;
+};
+
+// a TAP with the block in it - or a TZX if the signal has to start high
+std::vector<uint8_t> makeTape(const Case &test, std::vector<uint8_t> &data) {
+    data.resize(test.length);
+    for (uint8_t &value : data) {
+        value = rand();
+    }
+    std::vector<uint8_t> block;
+    uint8_t parity = test.flag;
+    block.push_back(test.flag);
+    for (uint8_t value : data) {
+        block.push_back(value);
+        parity ^= value;
+    }
+    if (!test.noParity) {
+        block.push_back(test.badParity ? parity ^ 0x10 : parity);
+    }
+    std::vector<uint8_t> tape;
+    if (test.startHigh) {
+        const uint8_t header[] = {'Z', 'X', 'T', 'a', 'p', 'e', '!', 0x1A, 1, 20};
+        tape.insert(tape.end(), header, header + sizeof(header));
+        // set signal level - high
+        const uint8_t setLevel[] = {0x2B, 1, 0, 0, 0, 1};
+        tape.insert(tape.end(), setLevel, setLevel + sizeof(setLevel));
+        // standard speed data with a one second pause
+        const uint8_t standard[] = {0x10, 0xE8, 0x03};
+        tape.insert(tape.end(), standard, standard + sizeof(standard));
+    }
+    tape.push_back(block.size() & 0xFF);
+    tape.push_back(block.size() >> 8);
+    tape.insert(tape.end(), block.begin(), block.end());
+    return tape;
+}
+
+Result run(const Case &test, const std::vector<uint8_t> &tape, const std::vector<uint8_t> &data, bool flashLoad) {
+    // a new machine each time so both runs start from exactly the same place
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(SPECMDL_48K);
+    machine->reset_spectrum(machine->z80Regs);
+    for (int frame = 0; frame < 100; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    // DI, IM 2, LD A,FE, LD I,A, LD IX,DESTINATION, LD DE,wantedLength, LD A,wantedFlag, SCF or AND A,
+    // CALL LD-BYTES, DI, JR $ - the interrupts go to an EI, RETI so they leave everything alone
+    const uint8_t program[] = {0xF3, 0xED, 0x5E, 0x3E, 0xFE, 0xED, 0x47, 0xDD, 0x21, DESTINATION & 0xFF,
+        DESTINATION >> 8, 0x11, (uint8_t) (test.wantedLength & 0xFF), (uint8_t) (test.wantedLength >> 8), 0x3E,
+        test.wantedFlag, (uint8_t) (test.verify ? 0xA7 : 0x37), 0xCD, 0x56, 0x05, 0xF3, 0x18, 0xFE};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        machine->z80_poke(PROGRAM + i, program[i]);
+    }
+    for (int address = 0xFE00; address <= 0xFF00; address++) {
+        machine->z80_poke(address, 0xFD);
+    }
+    machine->z80_poke(0xFDFD, 0xFB);
+    machine->z80_poke(0xFDFE, 0xED);
+    machine->z80_poke(0xFDFF, 0x4D);
+    // what a verify compares against
+    for (int i = 0; test.verify && i < test.length; i++) {
+        machine->z80_poke(DESTINATION + i, i == test.differentByte ? data[i] ^ 0x01 : data[i]);
+    }
+    machine->z80Regs->SP.W = STACK;
+    machine->z80Regs->PC.W = PROGRAM;
+
+    machine->tapeDeck.insert(new TapeSource(tape.data(), tape.size()), !test.startHigh);
+    machine->tapeDeck.setFlashLoad(flashLoad);
+    // the ROM on its own without skipping the loops that wait for an edge
+    machine->tapeDeck.setLoaderAcceleration(false);
+    machine->tapeDeck.play();
+    Result result;
+    // a block of 20000 bytes takes just under two minutes
+    for (result.frames = 0; result.frames < 50 * 180 && machine->z80Regs->PC.W != DONE; result.frames++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    machine->tapeDeck.eject();
+    result.regs = *machine->z80Regs;
+    for (int address = 0x4000; address < 0x10000; address++) {
+        result.memory.push_back(machine->z80_peek(address));
+    }
+    delete machine;
+    return result;
+}
+
+// the registers that differ - and an empty string if they're the same
+std::string differences(const Z80Regs &rom, const Z80Regs &flash) {
+    std::string different;
+    auto check = [&](const char *name, uint16_t a, uint16_t b) {
+        if (a != b) {
+            char text[40];
+            snprintf(text, sizeof(text), " %s %04X/%04X", name, a, b);
+            different += text;
+        }
+    };
+    check("AF", rom.AF.W, flash.AF.W);
+    check("BC", rom.BC.W, flash.BC.W);
+    check("DE", rom.DE.W, flash.DE.W);
+    check("HL", rom.HL.W, flash.HL.W);
+    check("IX", rom.IX.W, flash.IX.W);
+    check("IY", rom.IY.W, flash.IY.W);
+    check("SP", rom.SP.W, flash.SP.W);
+    check("PC", rom.PC.W, flash.PC.W);
+    check("AF'", rom.AFs.W, flash.AFs.W);
+    check("BC'", rom.BCs.W, flash.BCs.W);
+    check("DE'", rom.DEs.W, flash.DEs.W);
+    check("HL'", rom.HLs.W, flash.HLs.W);
+    check("IFF", rom.IFF1, flash.IFF1);
+    return different;
+}
+
+int main() {
+    printf("%-20s %6s %6s %6s %8s %8s  %s\n", "case", "AF", "BC", "HL", "frames", "flash", "check");
+    int failures = 0;
+    for (const Case &test : cases) {
+        srand(test.length);
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> tape = makeTape(test, data);
+        int saved = quiet();
+        Result rom = run(test, tape, data, false);
+        Result flash = run(test, tape, data, true);
+        loud(saved);
+        std::string different = differences(rom.regs, flash.regs);
+        int memoryDifferences = 0;
+        for (size_t i = 0; i < rom.memory.size(); i++) {
+            // the loader's calls leave their return addresses below the stack and the trap doesn't
+            int address = 0x4000 + i;
+            if (address < STACK - 16 || address >= STACK - 4) {
+                memoryDifferences += rom.memory[i] != flash.memory[i];
+            }
+        }
+        if (rom.regs.PC.W != DONE) {
+            different += " (LD-BYTES never returned)";
+        }
+        if (memoryDifferences) {
+            different += " memory " + std::to_string(memoryDifferences) + " bytes";
+        }
+        printf("%-20s %04X   %04X   %04X   %8d %8d  %s%s\n", test.name, rom.regs.AF.W, rom.regs.BC.W, rom.regs.HL.W,
+            rom.frames, flash.frames, different.empty() ? "ok" : "FAILED", different.c_str());
+        failures += different.empty() ? 0 : 1;
+    }
+    printf("%s\n", failures == 0 ? "All ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
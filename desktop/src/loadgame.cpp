@@ -9,8 +9,8 @@
 #include "tzx_cas.h"
 #include "snaps.h"
 #include "RawAudioListener.h"
-#include "DummyListener.h"
 #include "ZXSpectrumTapeListener.h"
+#include "TapeSource.h"
 #include <fstream>
 #include <vector>
 
@@ -26,13 +26,9 @@ void loadGame(const std::string& filename, ZXSpectrum* machine) {
     loadTapeGame(buffer.data(), buffer.size(), filename, machine);
 }
 
-void loadTapeGame(uint8_t* tzx_data, size_t file_size, const std::string& filename, ZXSpectrum* machine) {
+void loadTapeGame(uint8_t* tzx_data, size_t file_size, const std::string& filename, ZXSpectrum* machine, bool flashLoad) {
     // load the tape
     TzxCas tzxCas;
-    DummyListener *dummyListener = new DummyListener();
-    dummyListener->start();
-    tzxCas.load_tzx(dummyListener, tzx_data, file_size);
-    dummyListener->finish();
 
     ZXSpectrumTapeListener *listener = new ZXSpectrumTapeListener(machine, [&](uint64_t /* progress */)
       {
@@ -43,6 +39,7 @@ void loadTapeGame(uint8_t* tzx_data, size_t file_size, const std::string& filena
         // }
         // printf("Progress: %lld\n", progress * 100 / totalTicks);
       });
+    listener->setFlashLoad(flashLoad);
     listener->start();
     if (filename.find(".tap") != std::string::npos || filename.find(".TAP") != std::string::npos) {
         tzxCas.load_tap(listener, tzx_data, file_size);
@@ -55,3 +52,21 @@ void loadTapeGame(uint8_t* tzx_data, size_t file_size, const std::string& filena
 
     std::cout << "Loaded tape." << std::endl;
 }
+
+bool insertTape(const std::string& filename, ZXSpectrum* machine, bool flashLoad) {
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+    // the deck reads the tape from the file as it plays and closes it when the tape is ejected
+    bool isTap = filename.find(".tap") != std::string::npos || filename.find(".TAP") != std::string::npos;
+    if (!machine->tapeDeck.insert(new TapeSource(fp, true), isTap)) {
+        std::cerr << "Failed to read tape: " << filename << std::endl;
+        return false;
+    }
+    machine->tapeDeck.setFlashLoad(flashLoad);
+    machine->tapeDeck.play();
+    std::cout << "Playing tape: " << filename << std::endl;
+    return true;
+}
@@ -5,5 +5,7 @@
 #include "spectrum.h"
 
 void loadGame(const std::string& filename, ZXSpectrum* machine);
-void loadTapeGame(uint8_t* data, size_t length, const std::string& filename, ZXSpectrum* machine);
+void loadTapeGame(uint8_t* data, size_t length, const std::string& filename, ZXSpectrum* machine, bool flashLoad = false);
+// put a tape in the machine's tape deck and press play
+bool insertTape(const std::string& filename, ZXSpectrum* machine, bool flashLoad = true);
 void loadZ80Game(uint8_t* data, size_t length, const std::string& filename, ZXSpectrum* machine);
\ No newline at end of file
@@ -17,19 +17,23 @@
 #include "spectrum.h"
 #include "tzx_cas.h"
 #include "snaps.h"
+#include "BootImage.h"
 #include "RawAudioListener.h"
 #include "DummyListener.h"
 #include "ZXSpectrumTapeListener.h"
 #include "SDLAudioOutput.h"
+#include "FrameExchange.h"
 #include "loadgame.h"
 #include "input.h"
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <atomic>
 
 void stop();
 
 bool isLoading = false;
-bool isRunning = false;
+std::atomic<bool> isRunning(false);
 uint16_t flashTimer = 0;
 
 // this matches our TFT display - but this could be any size really
@@ -44,9 +48,17 @@ uint16_t frameBuffer[WIDTH * HEIGHT] = {0}; // Example: initialize your 16-bit f
 
 SDL_Window *window = nullptr;
 SDL_Renderer *renderer = nullptr;
-AudioOutput *audioOutput = nullptr;
+SDLAudioOutput *audioOutput = nullptr;
 SDL_Texture *texture = nullptr;
 
+// held by whoever is currently using the machine - the emulator thread or the UI when loading games
+std::mutex machineMutex;
+// completed frames handed from the emulator to the render loop
+FrameExchange frameExchange;
+#ifndef __EMSCRIPTEN__
+std::thread emulatorThread;
+#endif
+
 #ifdef __APPLE__
 std::string OpenFileDialog() {
     @autoreleasepool {
@@ -139,7 +151,7 @@ bool initSDL(SDL_Window *&window, SDL_Renderer *&renderer, const std::string& ti
         return false;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (!renderer)
     {
         std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
@@ -196,9 +208,8 @@ void updateAndRender(SDL_Renderer *renderer, SDL_Texture *texture, uint16_t *fra
 }
 
 // Handles SDL events, including quit and keyboard input
-void handleEvents(bool &isRunning)
+void handleEvents()
 {
-    (void)isRunning;
     SDL_Event e;
     while (SDL_PollEvent(&e) != 0)
     {
@@ -220,8 +231,12 @@ void handleEvents(bool &isRunning)
             case SDLK_ESCAPE:
                 #ifndef __EMSCRIPTEN__
                 if(!isLoading) {
+                    // pick the file before taking the machine so the emulator keeps running while the dialog is up
                     std::string filename = OpenFileDialog();
-                    loadGame(filename, machine);
+                    if (!filename.empty()) {
+                        std::lock_guard<std::mutex> lock(machineMutex);
+                        insertTape(filename, machine);
+                    }
                     return;
                 }
                 #endif
@@ -233,6 +248,7 @@ void handleEvents(bool &isRunning)
             auto it = sdl_to_spec.find(e.key.keysym.sym);
             if (it != sdl_to_spec.end())
             {
+                std::lock_guard<std::mutex> lock(machineMutex);
                 machine->updateKey(it->second, 1);
             }
         }
@@ -241,6 +257,7 @@ void handleEvents(bool &isRunning)
             auto it = sdl_to_spec.find(e.key.keysym.sym);
             if (it != sdl_to_spec.end())
             {
+                std::lock_guard<std::mutex> lock(machineMutex);
                 machine->updateKey(it->second, 0);
             }
         }
@@ -332,15 +349,79 @@ void fillFrameBuffer(uint16_t *pixelBuffer, uint8_t *currentScreenBuffer, uint8_
     }
 }
 
+// Hands the current screen over to the render loop - call with the machine locked
+void publishFrame()
+{
+    DisplayFrame *frame = frameExchange.backBuffer();
+    memcpy(frame->screen, machine->mem.currentScreen->data, sizeof(frame->screen));
+    frame->borderColor = machine->hwopt.BorderColor;
+    frameExchange.publish();
+}
+
+// Runs a frame of the machine and hands the screen over to the render loop
+void runFrame()
+{
+    std::lock_guard<std::mutex> lock(machineMutex);
+    // turbo loading - run the extra frames without any audio
+    for (int i = 1; machine->tapeDeck.isPlaying() && i < machine->tapeDeck.getSpeed(); i++)
+    {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    machine->runForFrame(audioOutput, nullptr);
+    publishFrame();
+}
+
+#ifndef __EMSCRIPTEN__
+// The emulator runs on its own thread at the machine's frame rate - the audio output's rate
+// control takes care of any drift between our clock and the sound card's
+void emulatorLoop()
+{
+    const auto framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(FRAME_TSTATES / 3500000.0));
+    auto nextFrame = std::chrono::steady_clock::now();
+    while (isRunning)
+    {
+        runFrame();
+        nextFrame += framePeriod;
+        auto now = std::chrono::steady_clock::now();
+        if (now > nextFrame + std::chrono::milliseconds(100))
+        {
+            // we've fallen a long way behind (probably loading a game) - don't try and catch up
+            nextFrame = now;
+        }
+        // if the audio is about to run dry then run the next frame straight away
+        if (audioOutput->getBufferFill() > TARGET_FILL / 2)
+        {
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+}
+#endif
+
 void main_loop()
 {
-    handleEvents(isRunning);
+    handleEvents();
+    #ifdef __EMSCRIPTEN__
+    // no threads here - run enough frames to keep the audio topped up
+    for (int i = 0; i < 4 && isRunning && audioOutput && audioOutput->needsMoreAudio(); i++)
+    {
+        runFrame();
+    }
+    #endif
     count++;
-    // fill out the framebuffer
-    fillFrameBuffer(frameBuffer, machine->mem.currentScreen->data, machine->hwopt.BorderColor);
+    // fill out the framebuffer from the most recent complete frame
+    const DisplayFrame *frame = frameExchange.latest();
+    fillFrameBuffer(frameBuffer, (uint8_t *)frame->screen, frame->borderColor);
     updateAndRender(renderer, texture, frameBuffer);
     #ifndef __EMSCRIPTEN__
-    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // report how the audio is doing every 10 seconds or so
+    if (count % 600 == 0)
+    {
+        printf("Audio buffer %zu samples, rate adjust %.4f, underruns %u, overruns %u\n",
+            audioOutput->getBufferFill(), audioOutput->getRateAdjust(), audioOutput->getUnderruns(), audioOutput->getOverruns());
+    }
+    // present is synced to vsync - this just stops us spinning if vsync isn't available
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
     #endif
 }
 
@@ -362,78 +443,26 @@ void loadDroppedFile(std::string filename, const emscripten::val& arrayBuffer, b
     // check to see if this is a z80 file or sna file
     if (isZ80 || isSNA) {
         std::cout << "Loading z80 or sna file" << std::endl;
-        const char *fname = isZ80 ? "temp.z80": "temp.sna";
-        // write the data to a temp file
-        FILE *file = fopen(fname, "wb");
-        fwrite(data, 1, length, file);
-        fclose(file);
-        // now load the z80 file using our normal load game function
-        Load(machine, fname);
+        Load(machine, data, length, isZ80 ? SNAPSHOT_Z80 : SNAPSHOT_SNA);
     }
     if (isTAP || isTZX) {
         std::cout << "Loading tap or tzx file" << std::endl;
         machine->reset();
-        if (is128k) {
-            machine->init_spectrum(SPECMDL_128K);
-            machine->reset_spectrum(machine->z80Regs);
-            for(int i = 0; i < 200; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-        } else {
-            machine->init_spectrum(SPECMDL_48K);
-            machine->reset_spectrum(machine->z80Regs);
-            for(int i = 0; i < 200; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            // we need to do load ""
-            machine->updateKey(SPECKEY_J, 1);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_J, 0);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_SYMB, 1);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_P, 1);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_P, 0);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_P, 1);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_P, 0);
-            for(int i = 0; i < 10; i++) {
-                machine->runForFrame(nullptr, nullptr);
-            }
-            machine->updateKey(SPECKEY_SYMB, 0);
-        }
-        // press enter
-        machine->updateKey(SPECKEY_ENTER, 1);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        machine->updateKey(SPECKEY_ENTER, 0);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
+        machine->init_spectrum(is128k ? SPECMDL_128K : SPECMDL_48K);
+        machine->reset_spectrum(machine->z80Regs);
+        // get to LOAD "" from the boot image rather than booting the ROM
+        readyToLoad(machine);
         isLoading = true;
         loadTapeGame(data, length, filename, machine);
         isLoading = false;
     }
     free(data);
-    // start running the audio
-    audioOutput = new SDLAudioOutput(machine);
+    publishFrame();
+    // start running the audio - main_loop will keep it fed
+    delete audioOutput;
+    audioOutput = new SDLAudioOutput();
+    audioOutput->start(15625);
     isRunning = true;
-    audioOutput->start(15600);
 }
 
 EMSCRIPTEN_BINDINGS(module) {
@@ -561,22 +590,17 @@ int main(int argc, char* argv[])
         SDL_Quit();
         return -1;
     }
+    #ifdef __EMSCRIPTEN__
+    // run the spectrum for 4 seconds so that it boots up - dropping a tape on it gets it ready to load
     for(int i = 0; i < 200; i++) {
         machine->runForFrame(nullptr, nullptr);
     }
-    #ifndef __EMSCRIPTEN__
-    // run the spectrum for 4 second so that it boots up
+    publishFrame();
+    #else
     int start = SDL_GetTicks();
-
-    // press the enter key to trigger tape loading
-    machine->updateKey(SPECKEY_ENTER, 1);
-    for(int i = 0; i < 10; i++) {
-        machine->runForFrame(nullptr, nullptr);
-    }
-    machine->updateKey(SPECKEY_ENTER, 0);
-    for(int i = 0; i < 10; i++) {
-        machine->runForFrame(nullptr, nullptr);
-    }
+    // get the machine to the tape loader from the boot image
+    readyToLoad(machine);
+    publishFrame();
     int end = SDL_GetTicks();
     std::cout << "Time to boot spectrum: " << end - start << "ms" << std::endl;
     
@@ -588,6 +612,8 @@ int main(int argc, char* argv[])
     
     if (!filename.empty()) {
         isLoading = true;
+        // anything the game saves to tape goes in a TAP file next to it
+        machine->tapeRecorder.setFilename(TapeRecorder::savedTapeName(filename));
         // Check file extension to determine loading method
         std::string ext = "";
         size_t dotPos = filename.find_last_of('.');
@@ -600,15 +626,17 @@ int main(int argc, char* argv[])
         if (ext == ".z80" || ext == ".sna") {
             Load(machine, filename.c_str());
         } else if (ext == ".tap" || ext == ".tzx") {
-            loadGame(filename, machine);
+            // the tape plays in the background as the emulator runs
+            insertTape(filename, machine);
         } else {
             std::cerr << "Unsupported file type: " << filename << std::endl;
         }
         isLoading = false;
     }
-    audioOutput = new SDLAudioOutput(machine);
+    audioOutput = new SDLAudioOutput();
     isRunning = true;
-    audioOutput->start(15600);
+    audioOutput->start(15625);
+    emulatorThread = std::thread(emulatorLoop);
     #endif
     #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop(main_loop, 0, true);
@@ -617,6 +645,7 @@ int main(int argc, char* argv[])
     {
         main_loop();
     }
+    emulatorThread.join();
 
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
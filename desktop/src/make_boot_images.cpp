@@ -0,0 +1,210 @@
+// Makes the boot images in firmware/src/Emulator/boot_images.cpp by booting each model the slow way and
+// saving the state it ends up in.
+//
+//   make_boot_images ../firmware/src/Emulator/boot_images.cpp
+//
+// With --check it restores the images that were built in and checks that we get exactly the same machine as
+// a real boot - both straight away and after running on for a second.
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+#include "spectrum.h"
+#include "BootImage.h"
+
+struct MachineState {
+    BootImage image;
+    std::vector<uint8_t> ram;
+    std::vector<uint8_t> borderColors;
+};
+
+ZXSpectrum *newMachine(models_enum model) {
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(model);
+    machine->reset_spectrum(machine->z80Regs);
+    return machine;
+}
+
+// the RAM banks for the image - any ED is stored as a run so we never have to worry about literal EDs
+void compressBank(const uint8_t *data, std::vector<uint8_t> &out) {
+    int i = 0;
+    while (i < 0x4000) {
+        int run = 1;
+        while (i + run < 0x4000 && run < 255 && data[i + run] == data[i]) {
+            run++;
+        }
+        if (run >= 5 || data[i] == 0xED) {
+            out.insert(out.end(), {0xED, 0xED, (uint8_t) run, data[i]});
+            i += run;
+        } else {
+            out.push_back(data[i++]);
+        }
+    }
+}
+
+MachineState capture(ZXSpectrum *machine) {
+    MachineState state;
+    BootImage &image = state.image;
+    memset(&image, 0, sizeof(image));
+    image.version = BOOT_IMAGE_VERSION;
+    image.model = machine->hwopt.hw_model;
+    image.romHash = bootImageRomHash(machine);
+    Z80Regs *regs = machine->z80Regs;
+    image.AF = regs->AF.W;
+    image.BC = regs->BC.W;
+    image.DE = regs->DE.W;
+    image.HL = regs->HL.W;
+    image.IX = regs->IX.W;
+    image.IY = regs->IY.W;
+    image.PC = regs->PC.W;
+    image.SP = regs->SP.W;
+    image.R = regs->R.W;
+    image.AFs = regs->AFs.W;
+    image.BCs = regs->BCs.W;
+    image.DEs = regs->DEs.W;
+    image.HLs = regs->HLs.W;
+    image.IFF1 = regs->IFF1;
+    image.IFF2 = regs->IFF2;
+    image.I = regs->I;
+    image.halted = regs->halted;
+    image.IM = regs->IM;
+    image.IRequest = regs->IRequest;
+    image.cycles = regs->cycles;
+    image.borderColor = machine->hwopt.BorderColor;
+    image.soundBits = machine->hwopt.SoundBits;
+    image.hwBank = machine->mem.hwBank;
+    image.micLevel = machine->micLevel;
+    image.romLoadingRoutineHit = machine->romLoadingRoutineHit;
+    image.tstates = machine->tstates;
+    if (image.model == SPECMDL_128K) {
+        for (int i = 0; i < 16; i++) {
+            AySound::selectRegister(i);
+            image.ayRegisters[i] = AySound::getRegisterData();
+        }
+    }
+    const uint8_t *banks;
+    int bankCount = bootImageBanks(image.model, &banks);
+    for (int i = 0; i < bankCount; i++) {
+        const uint8_t *data = machine->mem.banks[banks[i]]->data;
+        state.ram.insert(state.ram.end(), data, data + 0x4000);
+    }
+    state.borderColors.assign(machine->borderColors, machine->borderColors + 312);
+    return state;
+}
+
+int differences(const MachineState &a, const MachineState &b, bool checkAY) {
+    int count = 0;
+    #define CHECK(field) if (a.image.field != b.image.field) { \
+        std::cerr << "  " #field " " << (int) a.image.field << " != " << (int) b.image.field << std::endl; count++; }
+    CHECK(model) CHECK(romHash)
+    CHECK(AF) CHECK(BC) CHECK(DE) CHECK(HL) CHECK(IX) CHECK(IY) CHECK(PC) CHECK(SP) CHECK(R)
+    CHECK(AFs) CHECK(BCs) CHECK(DEs) CHECK(HLs)
+    CHECK(IFF1) CHECK(IFF2) CHECK(I) CHECK(halted) CHECK(IM) CHECK(IRequest) CHECK(cycles)
+    CHECK(borderColor) CHECK(soundBits) CHECK(hwBank) CHECK(micLevel) CHECK(romLoadingRoutineHit) CHECK(tstates)
+    #undef CHECK
+    if (checkAY && memcmp(a.image.ayRegisters, b.image.ayRegisters, 16) != 0) {
+        std::cerr << "  AY registers differ" << std::endl;
+        count++;
+    }
+    for (size_t i = 0; i < a.ram.size() && i < b.ram.size(); i++) {
+        if (a.ram[i] != b.ram[i]) {
+            std::cerr << "  RAM differs at offset " << i << std::endl;
+            count++;
+            break;
+        }
+    }
+    if (a.borderColors != b.borderColors) {
+        std::cerr << "  border colours differ" << std::endl;
+        count++;
+    }
+    return count;
+}
+
+bool check(models_enum model, const char *name) {
+    ZXSpectrum *booted = newMachine(model);
+    bootToTapeLoader(booted);
+    MachineState bootedState = capture(booted);
+    ZXSpectrum *restored = newMachine(model);
+    if (!restoreBootImage(restored)) {
+        std::cerr << name << ": could not restore the boot image" << std::endl;
+        return false;
+    }
+    MachineState restoredState = capture(restored);
+    int count = differences(bootedState, restoredState, true);
+    // anything we've missed will probably show up once the machine has run for a while - the AY is shared by
+    // both machines so we can't compare it here
+    for (int i = 0; i < 50; i++) {
+        booted->runForFrame(nullptr, nullptr);
+    }
+    bootedState = capture(booted);
+    for (int i = 0; i < 50; i++) {
+        restored->runForFrame(nullptr, nullptr);
+    }
+    count += differences(bootedState, capture(restored), false);
+    std::cout << name << ": " << (count == 0 ? "matches a real boot" : "DOES NOT MATCH a real boot") << std::endl;
+    delete booted;
+    delete restored;
+    return count == 0;
+}
+
+void writeBytes(FILE *fp, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        fprintf(fp, "%s0x%02x,%s", i % 12 == 0 ? "  " : "", data[i], i % 12 == 11 || i == length - 1 ? "\n" : " ");
+    }
+}
+
+void writeImage(FILE *fp, models_enum model, const char *name) {
+    ZXSpectrum *machine = newMachine(model);
+    bootToTapeLoader(machine);
+    MachineState state = capture(machine);
+    const BootImage &image = state.image;
+    std::vector<uint8_t> ram;
+    for (size_t offset = 0; offset < state.ram.size(); offset += 0x4000) {
+        compressBank(state.ram.data() + offset, ram);
+    }
+    std::cout << name << ": " << state.ram.size() << " bytes of RAM compressed to " << ram.size() << std::endl;
+    fprintf(fp, "static const uint8_t %sRam[] = {\n", name);
+    writeBytes(fp, ram.data(), ram.size());
+    fprintf(fp, "};\n\n");
+    fprintf(fp, "extern const BootImage %s = {\n", name);
+    fprintf(fp, "  %u, %d, 0x%08x,\n", image.version, image.model, image.romHash);
+    fprintf(fp, "  0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x, 0x%04x,\n",
+        image.AF, image.BC, image.DE, image.HL, image.IX, image.IY, image.PC, image.SP, image.R);
+    fprintf(fp, "  0x%04x, 0x%04x, 0x%04x, 0x%04x,\n", image.AFs, image.BCs, image.DEs, image.HLs);
+    fprintf(fp, "  %d, %d, 0x%02x, %d, %d, %d, %d,\n",
+        image.IFF1, image.IFF2, image.I, image.halted, image.IM, image.IRequest, image.cycles);
+    fprintf(fp, "  %d, 0x%02x, 0x%02x, %s, %s, %d,\n", image.borderColor, image.soundBits, image.hwBank,
+        image.micLevel ? "true" : "false", image.romLoadingRoutineHit ? "true" : "false", image.tstates);
+    fprintf(fp, "  {");
+    for (int i = 0; i < 16; i++) {
+        fprintf(fp, "0x%02x%s", image.ayRegisters[i], i < 15 ? ", " : "},\n");
+    }
+    fprintf(fp, "  %sRam, sizeof(%sRam)};\n", name, name);
+    delete machine;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " boot_images.cpp | --check" << std::endl;
+        return 1;
+    }
+    if (std::string(argv[1]) == "--check") {
+        bool ok = check(SPECMDL_48K, "48K");
+        ok = check(SPECMDL_128K, "128K") && ok;
+        return ok ? 0 : 1;
+    }
+    FILE *fp = fopen(argv[1], "w");
+    if (!fp) {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+    fprintf(fp, "// Made by desktop/src/make_boot_images.cpp - run make -f Makefile.bootimages in desktop to remake it\n");
+    fprintf(fp, "#include \"BootImage.h\"\n\n");
+    writeImage(fp, SPECMDL_48K, "bootImage48k");
+    fprintf(fp, "\n");
+    writeImage(fp, SPECMDL_128K, "bootImage128k");
+    fclose(fp);
+    return 0;
+}
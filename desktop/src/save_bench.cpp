@@ -0,0 +1,186 @@
+// Checks that saving to a TAP file writes what the ROM saved.
+//
+// Each case is a little program that calls SA-BYTES (0x04C2) to save a block. It runs once with the save
+// trapped by ZXSpectrum::trapSaveBlock and once with the ROM playing the block out of the MIC socket for the
+// TapeRecorder to decode from the edges. Both TAP files have to hold exactly the flag, data and parity that
+// were asked for, and the registers have to be the same when SA-BYTES returns. The cases cover a header, data
+// blocks of different sizes, a block with just the flag and a CODE block that runs past the end of memory.
+//
+//   save_bench
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "spectrum.h"
+
+// where the program is and where it ends up when SA-BYTES returns
+const uint16_t PROGRAM = 0x8000;
+const uint16_t DONE = PROGRAM + 0x14;
+const uint16_t STACK = PROGRAM;
+const char *TAPE = "/tmp/save_bench.tap";
+
+struct Case {
+    const char *name;
+    uint8_t flag;
+    uint16_t start;
+    int length;
+};
+
+const Case cases[] = {
+    {"header", 0x00, 0x9000, 17},
+    {"1 byte", 0xFF, 0x9000, 1},
+    {"just a flag", 0xFF, 0x9000, 0},
+    {"100 bytes", 0xFF, 0x9000, 100},
+    {"a screen", 0xFF, 0x4000, 6912},
+    {"CODE 65000,1000", 0xFF, 65000, 1000},
+};
+
+// the emulator logs what it's doing - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+struct Result {
+    Z80Regs regs;
+    // what a TAP file with the block in it should hold and what was written
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> tape;
+    int frames;
+};
+
+std::vector<uint8_t> readFile(const char *filename) {
+    std::vector<uint8_t> data;
+    FILE *fp = fopen(filename, "rb");
+    if (fp) {
+        int value;
+        while ((value = fgetc(fp)) != EOF) {
+            data.push_back(value);
+        }
+        fclose(fp);
+    }
+    return data;
+}
+
+Result run(const Case &test, bool trap) {
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(SPECMDL_48K);
+    machine->reset_spectrum(machine->z80Regs);
+    for (int frame = 0; frame < 100; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    // DI, IM 2, LD A,FE, LD I,A, LD IX,start, LD DE,length, LD A,flag, CALL SA-BYTES, DI, JR $ - the
+    // interrupts go to an EI, RETI so they leave everything alone
+    const uint8_t program[] = {0xF3, 0xED, 0x5E, 0x3E, 0xFE, 0xED, 0x47, 0xDD, 0x21, (uint8_t) (test.start & 0xFF),
+        (uint8_t) (test.start >> 8), 0x11, (uint8_t) (test.length & 0xFF), (uint8_t) (test.length >> 8), 0x3E,
+        test.flag, 0xCD, 0xC2, 0x04, 0xF3, 0x18, 0xFE};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        machine->z80_poke(PROGRAM + i, program[i]);
+    }
+    for (int address = 0xFE00; address <= 0xFF00; address++) {
+        machine->z80_poke(address, 0xFD);
+    }
+    machine->z80_poke(0xFDFD, 0xFB);
+    machine->z80_poke(0xFDFE, 0xED);
+    machine->z80_poke(0xFDFF, 0x4D);
+    for (int i = 0; i < 6912; i++) {
+        machine->z80_poke(0x4000 + i, rand());
+    }
+    for (int i = 0; i < 0x1000; i++) {
+        machine->z80_poke(0x9000 + i, rand());
+    }
+    machine->z80Regs->SP.W = STACK;
+    machine->z80Regs->PC.W = PROGRAM;
+
+    Result result;
+    std::vector<uint8_t> block = {test.flag};
+    uint8_t parity = test.flag;
+    for (int i = 0; i < test.length; i++) {
+        block.push_back(machine->z80_peek((uint16_t) (test.start + i)));
+        parity ^= block.back();
+    }
+    block.push_back(parity);
+    result.expected = {(uint8_t) (block.size() & 0xFF), (uint8_t) (block.size() >> 8)};
+    result.expected.insert(result.expected.end(), block.begin(), block.end());
+
+    remove(TAPE);
+    machine->tapeRecorder.setFilename(TAPE);
+    machine->tapeRecorder.setTrapSaves(trap);
+    // a screen takes about 15 seconds to save
+    for (result.frames = 0; result.frames < 50 * 60 && machine->z80Regs->PC.W != DONE; result.frames++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    result.regs = *machine->z80Regs;
+    // the recorder finishes a block once the MIC has been quiet for a while
+    for (int frame = 0; frame < 5; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    result.tape = readFile(TAPE);
+    remove(TAPE);
+    delete machine;
+    return result;
+}
+
+// the registers that differ - and an empty string if they're the same
+std::string differences(const Z80Regs &rom, const Z80Regs &trap) {
+    std::string different;
+    auto check = [&](const char *name, uint16_t a, uint16_t b) {
+        if (a != b) {
+            char text[40];
+            snprintf(text, sizeof(text), " %s %04X/%04X", name, a, b);
+            different += text;
+        }
+    };
+    check("AF", rom.AF.W, trap.AF.W);
+    check("BC", rom.BC.W, trap.BC.W);
+    check("DE", rom.DE.W, trap.DE.W);
+    check("HL", rom.HL.W, trap.HL.W);
+    check("IX", rom.IX.W, trap.IX.W);
+    check("SP", rom.SP.W, trap.SP.W);
+    check("PC", rom.PC.W, trap.PC.W);
+    check("IFF", rom.IFF1, trap.IFF1);
+    return different;
+}
+
+int main() {
+    printf("%-20s %8s %8s %8s %8s  %s\n", "case", "bytes", "frames", "trapped", "decoded", "check");
+    int failures = 0;
+    for (const Case &test : cases) {
+        srand(test.length);
+        int saved = quiet();
+        Result rom = run(test, false);
+        srand(test.length);
+        Result trap = run(test, true);
+        loud(saved);
+        std::string different = differences(rom.regs, trap.regs);
+        if (rom.regs.PC.W != DONE || trap.regs.PC.W != DONE) {
+            different += " (SA-BYTES never returned)";
+        }
+        bool trapOk = trap.tape == trap.expected;
+        bool romOk = rom.tape == rom.expected;
+        if (!trapOk) {
+            different += " trapped tape is wrong";
+        }
+        if (!romOk) {
+            different += " decoded tape is wrong";
+        }
+        printf("%-20s %8zu %8d %8s %8s  %s%s\n", test.name, trap.expected.size(), rom.frames, trapOk ? "ok" : "bad",
+            romOk ? "ok" : "bad", different.empty() ? "ok" : "FAILED", different.c_str());
+        failures += different.empty() ? 0 : 1;
+    }
+    printf("%s\n", failures == 0 ? "All ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+// Times how long it takes to load snapshots - from memory and from files - using a corpus of synthetic
+// snapshots, and checks that each one loads back exactly the memory it was made from.
+//
+// Then it saves machines with awkward memory - runs of EDs, an ED on its own or at the end of a page, and pages
+// that don't compress - through the compressing .z80 writers. The file and memory writers have to give the same
+// bytes and loading them has to give back the same memory, registers and paging. The sizes and times are reported.
+//
+//   snapshot_bench [snapshots per format]
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "spectrum.h"
+#include "snaps.h"
+
+struct Snapshot {
+    std::string name;
+    SnapshotFormat format;
+    models_enum model;
+    std::vector<uint8_t> data;
+    // what the RAM banks should hold once it has loaded
+    std::vector<uint8_t> banks[8];
+};
+
+ZXSpectrum *newMachine(models_enum model) {
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(model);
+    machine->reset_spectrum(machine->z80Regs);
+    return machine;
+}
+
+// something that looks a bit like a game - empty space, repeated graphics, code and the odd run of EDs
+void fillBank(uint8_t *data) {
+    int i = 0;
+    while (i < 0x4000) {
+        int kind = rand() % 8;
+        int length = 1 + rand() % 1024;
+        uint8_t tile[8];
+        for (int t = 0; t < 8; t++) {
+            tile[t] = rand();
+        }
+        for (int k = 0; k < length && i < 0x4000; k++, i++) {
+            switch (kind) {
+            case 0:
+            case 1:
+                data[i] = 0;
+                break;
+            case 2:
+                data[i] = tile[k & 7];
+                break;
+            case 3:
+                data[i] = 0xED;
+                break;
+            default:
+                data[i] = rand();
+                break;
+            }
+        }
+    }
+}
+
+// the corners of the ED ED run-length encoding
+void fillAwkwardBank(uint8_t *data) {
+    switch (rand() % 4) {
+    case 0:
+        // lone EDs, EDs followed by a run and pairs that have to be escaped
+        for (int i = 0; i < 0x4000; i++) {
+            const uint8_t pattern[8] = {0xED, 0x00, 0xED, 0xED, 0x00, 0xED, 0x00, 0x00};
+            data[i] = rand() % 4 ? pattern[i & 7] : rand();
+        }
+        break;
+    case 1:
+        // a page that ends on an ED
+        fillBank(data);
+        data[0x3FFF] = 0xED;
+        data[0x3FFE] = rand();
+        break;
+    case 2:
+        // nothing to compress
+        for (int i = 0; i < 0x4000; i++) {
+            data[i] = rand();
+        }
+        break;
+    default:
+        fillBank(data);
+        break;
+    }
+}
+
+void saveBanks(ZXSpectrum *machine, Snapshot &snapshot) {
+    for (int i = 0; i < 8; i++) {
+        snapshot.banks[i].assign(machine->mem.banks[i]->data, machine->mem.banks[i]->data + 0x4000);
+    }
+}
+
+Snapshot makeZ80(models_enum model, int index) {
+    ZXSpectrum *machine = newMachine(model);
+    for (int i = 0; i < 8; i++) {
+        fillBank(machine->mem.banks[i]->data);
+    }
+    machine->z80Regs->PC.W = 0x8000 + index;
+    if (model == SPECMDL_128K) {
+        machine->mem.page(index & 0x07, true);
+    }
+    Snapshot snapshot;
+    snapshot.name = "snapshot" + std::to_string(index) + (model == SPECMDL_128K ? "-128k.z80" : "-48k.z80");
+    snapshot.format = SNAPSHOT_Z80;
+    snapshot.model = model;
+    Z80MemoryWriter writer(machine);
+    writer.saveZ80();
+    snapshot.data.assign(writer.data(), writer.data() + writer.size());
+    saveBanks(machine, snapshot);
+    delete machine;
+    return snapshot;
+}
+
+Snapshot makeSNA(models_enum model, int index) {
+    ZXSpectrum *machine = newMachine(model);
+    for (int i = 0; i < 8; i++) {
+        fillBank(machine->mem.banks[i]->data);
+    }
+    Snapshot snapshot;
+    snapshot.name = "snapshot" + std::to_string(index) + (model == SPECMDL_128K ? "-128k.sna" : "-48k.sna");
+    snapshot.format = SNAPSHOT_SNA;
+    snapshot.model = model;
+    uint8_t header[27] = {0};
+    // SP at 0xFF00 - the 48K snapshot has the PC on the stack
+    header[23] = 0x00;
+    header[24] = 0xFF;
+    snapshot.data.assign(header, header + 27);
+    int current = index & 0x07;
+    if (model == SPECMDL_48K) {
+        machine->mem.banks[0]->data[0x3F00] = 0x00;
+        machine->mem.banks[0]->data[0x3F01] = 0x80;
+    }
+    const int first[3] = {5, 2, model == SPECMDL_128K ? current : 0};
+    for (int i = 0; i < 3; i++) {
+        const uint8_t *data = machine->mem.banks[first[i]]->data;
+        snapshot.data.insert(snapshot.data.end(), data, data + 0x4000);
+    }
+    if (model == SPECMDL_128K) {
+        snapshot.data.insert(snapshot.data.end(), {0x00, 0x80, (uint8_t) current, 0});
+        for (int i = 0; i < 8; i++) {
+            if (i != 5 && i != 2 && i != current) {
+                const uint8_t *data = machine->mem.banks[i]->data;
+                snapshot.data.insert(snapshot.data.end(), data, data + 0x4000);
+            }
+        }
+    }
+    saveBanks(machine, snapshot);
+    delete machine;
+    return snapshot;
+}
+
+bool matches(ZXSpectrum *machine, const Snapshot &snapshot) {
+    const int banks48k[3] = {5, 2, 0};
+    int count = snapshot.model == SPECMDL_128K ? 8 : 3;
+    for (int i = 0; i < count; i++) {
+        int bank = snapshot.model == SPECMDL_128K ? i : banks48k[i];
+        if (memcmp(machine->mem.banks[bank]->data, snapshot.banks[bank].data(), 0x4000) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the loaders log what they're doing - keep that out of the timings
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 20;
+    srand(1234);
+    int saved = quiet();
+    std::vector<Snapshot> corpus;
+    for (int i = 0; i < count; i++) {
+        corpus.push_back(makeZ80(SPECMDL_48K, i));
+        corpus.push_back(makeZ80(SPECMDL_128K, i));
+        corpus.push_back(makeSNA(SPECMDL_48K, i));
+        corpus.push_back(makeSNA(SPECMDL_128K, i));
+    }
+    const char *kinds[4] = {"z80 48K", "z80 128K", "sna 48K", "sna 128K"};
+    double memoryTime[4] = {0};
+    double fileTime[4] = {0};
+    size_t bytes[4] = {0};
+    int failures = 0;
+    ZXSpectrum *machines[2] = {newMachine(SPECMDL_48K), newMachine(SPECMDL_128K)};
+    for (size_t i = 0; i < corpus.size(); i++) {
+        const Snapshot &snapshot = corpus[i];
+        int kind = i % 4;
+        ZXSpectrum *machine = machines[snapshot.model == SPECMDL_128K ? 1 : 0];
+        bytes[kind] += snapshot.data.size();
+        auto start = std::chrono::high_resolution_clock::now();
+        bool loaded = Load(machine, snapshot.data.data(), snapshot.data.size(), snapshot.format);
+        auto end = std::chrono::high_resolution_clock::now();
+        memoryTime[kind] += std::chrono::duration<double, std::micro>(end - start).count();
+        if (!loaded || !matches(machine, snapshot)) {
+            fprintf(stderr, "%s did not load from memory\n", snapshot.name.c_str());
+            failures++;
+        }
+        std::string filename = "/tmp/" + snapshot.name;
+        FILE *fp = fopen(filename.c_str(), "wb");
+        fwrite(snapshot.data.data(), 1, snapshot.data.size(), fp);
+        fclose(fp);
+        start = std::chrono::high_resolution_clock::now();
+        loaded = Load(machine, filename.c_str());
+        end = std::chrono::high_resolution_clock::now();
+        fileTime[kind] += std::chrono::duration<double, std::micro>(end - start).count();
+        if (!loaded || !matches(machine, snapshot)) {
+            fprintf(stderr, "%s did not load from file\n", snapshot.name.c_str());
+            failures++;
+        }
+        remove(filename.c_str());
+    }
+    loud(saved);
+    printf("%-10s %12s %14s %14s\n", "format", "avg bytes", "memory (us)", "file (us)");
+    for (int kind = 0; kind < 4; kind++) {
+        printf("%-10s %12zu %14.1f %14.1f\n", kinds[kind], bytes[kind] / count, memoryTime[kind] / count, fileTime[kind] / count);
+    }
+    printf("%d snapshots, %d failed to load\n", (int) corpus.size(), failures);
+    saved = quiet();
+    delete machines[0];
+    delete machines[1];
+    loud(saved);
+
+    // saving
+    printf("\n%-10s %12s %12s %14s %14s\n", "writing", "avg bytes", "raw bytes", "memory (us)", "file (us)");
+    for (models_enum model : {SPECMDL_48K, SPECMDL_128K}) {
+        size_t written = 0;
+        double writeMemoryTime = 0;
+        double writeFileTime = 0;
+        int bad = 0;
+        for (int i = 0; i < count; i++) {
+            saved = quiet();
+            ZXSpectrum *machine = newMachine(model);
+            for (int bank = 0; bank < 8; bank++) {
+                fillAwkwardBank(machine->mem.banks[bank]->data);
+            }
+            machine->z80Regs->PC.W = 0x8000 + i;
+            machine->z80Regs->SP.W = 0xFF00 - i;
+            machine->z80Regs->HLs.W = rand();
+            if (model == SPECMDL_128K) {
+                machine->mem.page(i & 0x07, true);
+            }
+            Snapshot snapshot;
+            snapshot.model = model;
+            saveBanks(machine, snapshot);
+            auto start = std::chrono::high_resolution_clock::now();
+            Z80MemoryWriter memoryWriter(machine);
+            memoryWriter.saveZ80();
+            auto end = std::chrono::high_resolution_clock::now();
+            writeMemoryTime += std::chrono::duration<double, std::micro>(end - start).count();
+            std::string filename = "/tmp/snapshot_bench.z80";
+            start = std::chrono::high_resolution_clock::now();
+            Z80FileWriter fileWriter(machine, filename.c_str());
+            fileWriter.saveZ80();
+            end = std::chrono::high_resolution_clock::now();
+            writeFileTime += std::chrono::duration<double, std::micro>(end - start).count();
+            written += memoryWriter.size();
+            std::vector<uint8_t> file(memoryWriter.size() + 1);
+            FILE *fp = fopen(filename.c_str(), "rb");
+            file.resize(fp ? fread(file.data(), 1, file.size(), fp) : 0);
+            if (fp) {
+                fclose(fp);
+            }
+            remove(filename.c_str());
+            bool same = file.size() == memoryWriter.size() && memcmp(file.data(), memoryWriter.data(), file.size()) == 0;
+            ZXSpectrum *loaded = newMachine(model);
+            same = same && Load(loaded, memoryWriter.data(), memoryWriter.size(), SNAPSHOT_Z80) && matches(loaded, snapshot);
+            same = same && loaded->z80Regs->PC.W == machine->z80Regs->PC.W && loaded->z80Regs->SP.W == machine->z80Regs->SP.W &&
+                loaded->z80Regs->HLs.W == machine->z80Regs->HLs.W && loaded->mem.hwBank == machine->mem.hwBank;
+            delete loaded;
+            delete machine;
+            loud(saved);
+            if (!same) {
+                fprintf(stderr, "%s snapshot %d didn't save and load back\n", model == SPECMDL_128K ? "128K" : "48K", i);
+                bad++;
+            }
+        }
+        // what it was before the pages were compressed
+        size_t raw = 30 + 54 + 2 + (model == SPECMDL_128K ? 8 : 3) * (3 + 0x4000);
+        printf("%-10s %12zu %12zu %14.1f %14.1f\n", model == SPECMDL_128K ? "z80 128K" : "z80 48K", written / count, raw,
+            writeMemoryTime / count, writeFileTime / count);
+        failures += bad;
+    }
+    printf("%d snapshots saved, %s\n", count * 2, failures == 0 ? "all ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
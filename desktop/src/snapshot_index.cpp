@@ -0,0 +1,329 @@
+// Builds the index the game picker shows its thumbnails from for a folder of games that are already there - the
+// emulator only adds to it when it saves a snapshot or caches a tape. Snapshots are loaded and tapes are played
+// until they've finished, then the screen is taken for the thumbnail.
+//
+// Then it times what the picker does with the index - opening it and reading the thumbnail of every game - against
+// opening and loading every game to get at its screen. Tapes are hashed to name their cached snapshot, so it times
+// finding the hash in the index against hashing the tape and checks they agree.
+//
+// Before that it checks how the model a game needs is worked out (see ModelDetection.h). It makes up tapes with BASIC
+// and code that do or don't page memory or play the AY and snapshots of both sizes, tapes with the paging code across
+// the edge of each chunk that's read, and random data that shouldn't look like it needs a 128K.
+//
+//   snapshot_index folder
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "spectrum.h"
+#include "snaps.h"
+#include "BootImage.h"
+#include "SnapshotIndex.h"
+#include "ModelDetection.h"
+#include "loadgame.h"
+
+std::string extensionOf(const std::string &filename) {
+    size_t dot = filename.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : filename.substr(dot + 1);
+    for (char &c : extension) {
+        c = tolower(c);
+    }
+    return extension;
+}
+
+// the emulator logs what it's doing - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+const char *modelName(models_enum model) {
+    return model == SPECMDL_128K ? "128K" : model == SPECMDL_48K ? "48K" : "?";
+}
+
+void writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp) {
+        fwrite(data.data(), 1, data.size(), fp);
+        fclose(fp);
+    }
+}
+
+// a TAP with a header block and then a data block
+std::vector<uint8_t> makeTap(const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> tap = {19, 0, 0x00};
+    tap.insert(tap.end(), 17, ' ');
+    tap.push_back(0);
+    tap.push_back((data.size() + 2) & 0xFF);
+    tap.push_back((data.size() + 2) >> 8);
+    tap.push_back(0xFF);
+    tap.insert(tap.end(), data.begin(), data.end());
+    tap.push_back(0);
+    return tap;
+}
+
+// the model detectModel gives for a file with these contents
+models_enum detectFile(const std::string &path, const std::vector<uint8_t> &data, double *time) {
+    writeFile(path, data);
+    auto start = std::chrono::high_resolution_clock::now();
+    models_enum model = detectModel(path.c_str());
+    *time = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    remove(path.c_str());
+    return model;
+}
+
+// returns the number of checks that failed
+int checkModelDetection() {
+    struct Case {
+        const char *name;
+        const char *extension;
+        std::vector<uint8_t> data;
+        models_enum expected;
+    };
+    // code that isn't anything much - nothing above 0x3F so no OUT token or high byte of a port
+    std::vector<uint8_t> code(20000);
+    srand(1);
+    for (uint8_t &value : code) {
+        value = rand() & 0x3F;
+    }
+    std::vector<uint8_t> ayCode = code;
+    // LD BC,0xFFFD LD A,7 OUT (C),A
+    const uint8_t selectAy[] = {0x01, 0xFD, 0xFF, 0x3E, 0x07, 0xED, 0x79};
+    std::copy(selectAy, selectAy + sizeof(selectAy), ayCode.begin() + 15000);
+    std::vector<uint8_t> pagingCode = code;
+    // LD BC,0x7FFD OUT (C),0 - ED 71
+    const uint8_t page[] = {0x01, 0xFD, 0x7F, 0xED, 0x71};
+    std::copy(page, page + sizeof(page), pagingCode.begin() + 6000);
+    // LD BC,0x7FFD and then nothing that does an OUT (C)
+    std::vector<uint8_t> noOut = code;
+    std::copy(page, page + 3, noOut.begin() + 6000);
+    std::vector<Case> cases = {
+        // 10 OUT 32765,16 and 10 OUT 254,16 - each number is followed by its hidden binary form
+        {"BASIC OUT 32765", "tap", makeTap({0, 10, 16, 0, 0xDF, '3', '2', '7', '6', '5', 0x0E, 0, 0, 0xFD, 0x7F, 0, ',', '1', '6',
+            0x0E, 0, 0, 16, 0, 0, 0x0D}), SPECMDL_128K},
+        {"BASIC OUT 65533", "tap", makeTap({0, 10, 16, 0, 0xDF, ' ', '6', '5', '5', '3', '3', 0x0E, 0, 0, 0xFD, 0xFF, 0, ',', '7',
+            0x0E, 0, 0, 7, 0, 0, 0x0D}), SPECMDL_128K},
+        {"BASIC OUT 254", "tap", makeTap({0, 10, 14, 0, 0xDF, '2', '5', '4', 0x0E, 0, 0, 0xFE, 0, 0, ',', '1', '6', 0x0E, 0, 0, 16,
+            0, 0, 0x0D}), SPECMDL_48K},
+        {"code selects an AY register", "tap", makeTap(ayCode), SPECMDL_128K},
+        {"code pages memory", "tap", makeTap(pagingCode), SPECMDL_128K},
+        {"LD BC,0x7FFD and no OUT", "tap", makeTap(noOut), SPECMDL_48K},
+        {"48K code", "tap", makeTap(code), SPECMDL_48K},
+        {"128K .sna", "sna", std::vector<uint8_t>(131103), SPECMDL_128K},
+        {"48K .sna", "sna", std::vector<uint8_t>(49179), SPECMDL_48K},
+        {"not a game", "txt", code, SPECMDL_UNKNOWN},
+    };
+    std::string path = "/tmp/snapshot_index_model";
+    int failures = 0;
+    printf("%-32s %8s %8s %10s %8s\n", "model detection", "expected", "found", "time (us)", "check");
+    for (const Case &test : cases) {
+        double time;
+        models_enum model = detectFile(path + "." + test.extension, test.data, &time);
+        printf("%-32s %8s %8s %10.1f %8s\n", test.name, modelName(test.expected), modelName(model), time,
+            model == test.expected ? "ok" : "FAILED");
+        failures += model == test.expected ? 0 : 1;
+    }
+
+    // tapes are read a chunk at a time - put the paging code across the end of the first one
+    int missed = 0;
+    int tries = 0;
+    for (int at = 4096 - 16; at < 4096 + 4; at++, tries++) {
+        std::vector<uint8_t> tape(12000, 0);
+        const uint8_t pageAndOut[] = {0x01, 0xFD, 0x7F, 0x3E, 0x10, 0xED, 0x79};
+        std::copy(pageAndOut, pageAndOut + sizeof(pageAndOut), tape.begin() + at);
+        double time;
+        missed += detectFile(path + ".tap", tape, &time) == SPECMDL_128K ? 0 : 1;
+    }
+    printf("%-32s %8d %8d %10s %8s\n", "across a chunk edge", tries, tries - missed, "", missed == 0 ? "ok" : "FAILED");
+    failures += missed == 0 ? 0 : 1;
+
+    // random data should hardly ever look like it needs a 128K
+    std::vector<uint8_t> noise(64 * 1024);
+    int flagged = 0;
+    int chunks = 256;
+    double noiseTime = 0;
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        for (uint8_t &value : noise) {
+            value = rand();
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        flagged += tapeNeeds128K(noise.data(), noise.size()) ? 1 : 0;
+        noiseTime += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    printf("%-32s %8d %8d %10s %8s\n", "random 64K chunks flagged", 0, flagged, "", flagged == 0 ? "ok" : "FAILED");
+    printf("Searching random data: %.1fMB/s\n\n", chunks * noise.size() / noiseTime);
+    failures += flagged == 0 ? 0 : 1;
+    return failures;
+}
+
+// load a game the way the emulator would - returns false if it isn't one we can load
+bool loadForThumbnail(ZXSpectrum *machine, const std::string &path) {
+    models_enum model = detectModel(path.c_str());
+    machine->reset();
+    machine->init_spectrum(model == SPECMDL_128K ? SPECMDL_128K : SPECMDL_48K);
+    machine->reset_spectrum(machine->z80Regs);
+    std::string extension = extensionOf(path);
+    if (extension == "z80" || extension == "sna") {
+        return Load(machine, path.c_str());
+    }
+    if (extension != "tap" && extension != "tzx") {
+        return false;
+    }
+    readyToLoad(machine);
+    if (!insertTape(path, machine, true)) {
+        return false;
+    }
+    // give up after ten minutes of tape
+    for (int frame = 0; frame < 50 * 600 && !machine->tapeDeck.isFinished(); frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    // let the game draw its screen
+    for (int frame = 0; frame < 100; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " folder" << std::endl;
+        return 1;
+    }
+    std::string folder = argv[1];
+    while (folder.size() > 1 && folder.back() == '/') {
+        folder.pop_back();
+    }
+    std::vector<std::string> names;
+    DIR *dir = opendir(folder.c_str());
+    if (!dir) {
+        std::cerr << "Can't open " << folder << std::endl;
+        return 1;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        std::string extension = extensionOf(entry->d_name);
+        if (entry->d_name[0] != '.' && (extension == "z80" || extension == "sna" || extension == "tap" || extension == "tzx")) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    int failures = checkModelDetection();
+
+    // build the index
+    ZXSpectrum *machine = new ZXSpectrum();
+    std::vector<SnapshotIndex::Entry> entries;
+    std::vector<uint8_t> thumbnails;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const std::string &name : names) {
+        std::string path = folder + "/" + name;
+        int saved = quiet();
+        bool loaded = loadForThumbnail(machine, path);
+        loud(saved);
+        if (!loaded) {
+            printf("Couldn't load %s\n", name.c_str());
+            continue;
+        }
+        struct stat st;
+        SnapshotIndex::Entry entry;
+        entry.name = name;
+        entry.model = machine->hwopt.hw_model;
+        bool found = stat(path.c_str(), &st) == 0;
+        entry.saveTime = found ? st.st_mtime : 0;
+        entry.fileSize = found ? st.st_size : 0;
+        // tapes are hashed to name their cached snapshot - keep it so the emulator doesn't have to hash them again
+        if (extensionOf(name) == "tap" || extensionOf(name) == "tzx") {
+            entry.fileTime = found ? st.st_mtime : 0;
+            entry.contentHash = SnapshotIndex::hashFile(path);
+        }
+        entries.push_back(entry);
+        thumbnails.resize(entries.size() * SnapshotIndex::THUMBNAIL_SIZE);
+        SnapshotIndex::makeThumbnail(machine->mem.currentScreen->data, &thumbnails[thumbnails.size() - SnapshotIndex::THUMBNAIL_SIZE]);
+    }
+    if (!SnapshotIndex::addEntries(folder, entries, thumbnails.data())) {
+        return 1;
+    }
+    double buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // what the picker does - open the index and read the thumbnails
+    start = std::chrono::high_resolution_clock::now();
+    SnapshotIndex index;
+    index.open(folder);
+    double openTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    uint8_t thumbnail[SnapshotIndex::THUMBNAIL_SIZE];
+    int mismatches = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < entries.size(); i++) {
+        const SnapshotIndex::Entry *entry = index.find(entries[i].name);
+        if (!entry || !index.readThumbnail(entry, thumbnail) ||
+            memcmp(thumbnail, &thumbnails[i * SnapshotIndex::THUMBNAIL_SIZE], SnapshotIndex::THUMBNAIL_SIZE) != 0) {
+            mismatches++;
+        }
+    }
+    double thumbnailTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // what picking a tape does to find its cached snapshot - with the hash from the index and hashing the tape
+    int tapes = 0;
+    int wrongHashes = 0;
+    double lookupTime = 0;
+    double hashTime = 0;
+    for (const SnapshotIndex::Entry &entry : entries) {
+        if (entry.contentHash == 0) {
+            continue;
+        }
+        std::string path = folder + "/" + entry.name;
+        start = std::chrono::high_resolution_clock::now();
+        uint64_t indexed = SnapshotIndex::contentHash(path);
+        lookupTime += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        uint64_t hashed = SnapshotIndex::hashFile(path);
+        hashTime += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        wrongHashes += indexed == entry.contentHash && hashed == entry.contentHash ? 0 : 1;
+        tapes++;
+    }
+
+    // what it would have to do without the index - just the snapshots as the tapes would have to be played
+    int snapshots = 0;
+    start = std::chrono::high_resolution_clock::now();
+    int saved = quiet();
+    for (const SnapshotIndex::Entry &entry : entries) {
+        std::string extension = extensionOf(entry.name);
+        if (extension == "z80" || extension == "sna") {
+            loadForThumbnail(machine, folder + "/" + entry.name);
+            snapshots++;
+        }
+    }
+    loud(saved);
+    double loadTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+
+    struct stat st;
+    stat((folder + "/" SNAPSHOT_INDEX_NAME).c_str(), &st);
+    printf("Indexed %zu games in %.0fms - the index is %lld bytes\n", entries.size(), buildTime, (long long) st.st_size);
+    printf("Opening the index: %.1fus\n", openTime);
+    printf("Reading a thumbnail: %.1fus\n", entries.empty() ? 0 : thumbnailTime / entries.size());
+    printf("Loading a snapshot instead: %.1fus\n", snapshots == 0 ? 0 : loadTime / snapshots);
+    printf("Thumbnails %s\n", mismatches == 0 ? "ok" : "FAILED");
+    printf("Finding a tape's hash in the index: %.1fus\n", tapes == 0 ? 0 : lookupTime / tapes);
+    printf("Hashing the tape instead: %.1fus\n", tapes == 0 ? 0 : hashTime / tapes);
+    printf("Tape hashes %s\n", wrongHashes == 0 ? "ok" : "FAILED");
+    delete machine;
+    return mismatches == 0 && wrongHashes == 0 && failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,424 @@
+// Checks and times the sound generation.
+//
+// The AY generator works out how long the output stays the same and adds up whole runs at a time - this runs
+// it against the reference that steps every counter one chip tact at a time from thousands of random register
+// states and checks the samples and the counters they leave behind are identical. Then it times both on some
+// typical mixes and times a 128K frame with the AY playing.
+//
+// Register writes are logged with their t-state and applied when the frame is rendered - this checks each one
+// takes effect at the sample it was written on, including when there are too many to fit in the log.
+//
+// The beeper turns each speaker transition into a band limited step. Square waves are played through it and
+// through averaging the speaker over each sample as the emulator used to, and the loudest harmonic that aliases
+// back into the audible band is measured for both. Then it times a frame of the beeper.
+//
+// The desktop build resamples the output to the sound card's rate. Tones are put through the resampler and through
+// the linear interpolation it replaced, and the loudest image of each tone is measured along with the time taken.
+//
+//   sound_bench [--states N] [--frames N]
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cmath>
+#include "spectrum.h"
+#include "Beeper.h"
+#include "Resampler.h"
+#include "../AYSound/AySound.h"
+
+// the emulator logs what it's doing - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+double microsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// the generator state - zeroed first so the padding compares equal too
+ayemu_state_t generatorState() {
+    ayemu_state_t state;
+    memset(&state, 0, sizeof(state));
+    AySound::getState(&state);
+    return state;
+}
+
+// a random change to the registers - biased towards the kind of values games use. Returns the register
+int randomWrite(ayemu_state_t &state) {
+    int reg = rand() % 14;
+    int value = rand() & 0xff;
+    if (reg == 1 || reg == 3 || reg == 5) {
+        value &= rand() % 2 ? 0x0f : 0x01;
+    }
+    if (reg == 11 && rand() % 3 == 0) {
+        value = rand() % 4;
+    }
+    if (reg == 12 && rand() % 2) {
+        value = 0;
+    }
+    state.regs[reg] = state.cpuRegs[reg] = value;
+    if (reg == 13) {
+        // writing the shape restarts the envelope
+        state.env_pos = state.cnt_e = 0;
+    }
+    return reg;
+}
+
+// run both generators from the same state - returns false if they differ
+bool compareGenerators(const ayemu_state_t &start, int count, int position, double &perTactTime, double &runsTime) {
+    uint8_t expected[SAMPLES_PER_FRAME];
+    AySound::setState(&start);
+    auto timer = std::chrono::high_resolution_clock::now();
+    AySound::gen_sound_per_tact(count, position);
+    perTactTime += microsSince(timer);
+    memcpy(expected, AySound::SamplebufAY, SAMPLES_PER_FRAME);
+    ayemu_state_t expectedState = generatorState();
+
+    AySound::setState(&start);
+    timer = std::chrono::high_resolution_clock::now();
+    AySound::gen_sound(count, position);
+    runsTime += microsSince(timer);
+    ayemu_state_t state = generatorState();
+    return memcmp(expected + position, AySound::SamplebufAY + position, count) == 0 &&
+        memcmp(&expectedState, &state, sizeof(state)) == 0;
+}
+
+// a frame of random writes through the write log against rendering it a piece at a time and making each
+// write straight to the generator - returns false if they differ
+bool checkWriteLog(int frameTStates) {
+    std::vector<uint32_t> tstates;
+    int count = rand() % 2 ? rand() % 8 : rand() % (AY_WRITE_LOG_SIZE * 2);
+    for (int i = 0; i < count; i++) {
+        tstates.push_back(rand() % frameTStates);
+    }
+    std::sort(tstates.begin(), tstates.end());
+    ayemu_state_t start = generatorState();
+
+    // render up to each write then change the register
+    uint8_t expected[SAMPLES_PER_FRAME];
+    std::vector<std::pair<int, uint8_t>> writes;
+    int rendered = 0;
+    for (uint32_t tstate : tstates) {
+        int sample = (uint64_t) tstate * SAMPLES_PER_FRAME / frameTStates;
+        AySound::gen_sound(sample - rendered, rendered);
+        rendered = sample;
+        ayemu_state_t state = generatorState();
+        int reg = randomWrite(state);
+        state.selectedRegister = reg;
+        writes.push_back({reg, state.regs[reg]});
+        AySound::setState(&state);
+    }
+    AySound::gen_sound(SAMPLES_PER_FRAME - rendered, rendered);
+    memcpy(expected, AySound::SamplebufAY, SAMPLES_PER_FRAME);
+    ayemu_state_t expectedState = generatorState();
+
+    // the same writes through the log
+    AySound::setState(&start);
+    for (size_t i = 0; i < writes.size(); i++) {
+        AySound::selectRegister(writes[i].first);
+        AySound::setRegisterData(writes[i].second, tstates[i]);
+    }
+    AySound::gen_frame();
+    ayemu_state_t state = generatorState();
+    return memcmp(expected, AySound::SamplebufAY, SAMPLES_PER_FRAME) == 0 &&
+        memcmp(&expectedState, &state, sizeof(state)) == 0;
+}
+
+// the beeper's output rate - 312 samples a frame
+const double SAMPLE_RATE = 3500000.0 * SAMPLES_PER_FRAME / FRAME_TSTATES;
+
+// a square wave that changes every halfPeriod t-states through the beeper - or averaged over each sample
+std::vector<double> squareWave(int halfPeriod, int frames, bool bandLimited, double *frameTime = nullptr) {
+    Beeper beeper;
+    std::vector<double> samples;
+    uint8_t buffer[SAMPLES_PER_FRAME];
+    uint64_t transition = halfPeriod;
+    bool level = false;
+    double time = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        // the t-states in this frame the speaker changes on - it starts off
+        uint64_t frameStart = (uint64_t) frame * FRAME_TSTATES;
+        std::vector<int> changes;
+        for (; transition < frameStart + FRAME_TSTATES; transition += halfPeriod) {
+            changes.push_back(transition - frameStart);
+        }
+        if (bandLimited) {
+            auto timer = std::chrono::high_resolution_clock::now();
+            for (int change : changes) {
+                level = !level;
+                beeper.setLevel(change, level);
+            }
+            beeper.endFrame(buffer);
+            time += microsSince(timer);
+            samples.insert(samples.end(), buffer, buffer + SAMPLES_PER_FRAME);
+            continue;
+        }
+        // the old way was a quarter of the t-states the speaker was on for in each sample
+        int on[SAMPLES_PER_FRAME] = {0};
+        changes.push_back(FRAME_TSTATES);
+        int tstate = 0;
+        for (int change : changes) {
+            for (; tstate < change; tstate++) {
+                on[tstate * SAMPLES_PER_FRAME / FRAME_TSTATES] += level;
+            }
+            level = !level;
+        }
+        // the end of the frame isn't a change
+        level = !level;
+        for (int i = 0; i < SAMPLES_PER_FRAME; i++) {
+            samples.push_back(on[i] / 4);
+        }
+    }
+    if (frameTime) {
+        *frameTime = time / frames;
+    }
+    return samples;
+}
+
+// how loud a frequency is in some samples - a hann windowed DFT scaled to the amplitude of a sine
+double amplitude(const std::vector<double> &samples, double frequency, double sampleRate = SAMPLE_RATE) {
+    double re = 0;
+    double im = 0;
+    double windowSum = 0;
+    size_t count = samples.size();
+    for (size_t i = 0; i < count; i++) {
+        double window = 0.5 - 0.5 * cos(2 * M_PI * i / (count - 1));
+        double angle = 2 * M_PI * frequency * i / sampleRate;
+        re += samples[i] * window * cos(angle);
+        im -= samples[i] * window * sin(angle);
+        windowSum += window;
+    }
+    return 2 * sqrt(re * re + im * im) / windowSum;
+}
+
+// the loudest harmonic of the square wave that folds back into the audible band - in dB against its fundamental
+double worstAlias(const std::vector<double> &samples, int halfPeriod) {
+    double fundamental = 3500000.0 / (2 * halfPeriod);
+    double worst = 0;
+    for (int harmonic = 1; harmonic * fundamental < 3500000.0 / 4; harmonic += 2) {
+        if (harmonic * fundamental < SAMPLE_RATE / 2) {
+            continue;
+        }
+        double alias = fmod(harmonic * fundamental, SAMPLE_RATE);
+        alias = alias > SAMPLE_RATE / 2 ? SAMPLE_RATE - alias : alias;
+        // the audible band - and far enough from the real harmonics to measure
+        bool measurable = alias > 100 && alias < 0.4 * SAMPLE_RATE;
+        for (int real = 1; real * fundamental < SAMPLE_RATE / 2; real += 2) {
+            measurable = measurable && fabs(alias - real * fundamental) > 20;
+        }
+        if (measurable) {
+            worst = std::max(worst, amplitude(samples, alias));
+        }
+    }
+    // the fundamental of a square wave from 0 to the volume
+    return 20 * log10(worst / (2 * Beeper::VOLUME / M_PI));
+}
+
+// the loudest image of a tone after resampling - the copies of it either side of the input rate and its harmonics -
+// in dB against the tone
+double worstImage(const std::vector<double> &samples, double tone, double outputRate) {
+    double worst = 0;
+    for (double image : {SAMPLE_RATE - tone, SAMPLE_RATE + tone, 2 * SAMPLE_RATE - tone, 2 * SAMPLE_RATE + tone}) {
+        if (image < outputRate / 2) {
+            worst = std::max(worst, amplitude(samples, image, outputRate));
+        }
+    }
+    return 20 * log10(worst / amplitude(samples, tone, outputRate));
+}
+
+// a tone through the resampler - or through linear interpolation. The start is dropped while the filter fills up
+std::vector<double> resampleTone(double tone, double outputRate, bool polyphase, double &frameTime) {
+    std::vector<uint8_t> input(SAMPLES_PER_FRAME * 60);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = 128 + 100 * sin(2 * M_PI * tone * i / SAMPLE_RATE);
+    }
+    Resampler resampler(SAMPLE_RATE, outputRate);
+    int16_t output[2000];
+    double position = 0;
+    double step = SAMPLE_RATE / outputRate;
+    std::vector<double> samples;
+    double time = 0;
+    for (size_t frame = 0; frame < input.size() / SAMPLES_PER_FRAME; frame++) {
+        const uint8_t *frameInput = &input[frame * SAMPLES_PER_FRAME];
+        int count = 0;
+        auto timer = std::chrono::high_resolution_clock::now();
+        if (polyphase) {
+            count = resampler.process(frameInput, SAMPLES_PER_FRAME, output, 2000);
+        } else {
+            // the last sample of the frame is held as there's nothing after it to interpolate towards
+            for (; position < SAMPLES_PER_FRAME; position += step) {
+                int index = position;
+                double fraction = position - index;
+                int next = index + 1 < SAMPLES_PER_FRAME ? frameInput[index + 1] : frameInput[index];
+                output[count++] = ((frameInput[index] * (1 - fraction) + next * fraction) - 128) * 256;
+            }
+            position -= SAMPLES_PER_FRAME;
+        }
+        time += microsSince(timer);
+        samples.insert(samples.end(), output, output + count);
+    }
+    frameTime = time / (input.size() / SAMPLES_PER_FRAME);
+    return std::vector<double>(samples.begin() + 2000, samples.begin() + 2000 + 8192);
+}
+
+struct Mix {
+    const char *name;
+    uint8_t regs[14];
+};
+
+const Mix mixes[] = {
+    {"silence", {0, 0, 0, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0, 0}},
+    {"one tone", {200, 0, 0, 0, 0, 0, 0, 0x3e, 12, 0, 0, 0, 0, 0}},
+    {"three tones", {200, 0, 44, 1, 144, 1, 0, 0x38, 12, 11, 10, 0, 0, 0}},
+    {"tones and noise", {200, 0, 44, 1, 144, 1, 6, 0x30, 12, 11, 10, 0, 0, 0}},
+    {"envelope", {200, 0, 44, 1, 144, 1, 0, 0x38, 16, 11, 16, 0, 4, 10}},
+    {"high tones", {3, 0, 5, 0, 7, 0, 1, 0x00, 15, 15, 15, 0, 0, 0}},
+};
+
+void setMix(const Mix &mix) {
+    for (int reg = 0; reg < 14; reg++) {
+        AySound::selectRegister(reg);
+        AySound::setRegisterData(mix.regs[reg], 0);
+    }
+    // render a frame so the writes are applied
+    AySound::gen_frame();
+}
+
+int main(int argc, char *argv[]) {
+    int states = 20000;
+    int frames = 3000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--states" && i + 1 < argc) {
+            states = atoi(argv[++i]);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--states N] [--frames N]" << std::endl;
+            return 1;
+        }
+    }
+    int failures = 0;
+
+    // the machine sets up the AY the way the emulator uses it
+    int saved = quiet();
+    ZXSpectrum *machine = new ZXSpectrum();
+    machine->reset();
+    machine->init_spectrum(SPECMDL_128K);
+    machine->reset_spectrum(machine->z80Regs);
+    loud(saved);
+
+    // random register states - part frames as well as whole ones as that's how writes split a frame up
+    srand(1234);
+    AySound::reset();
+    ayemu_state_t state = generatorState();
+    int mismatches = 0;
+    double perTactTime = 0;
+    double runsTime = 0;
+    for (int i = 0; i < states; i++) {
+        for (int writes = rand() % 4; writes > 0; writes--) {
+            randomWrite(state);
+        }
+        int count = 1 + rand() % SAMPLES_PER_FRAME;
+        if (!compareGenerators(state, count, SAMPLES_PER_FRAME - count, perTactTime, runsTime)) {
+            if (mismatches++ < 5) {
+                printf("State %d differs\n", i);
+            }
+        }
+        state = generatorState();
+    }
+    printf("AY generator: %d random states, %s - per tact %.1fms, in runs %.1fms\n", states,
+        mismatches == 0 ? "identical" : "DIFFERENT", perTactTime / 1000, runsTime / 1000);
+    failures += mismatches;
+
+    // writes through the log
+    AySound::reset();
+    mismatches = 0;
+    for (int i = 0; i < states / 10; i++) {
+        if (!checkWriteLog(FRAME_TSTATES) && mismatches++ < 5) {
+            printf("Write log frame %d differs\n", i);
+        }
+    }
+    printf("AY write log: %d frames of random writes, %s\n", states / 10, mismatches == 0 ? "identical" : "DIFFERENT");
+    failures += mismatches;
+
+    // the beeper - square waves from a low note to one above the sample rate
+    printf("\n%-16s %12s %12s %12s %8s\n", "beeper", "averaged", "band limited", "frame (us)", "check");
+    for (int halfPeriod : {2468, 1234, 567, 200, 50}) {
+        double frameTime;
+        std::vector<double> averaged = squareWave(halfPeriod, 50, false);
+        std::vector<double> bandLimited = squareWave(halfPeriod, 50, true, &frameTime);
+        double averagedAlias = worstAlias(averaged, halfPeriod);
+        double bandLimitedAlias = worstAlias(bandLimited, halfPeriod);
+        bool better = bandLimitedAlias < averagedAlias;
+        char name[32];
+        snprintf(name, sizeof(name), "%.0fHz", 3500000.0 / (2 * halfPeriod));
+        printf("%-16s %10.1fdB %10.1fdB %12.2f %8s\n", name, averagedAlias, bandLimitedAlias, frameTime, better ? "ok" : "FAILED");
+        failures += better ? 0 : 1;
+    }
+
+    // resampling for the sound card
+    printf("\n%-16s %12s %12s %12s %12s %8s\n", "resampling", "linear", "polyphase", "linear (us)", "poly (us)", "check");
+    for (double outputRate : {44100.0, 48000.0}) {
+        for (double tone : {1000.0, 3000.0, 5000.0, 7000.0}) {
+            double linearTime;
+            double polyphaseTime;
+            double linear = worstImage(resampleTone(tone, outputRate, false, linearTime), tone, outputRate);
+            double polyphase = worstImage(resampleTone(tone, outputRate, true, polyphaseTime), tone, outputRate);
+            bool better = polyphase < linear;
+            char name[32];
+            snprintf(name, sizeof(name), "%.0fHz at %.0fk", tone, outputRate / 1000);
+            printf("%-16s %10.1fdB %10.1fdB %12.2f %12.2f %8s\n", name, linear, polyphase, linearTime, polyphaseTime,
+                better ? "ok" : "FAILED");
+            failures += better ? 0 : 1;
+        }
+    }
+
+    // typical mixes
+    printf("\n%-16s %14s %14s %8s\n", "mix", "per tact (us)", "in runs (us)", "check");
+    for (const Mix &mix : mixes) {
+        AySound::reset();
+        setMix(mix);
+        perTactTime = 0;
+        runsTime = 0;
+        bool same = true;
+        for (int frame = 0; frame < frames; frame++) {
+            ayemu_state_t start = generatorState();
+            same = compareGenerators(start, SAMPLES_PER_FRAME, 0, perTactTime, runsTime) && same;
+        }
+        printf("%-16s %14.2f %14.2f %8s\n", mix.name, perTactTime / frames, runsTime / frames, same ? "ok" : "FAILED");
+        failures += same ? 0 : 1;
+    }
+
+    // a whole 128K frame with three tones playing - the 128K menu is running
+    for (int frame = 0; frame < 100; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    setMix(mixes[2]);
+    auto timer = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        machine->runForFrame(nullptr, nullptr);
+    }
+    printf("\n128K frame with three tones: %.2fus\n", microsSince(timer) / frames);
+
+    delete machine;
+    printf("%s\n", failures == 0 ? "All ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -7,10 +7,11 @@
 #include <cstdint>
 #include "spectrum.h"
 #include "snaps.h"
+#include "BootImage.h"
 #include "loadgame.h"
 
 
-Z80MemoryWriter *write(std::string filename, uint8_t *data, size_t length, bool is128k) {
+Z80MemoryWriter *write(std::string filename, uint8_t *data, size_t length, bool is128k, bool flashLoad = false, bool useDeck = false, bool accelerate = true) {
     bool isTAP = filename.find(".tap") != std::string::npos || filename.find(".TAP") != std::string::npos;
     bool isTZX = filename.find(".tzx") != std::string::npos || filename.find(".TZX") != std::string::npos;
     if (!isTAP && !isTZX) {
@@ -22,58 +23,30 @@ Z80MemoryWriter *write(std::string filename, uint8_t *data, size_t length, bool
     if (is128k) {
         std::cout << "Using 128k machine" << std::endl;
         machine->init_spectrum(SPECMDL_128K);
-        machine->reset_spectrum(machine->z80Regs);
-        for(int i = 0; i < 200; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
     } else {
         std::cout << "Using 48k machine" << std::endl;
         machine->init_spectrum(SPECMDL_48K);
-        machine->reset_spectrum(machine->z80Regs);
-        for(int i = 0; i < 200; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        // we need to do load ""
-        machine->updateKey(SPECKEY_J, 1);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        machine->updateKey(SPECKEY_J, 0);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        machine->updateKey(SPECKEY_SYMB, 1);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        machine->updateKey(SPECKEY_P, 1);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        machine->updateKey(SPECKEY_P, 0);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
-        }
-        machine->updateKey(SPECKEY_P, 1);
-        for(int i = 0; i < 10; i++) {
-            machine->runForFrame(nullptr, nullptr);
+    }
+    machine->reset_spectrum(machine->z80Regs);
+    // get to LOAD "" from the boot image rather than booting the ROM
+    readyToLoad(machine);
+    if (useDeck) {
+        // play the tape in real time through the tape deck
+        if (!insertTape(filename, machine, flashLoad)) {
+            delete machine;
+            return nullptr;
         }
-        machine->updateKey(SPECKEY_P, 0);
-        for(int i = 0; i < 10; i++) {
+        machine->tapeDeck.setLoaderAcceleration(accelerate);
+        int frames = 0;
+        while (machine->tapeDeck.isPlaying()) {
             machine->runForFrame(nullptr, nullptr);
+            frames++;
         }
-        machine->updateKey(SPECKEY_SYMB, 0);
-    }
-    // press enter
-    machine->updateKey(SPECKEY_ENTER, 1);
-    for(int i = 0; i < 10; i++) {
-        machine->runForFrame(nullptr, nullptr);
-    }
-    machine->updateKey(SPECKEY_ENTER, 0);
-    for(int i = 0; i < 10; i++) {
-        machine->runForFrame(nullptr, nullptr);
+        std::cout << "Tape played for " << frames << " frames" << std::endl;
+        std::cout << "Loader loops skipped " << machine->tapeDeck.getSkippedTStates() << " T-states" << std::endl;
+    } else {
+        loadTapeGame(data, length, filename, machine, flashLoad);
     }
-    loadTapeGame(data, length, filename, machine);
     Z80MemoryWriter *writer = new Z80MemoryWriter(machine);
     writer->saveZ80();
     delete machine;
@@ -112,10 +85,12 @@ EMSCRIPTEN_BINDINGS(tape_module) {
 
 #ifndef __EMSCRIPTEN__
 // test main file - takes a tap file as the first argument a machine type for the second argument (48k or 128k) and writes a z80 version
+// pass "flash" to load standard speed blocks directly into memory and "deck" to play the tape through the tape deck
+// - "noaccel" stops the deck from skipping over loader loops
 int main(int argc, char *argv[])
 {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <filename> <machine_type>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <filename> <machine_type> [flash] [deck] [noaccel]" << std::endl;
         return 1;
     }
     std::string filename = argv[1];
@@ -123,6 +98,14 @@ int main(int argc, char *argv[])
     if (strcmp(argv[2], "128k") == 0) {
         is128k = true;
     }
+    bool flashLoad = false;
+    bool useDeck = false;
+    bool accelerate = true;
+    for (int i = 3; i < argc; i++) {
+        flashLoad |= strcmp(argv[i], "flash") == 0;
+        useDeck |= strcmp(argv[i], "deck") == 0;
+        accelerate &= strcmp(argv[i], "noaccel") != 0;
+    }
     FILE *file = fopen(filename.c_str(), "rb");
     if (!file) {
         std::cerr << "Failed to open file: " << filename << std::endl;
@@ -134,8 +117,11 @@ int main(int argc, char *argv[])
     uint8_t *data = (uint8_t *)malloc(length);
     fread(data, 1, length, file);
     fclose(file);
-    Z80MemoryWriter *writer = write(filename, data, length, is128k);
+    Z80MemoryWriter *writer = write(filename, data, length, is128k, flashLoad, useDeck, accelerate);
     free(data);
+    if (!writer) {
+        return 1;
+    }
     // Save the Z80 file
     std::string z80Filename = filename.substr(0, filename.find_last_of('.')) + ".z80";
     FILE *z80File = fopen(z80Filename.c_str(), "wb");
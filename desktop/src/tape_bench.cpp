@@ -0,0 +1,349 @@
+// Checks and times playing tapes.
+//
+// Tapes are played straight from memory and streamed from a file through the small window the firmware reads
+// them with, and the signal each one gives - when every edge happens and which way it goes - has to be the same.
+// Pulses are handed to listeners packed into batches with the runs that leave the level alone merged, so the signal
+// is compared rather than the pulses. The length of the tape from the index has to match what was played, and the
+// estimate made when streaming is reported against it. Then it times playing each tape a batch at a time against a
+// listener that takes the pulses one call at a time, and from the file.
+//
+// A TAP and a TZX with most kinds of block the player understands are made up, with blocks that are bigger than
+// the window and that cross from one window to the next. Any tapes given are checked too.
+//
+//   tape_bench [tape ...]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "tzx_cas.h"
+#include "TapeSource.h"
+#include "DummyListener.h"
+
+// hashes every edge of the signal with the time it happens - but not how the pulses were split up to get there
+class SignalListener : public TapeListener {
+public:
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    bool level = false;
+    SignalListener() : TapeListener(nullptr) {}
+    void mix(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 0x100000001b3ULL;
+        }
+    }
+    void setLevel(bool newLevel) {
+        if (newLevel != level) {
+            level = newLevel;
+            mix(totalTicks);
+            mix(level);
+        }
+    }
+    void start() {}
+    void toggleMicLevel() {
+        setLevel(!level);
+    }
+    void setMicHigh() {
+        setLevel(true);
+    }
+    void setMicLow() {
+        setLevel(false);
+    }
+    void runForTicks(uint64_t ticks) {
+        addTicks(ticks);
+    }
+    void pause1Millis() {
+        addTicks(MILLI_SECOND);
+    }
+    void finish() {}
+};
+
+// adds up the pulses one virtual call at a time - how every listener was driven before the batches
+class PulseListener : public TapeListener {
+public:
+    PulseListener() : TapeListener(nullptr) {}
+    void start() {}
+    void toggleMicLevel() {}
+    void setMicHigh() {}
+    void setMicLow() {}
+    void runForTicks(uint64_t ticks) {
+        addTicks(ticks);
+    }
+    void pause1Millis() {
+        addTicks(MILLI_SECOND);
+    }
+    void finish() {}
+};
+
+std::vector<uint8_t> randomBytes(int length) {
+    std::vector<uint8_t> data(length);
+    for (uint8_t &value : data) {
+        value = rand();
+    }
+    return data;
+}
+
+void add16(std::vector<uint8_t> &tape, int value) {
+    tape.push_back(value & 0xFF);
+    tape.push_back(value >> 8);
+}
+
+void add24(std::vector<uint8_t> &tape, int value) {
+    add16(tape, value & 0xFFFF);
+    tape.push_back(value >> 16);
+}
+
+void add32(std::vector<uint8_t> &tape, uint32_t value) {
+    add16(tape, value & 0xFFFF);
+    add16(tape, value >> 16);
+}
+
+void addBytes(std::vector<uint8_t> &tape, const std::vector<uint8_t> &data) {
+    tape.insert(tape.end(), data.begin(), data.end());
+}
+
+// a generalized data symbol of two pulses that toggles the level
+void addSymbol(std::vector<uint8_t> &tape, int first, int second) {
+    tape.push_back(0);
+    add16(tape, first);
+    add16(tape, second);
+}
+
+// a TAP block with its flag and parity
+std::vector<uint8_t> tapBlock(uint8_t flag, int length) {
+    std::vector<uint8_t> block = randomBytes(length);
+    block.insert(block.begin(), flag);
+    uint8_t parity = 0;
+    for (uint8_t value : block) {
+        parity ^= value;
+    }
+    block.push_back(parity);
+    return block;
+}
+
+std::vector<uint8_t> makeTap() {
+    std::vector<uint8_t> tape;
+    for (int length : {17, 6912, 17, 40000, 17, 1}) {
+        std::vector<uint8_t> block = tapBlock(length == 17 ? 0x00 : 0xFF, length);
+        add16(tape, block.size());
+        addBytes(tape, block);
+    }
+    return tape;
+}
+
+std::vector<uint8_t> makeTzx() {
+    std::vector<uint8_t> tape = {'Z', 'X', 'T', 'a', 'p', 'e', '!', 0x1A, 1, 20};
+    // text description and archive info - these don't make a sound
+    std::string text = "tape_bench";
+    tape.push_back(0x30);
+    tape.push_back(text.size());
+    tape.insert(tape.end(), text.begin(), text.end());
+    tape.push_back(0x32);
+    add16(tape, 3 + text.size());
+    tape.push_back(1);
+    tape.push_back(0x00);
+    tape.push_back(text.size());
+    tape.insert(tape.end(), text.begin(), text.end());
+    // a group around a standard speed header and a block that's bigger than the window
+    tape.push_back(0x21);
+    tape.push_back(text.size());
+    tape.insert(tape.end(), text.begin(), text.end());
+    for (int length : {17, 20000}) {
+        std::vector<uint8_t> block = tapBlock(length == 17 ? 0x00 : 0xFF, length);
+        tape.push_back(0x10);
+        add16(tape, 1000);
+        add16(tape, block.size());
+        addBytes(tape, block);
+    }
+    tape.push_back(0x22);
+    // turbo speed with some of the bits of the last byte used
+    std::vector<uint8_t> turbo = tapBlock(0xFF, 5000);
+    tape.push_back(0x11);
+    for (int value : {2000, 600, 700, 500, 1000, 3000}) {
+        add16(tape, value);
+    }
+    tape.push_back(5);
+    add16(tape, 500);
+    add24(tape, turbo.size());
+    addBytes(tape, turbo);
+    // a pure tone and a sequence of pulses three times over
+    tape.push_back(0x24);
+    add16(tape, 3);
+    tape.push_back(0x12);
+    add16(tape, 2168);
+    add16(tape, 500);
+    tape.push_back(0x13);
+    tape.push_back(10);
+    for (int i = 0; i < 10; i++) {
+        add16(tape, 300 + i * 100);
+    }
+    tape.push_back(0x25);
+    // the signal goes high then pure data
+    tape.push_back(0x2B);
+    add32(tape, 1);
+    tape.push_back(1);
+    std::vector<uint8_t> pure = randomBytes(3000);
+    tape.push_back(0x14);
+    add16(tape, 855);
+    add16(tape, 1710);
+    tape.push_back(8);
+    add16(tape, 0);
+    add24(tape, pure.size());
+    addBytes(tape, pure);
+    // a direct recording
+    std::vector<uint8_t> samples = randomBytes(6000);
+    tape.push_back(0x15);
+    add16(tape, 79);
+    add16(tape, 100);
+    tape.push_back(6);
+    add24(tape, samples.size());
+    addBytes(tape, samples);
+    // generalized data - a pilot of 300 pulses and a sync, then 1001 symbols of two bits each
+    std::vector<uint8_t> generalized;
+    add16(generalized, 100);
+    add32(generalized, 2);
+    generalized.push_back(2);
+    generalized.push_back(2);
+    add32(generalized, 1001);
+    generalized.push_back(2);
+    generalized.push_back(4);
+    addSymbol(generalized, 2168, 0);
+    addSymbol(generalized, 667, 735);
+    generalized.push_back(0);
+    add16(generalized, 300);
+    generalized.push_back(1);
+    add16(generalized, 1);
+    addSymbol(generalized, 500, 500);
+    addSymbol(generalized, 800, 800);
+    addSymbol(generalized, 1000, 0);
+    addSymbol(generalized, 300, 900);
+    addBytes(generalized, randomBytes((1001 * 2 + 7) / 8));
+    tape.push_back(0x19);
+    add32(tape, generalized.size());
+    addBytes(tape, generalized);
+    // a pause and a last standard speed block
+    tape.push_back(0x20);
+    add16(tape, 500);
+    std::vector<uint8_t> last = tapBlock(0xFF, 100);
+    tape.push_back(0x10);
+    add16(tape, 0);
+    add16(tape, last.size());
+    addBytes(tape, last);
+    return tape;
+}
+
+// the player logs every block - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+double microsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool play(TapeListener *listener, TapeSource *source, bool tap) {
+    TzxCas cas;
+    return tap ? cas.load_tap(listener, source) : cas.load_tzx(listener, source);
+}
+
+uint64_t indexedTicks(TapeSource *source, bool tap) {
+    TzxCas cas;
+    tap ? cas.index_tap(source) : cas.index_tzx(source);
+    return cas.get_total_ticks();
+}
+
+// returns false if the tape didn't play the same way from a file
+bool checkTape(const std::string &name, std::vector<uint8_t> tape, bool tap) {
+    // the file the tape is streamed from
+    FILE *fp = tmpfile();
+    fwrite(tape.data(), 1, tape.size(), fp);
+    fflush(fp);
+    int saved = quiet();
+
+    SignalListener fromMemory;
+    TapeSource memorySource(tape.data(), tape.size());
+    play(&fromMemory, &memorySource, tap);
+    SignalListener fromFile;
+    TapeSource fileSource(fp);
+    play(&fromFile, &fileSource, tap);
+    bool same = fromMemory.hash == fromFile.hash && fromMemory.getTotalTicks() == fromFile.getTotalTicks();
+    uint64_t indexed = indexedTicks(&memorySource, tap);
+    uint64_t estimated = indexedTicks(&fileSource, tap);
+    bool exact = indexed == fromMemory.getTotalTicks();
+
+    // play it a few times over each way
+    const int runs = 10;
+    auto timer = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < runs; i++) {
+        DummyListener batches;
+        play(&batches, &memorySource, tap);
+    }
+    double batchTime = microsSince(timer) / runs;
+    timer = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < runs; i++) {
+        PulseListener pulses;
+        play(&pulses, &memorySource, tap);
+    }
+    double pulseTime = microsSince(timer) / runs;
+    // a batch adds up its pulses in one go - it must come to the same as one at a time
+    DummyListener batches;
+    play(&batches, &memorySource, tap);
+    same = same && batches.getTotalTicks() == fromMemory.getTotalTicks();
+    timer = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < runs; i++) {
+        DummyListener batches;
+        play(&batches, &fileSource, tap);
+    }
+    double fileTime = microsSince(timer) / runs;
+    fclose(fp);
+    loud(saved);
+
+    double seconds = (double) fromMemory.getTotalTicks() / CPU_FREQ;
+    printf("%-16s %7.1fs %8s %8s %+8.1f%% %10.0f %10.0f %10.0f\n", name.c_str(), seconds, same ? "ok" : "FAILED",
+        exact ? "ok" : "FAILED", 100.0 * ((double) estimated - indexed) / indexed, pulseTime, batchTime, fileTime);
+    return same && exact;
+}
+
+int main(int argc, char *argv[]) {
+    srand(1234);
+    printf("%-16s %8s %8s %8s %9s %10s %10s %10s\n", "tape", "length", "file", "index", "estimate", "pulses(us)",
+        "batches", "from file");
+    int failures = 0;
+    failures += checkTape("synthetic.tap", makeTap(), true) ? 0 : 1;
+    failures += checkTape("synthetic.tzx", makeTzx(), false) ? 0 : 1;
+    for (int i = 1; i < argc; i++) {
+        std::string name = argv[i];
+        FILE *fp = fopen(name.c_str(), "rb");
+        if (!fp) {
+            printf("Can't open %s\n", name.c_str());
+            failures++;
+            continue;
+        }
+        std::vector<uint8_t> tape;
+        uint8_t buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+            tape.insert(tape.end(), buffer, buffer + read);
+        }
+        fclose(fp);
+        std::string extension = name.size() > 4 ? name.substr(name.size() - 4) : "";
+        bool tap = extension == ".tap" || extension == ".TAP";
+        size_t slash = name.find_last_of('/');
+        failures += checkTape(slash == std::string::npos ? name : name.substr(slash + 1), tape, tap) ? 0 : 1;
+    }
+    printf("%s\n", failures == 0 ? "All ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,416 @@
+// Plays games with random key presses, recording time travel every second, and reports how much history
+// fits in each MB. Every instant that is still in the history at the end is rewound to and checked against
+// a full copy of the machine taken when it was recorded. Then we scrub to random frames in between - which
+// replays the keys from the journal - and check those against a hash of the machine taken after every frame.
+// Frames where the tape was playing can't be replayed so those land on an instant instead.
+//
+// It also times every frame along with the time travel work done in it and reports the worst of each, followed
+// by histograms of both. Normally the banks of an instant are encoded a frame at a time after it has been
+// recorded - --eager encodes them all when it's recorded, which is how it used to work.
+//
+//   time_travel_bench [--budget MB] [--seconds N] [--keyframes N] [--128k] [--eager] game.z80|game.sna|game.tap|game.tzx ...
+//
+// Tapes are played through the tape deck so the loading is part of the workload.
+//
+// Time travel is built on saving and loading the machine's state, so that is checked on its own first for each
+// snapshot - a new machine loaded from a saved state has to save the same state and then play on exactly as the
+// original did, sound and all. States that are cut short or from another version have to be refused. Saving and
+// loading are timed.
+//
+// Quick saves keep the state in memory and write it to a file in the background - saving and restoring a slot and
+// writing and reading its file are timed, and restoring it from memory and from the file have to give back the same
+// state.
+//
+// Nothing is allocated for the history until the first instant is recorded, so it times making a TimeTravel and the
+// first record and checks how much has been allocated then and once the run is over against the budget.
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "spectrum.h"
+#include "snaps.h"
+#include "BootImage.h"
+#include "TimeTravel.h"
+#include "QuickSaves.h"
+#include "FrameTimes.h"
+#include "loadgame.h"
+
+// the keys most games use
+const SpecKeys gameKeys[] = {SPECKEY_Q, SPECKEY_A, SPECKEY_O, SPECKEY_P, SPECKEY_M, SPECKEY_SPACE, SPECKEY_ENTER,
+                             SPECKEY_1, SPECKEY_2, SPECKEY_3, SPECKEY_4, SPECKEY_5, SPECKEY_0};
+
+std::vector<uint8_t> saveMachine(ZXSpectrum *machine) {
+    std::vector<uint8_t> state(machine->stateSize());
+    state.resize(machine->saveState(state.data(), state.size()));
+    return state;
+}
+
+uint64_t hashMachine(ZXSpectrum *machine) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint8_t byte : saveMachine(machine)) {
+        hash = (hash ^ byte) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// the emulator logs what it's doing - keep that out of the report
+int quiet() {
+    fflush(stdout);
+    int saved = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+    return saved;
+}
+
+void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+}
+
+// run some frames pressing keys and moving the joystick - returns the sound that was made
+std::vector<uint8_t> play(ZXSpectrum *machine, int frames) {
+    FILE *audio = tmpfile();
+    for (int frame = 0; frame < frames; frame++) {
+        machine->updateKey(gameKeys[(frame / 20) % (sizeof(gameKeys) / sizeof(gameKeys[0]))], frame % 20 < 10);
+        machine->kempston_port = frame % 50 < 25 ? 0x10 : 0x00;
+        machine->runForFrame(nullptr, audio);
+    }
+    std::vector<uint8_t> sound(ftell(audio));
+    rewind(audio);
+    sound.resize(fread(sound.data(), 1, sound.size(), audio));
+    fclose(audio);
+    return sound;
+}
+
+struct QuickSaveCheck {
+    size_t bytes = 0;
+    size_t fileBytes = 0;
+    double saveTime = 0;
+    double restoreTime = 0;
+    double writeTime = 0;
+    double readTime = 0;
+    bool ok = false;
+};
+
+// save to a slot, play on and restore it - then the same again from the file it was written to
+QuickSaveCheck checkQuickSave(ZXSpectrum *machine) {
+    QuickSaveCheck check;
+    // the slot files go next to the game
+    std::string game = "/tmp/time_travel_bench.z80";
+    QuickSaves quickSaves;
+    quickSaves.setFilename(game);
+    std::vector<uint8_t> state = saveMachine(machine);
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = quickSaves.save(machine, 0);
+    check.saveTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    play(machine, 100);
+    start = std::chrono::high_resolution_clock::now();
+    ok = ok && quickSaves.restore(machine, 0);
+    check.restoreTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    ok = ok && saveMachine(machine) == state;
+
+    uint8_t *unwritten = quickSaves.takeUnwritten(0, &check.bytes);
+    start = std::chrono::high_resolution_clock::now();
+    ok = ok && unwritten && QuickSaves::writeFile(quickSaves.fileName(0), unwritten, check.bytes);
+    check.writeTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    free(unwritten);
+    play(machine, 100);
+    QuickSaves fromFile;
+    start = std::chrono::high_resolution_clock::now();
+    fromFile.setFilename(game);
+    check.readTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    ok = ok && fromFile.restore(machine, 0) && saveMachine(machine) == state;
+    FILE *fp = fopen(quickSaves.fileName(0).c_str(), "rb");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        check.fileBytes = ftell(fp);
+        fclose(fp);
+    }
+    remove(quickSaves.fileName(0).c_str());
+    check.ok = ok;
+    return check;
+}
+
+struct Startup {
+    double constructTime;
+    size_t constructAllocated;
+    double firstRecordTime;
+    size_t firstRecordAllocated;
+    size_t endAllocated;
+    size_t budget;
+    bool ok() {
+        // the budget is for the history - the two copies of the banks it works from are on top
+        return constructAllocated == 0 && endAllocated <= budget + 2 * 8 * 0x4000;
+    }
+};
+
+Startup timeStartup(ZXSpectrum *machine, size_t budget, int keyframeInterval) {
+    Startup startup;
+    startup.budget = budget;
+    auto start = std::chrono::high_resolution_clock::now();
+    TimeTravel *timeTravel = new TimeTravel(budget, keyframeInterval);
+    startup.constructTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    startup.constructAllocated = timeTravel->memoryAllocated();
+    start = std::chrono::high_resolution_clock::now();
+    timeTravel->record(machine);
+    startup.firstRecordTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    startup.firstRecordAllocated = timeTravel->memoryAllocated();
+    delete timeTravel;
+    return startup;
+}
+
+struct StateCheck {
+    size_t bytes = 0;
+    double saveTime = 0;
+    double loadTime = 0;
+    bool ok = false;
+};
+
+StateCheck checkState(ZXSpectrum *machine) {
+    StateCheck check;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<uint8_t> state = saveMachine(machine);
+    check.saveTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    check.bytes = state.size();
+    std::vector<uint8_t> sound = play(machine, 300);
+    std::vector<uint8_t> after = saveMachine(machine);
+
+    ZXSpectrum *copy = new ZXSpectrum();
+    copy->reset();
+    copy->init_spectrum(SPECMDL_48K);
+    copy->reset_spectrum(copy->z80Regs);
+    start = std::chrono::high_resolution_clock::now();
+    bool loaded = copy->loadState(state.data(), state.size());
+    check.loadTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    bool same = loaded && saveMachine(copy) == state;
+    same = same && play(copy, 300) == sound && saveMachine(copy) == after;
+    // the original has to carry on as before
+    same = same && machine->loadState(after.data(), after.size());
+    // short and wrong version states are refused
+    std::vector<uint8_t> wrongVersion = state;
+    wrongVersion[4] ^= 0x80;
+    same = same && !copy->loadState(state.data(), state.size() - 1) && !copy->loadState(wrongVersion.data(), wrongVersion.size());
+    delete copy;
+    check.ok = same;
+    return check;
+}
+
+bool isTape(const std::string &filename) {
+    std::string extension = filename.substr(filename.find_last_of('.') + 1);
+    for (char &c : extension) {
+        c = tolower(c);
+    }
+    return extension == "tap" || extension == "tzx";
+}
+
+int main(int argc, char *argv[]) {
+    double budgetMB = 1;
+    int seconds = 120;
+    int keyframeInterval = TIME_TRAVEL_KEYFRAME_INTERVAL;
+    bool is128k = false;
+    bool eager = false;
+    std::vector<std::string> games;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--budget" && i + 1 < argc) {
+            budgetMB = atof(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (arg == "--keyframes" && i + 1 < argc) {
+            keyframeInterval = atoi(argv[++i]);
+        } else if (arg == "--128k") {
+            is128k = true;
+        } else if (arg == "--eager") {
+            eager = true;
+        } else {
+            games.push_back(arg);
+        }
+    }
+    if (games.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--budget MB] [--seconds N] [--keyframes N] [--128k] [--eager] game ..." << std::endl;
+        return 1;
+    }
+    printf("%-24s %6s %10s %10s %10s %9s %12s %11s %11s %11s %8s\n", "workload", "model", "bytes/s", "copies/s",
+        "s per MB", "in budget", "rewind (us)", "scrub (us)", "frame (us)", "travel (us)", "check");
+    int failures = 0;
+    std::vector<std::pair<std::string, FrameTimes>> histograms;
+    std::vector<std::pair<std::string, StateCheck>> stateChecks;
+    std::vector<std::pair<std::string, Startup>> startups;
+    std::vector<std::pair<std::string, QuickSaveCheck>> quickSaveChecks;
+    for (const std::string &game : games) {
+        srand(1234);
+        int saved = quiet();
+        ZXSpectrum *machine = new ZXSpectrum();
+        machine->reset();
+        machine->init_spectrum(is128k ? SPECMDL_128K : SPECMDL_48K);
+        machine->reset_spectrum(machine->z80Regs);
+        if (isTape(game)) {
+            readyToLoad(machine);
+            insertTape(game, machine, false);
+        } else {
+            Load(machine, game.c_str());
+        }
+        // the state doesn't include the tape so a copy can't play on the same way while it is loading
+        StateCheck stateCheck;
+        QuickSaveCheck quickSaveCheck;
+        if (!isTape(game)) {
+            stateCheck = checkState(machine);
+            quickSaveCheck = checkQuickSave(machine);
+        }
+        Startup startup = timeStartup(machine, budgetMB * 1024 * 1024, keyframeInterval);
+        TimeTravel timeTravel(budgetMB * 1024 * 1024, keyframeInterval);
+        // the same again with room for everything so we can see how much each second takes
+        TimeTravel unlimited((size_t) seconds * 9 * 0x4100, keyframeInterval);
+        std::vector<std::vector<uint8_t>> expected;
+        // the machine after every frame
+        std::vector<uint64_t> frameHashes = {hashMachine(machine)};
+        // what it would cost to copy every bank that changed - how time travel used to work
+        std::vector<uint8_t> previous[8];
+        size_t copiedBytes = 0;
+        SpecKeys key = SPECKEY_NONE;
+        FrameTimes frameTimes;
+        // just the time travel part of each frame
+        FrameTimes timeTravelTimes;
+        for (int second = 0; second < seconds; second++) {
+            for (int frame = 0; frame < 50; frame++) {
+                if (!machine->tapeDeck.isPlaying() && frame % 25 == 0) {
+                    if (key != SPECKEY_NONE) {
+                        machine->updateKey(key, 0);
+                        timeTravel.keyChanged(key, 0);
+                    }
+                    key = rand() % 3 == 0 ? SPECKEY_NONE : gameKeys[rand() % (sizeof(gameKeys) / sizeof(gameKeys[0]))];
+                    if (key != SPECKEY_NONE) {
+                        machine->updateKey(key, 1);
+                        timeTravel.keyChanged(key, 1);
+                    }
+                }
+                auto start = std::chrono::high_resolution_clock::now();
+                bool tapePlaying = machine->tapeDeck.isPlaying();
+                machine->runForFrame(nullptr, nullptr);
+                tapePlaying |= machine->tapeDeck.isPlaying();
+                auto ran = std::chrono::high_resolution_clock::now();
+                timeTravel.endFrame(tapePlaying);
+                auto end = std::chrono::high_resolution_clock::now();
+                double frameTime = std::chrono::duration<double, std::micro>(end - start).count();
+                double timeTravelTime = std::chrono::duration<double, std::micro>(end - ran).count();
+                unlimited.endFrame(tapePlaying);
+                if (frame == 49) {
+                    // a machine can only have one lot of banks waiting to be copied - so this one doesn't leave any
+                    unlimited.record(machine);
+                    unlimited.finishRecording();
+                    start = std::chrono::high_resolution_clock::now();
+                    timeTravel.record(machine);
+                    if (eager) {
+                        timeTravel.finishRecording();
+                    }
+                    end = std::chrono::high_resolution_clock::now();
+                    frameTime += std::chrono::duration<double, std::micro>(end - start).count();
+                    timeTravelTime += std::chrono::duration<double, std::micro>(end - start).count();
+                }
+                frameTimes.add(frameTime);
+                timeTravelTimes.add(timeTravelTime);
+                frameHashes.push_back(hashMachine(machine));
+            }
+            expected.push_back(saveMachine(machine));
+            for (int bank = 0; bank < 8; bank++) {
+                if (machine->hwopt.hw_model != SPECMDL_128K && bank != 0 && bank != 2 && bank != 5) {
+                    continue;
+                }
+                const uint8_t *data = machine->mem.banks[bank]->data;
+                if (previous[bank].empty() || memcmp(previous[bank].data(), data, 0x4000) != 0) {
+                    copiedBytes += 0x4000;
+                    previous[bank].assign(data, data + 0x4000);
+                }
+            }
+        }
+        // rewind to everything that's left and check it - the last instant might not fit once it's finished
+        timeTravel.finishRecording();
+        size_t kept = timeTravel.size();
+        int mismatches = 0;
+        double rewindTime = 0;
+        for (size_t i = 0; i < kept; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            timeTravel.rewind(machine, i);
+            auto end = std::chrono::high_resolution_clock::now();
+            rewindTime += std::chrono::duration<double, std::micro>(end - start).count();
+            // an instant is recorded every 50 frames - one that didn't fit is skipped
+            if (saveMachine(machine) != expected[timeTravel.instantFrame(i) / 50 - 1]) {
+                mismatches++;
+            }
+        }
+        // scrub to random frames, then step back and forward a frame at a time from the last one
+        uint32_t first = timeTravel.firstFrame();
+        uint32_t last = timeTravel.currentFrame();
+        std::vector<uint32_t> targets;
+        for (int i = 0; i < 100; i++) {
+            targets.push_back(first + rand() % (last - first + 1));
+        }
+        for (int i = 1; i <= 60 && targets.back() >= first + 1; i++) {
+            targets.push_back(targets.back() - 1);
+        }
+        for (int i = 1; i <= 60 && targets.back() < last; i++) {
+            targets.push_back(targets.back() + 1);
+        }
+        double scrubTime = 0;
+        for (uint32_t target : targets) {
+            auto start = std::chrono::high_resolution_clock::now();
+            timeTravel.rewindToFrame(machine, target);
+            auto end = std::chrono::high_resolution_clock::now();
+            scrubTime += std::chrono::duration<double, std::micro>(end - start).count();
+            if (hashMachine(machine) != frameHashes[target]) {
+                mismatches++;
+            }
+        }
+        loud(saved);
+        double bytesPerSecond = (double) unlimited.memoryUsed() / seconds;
+        std::string name = game.substr(game.find_last_of('/') + 1);
+        printf("%-24s %6s %10.0f %10.0f %10.1f %9zu %12.1f %11.1f %11u %11u %8s\n", name.c_str(),
+            machine->hwopt.hw_model == SPECMDL_128K ? "128K" : "48K", bytesPerSecond, (double) copiedBytes / seconds,
+            1024 * 1024 / bytesPerSecond, kept, kept > 0 ? rewindTime / kept : 0, scrubTime / targets.size(),
+            frameTimes.worst, timeTravelTimes.worst, mismatches == 0 ? "ok" : "FAILED");
+        startup.endAllocated = timeTravel.memoryAllocated();
+        startups.push_back({name, startup});
+        failures += startup.ok() ? 0 : 1;
+        if (!isTape(game)) {
+            stateChecks.push_back({name, stateCheck});
+            failures += stateCheck.ok ? 0 : 1;
+            quickSaveChecks.push_back({name, quickSaveCheck});
+            failures += quickSaveCheck.ok ? 0 : 1;
+        }
+        histograms.push_back({name, frameTimes});
+        histograms.push_back({name + " time travel", timeTravelTimes});
+        failures += mismatches;
+        delete machine;
+    }
+    printf("\n%-24s %12s %12s %12s %8s\n", "state", "bytes", "save (us)", "load (us)", "check");
+    for (auto &stateCheck : stateChecks) {
+        printf("%-24s %12zu %12.1f %12.1f %8s\n", stateCheck.first.c_str(), stateCheck.second.bytes, stateCheck.second.saveTime,
+            stateCheck.second.loadTime, stateCheck.second.ok ? "ok" : "FAILED");
+    }
+    printf("\n%-24s %10s %10s %10s %12s %10s %10s %8s\n", "quick save", "bytes", "file", "save (us)", "restore (us)",
+        "write (us)", "read (us)", "check");
+    for (auto &quickSave : quickSaveChecks) {
+        printf("%-24s %10zu %10zu %10.1f %12.1f %10.1f %10.1f %8s\n", quickSave.first.c_str(), quickSave.second.bytes,
+            quickSave.second.fileBytes, quickSave.second.saveTime, quickSave.second.restoreTime, quickSave.second.writeTime,
+            quickSave.second.readTime, quickSave.second.ok ? "ok" : "FAILED");
+    }
+    printf("\n%-24s %14s %12s %16s %12s %12s %12s %8s\n", "startup", "construct (us)", "allocated", "first record (us)",
+        "allocated", "at the end", "budget", "check");
+    for (auto &startup : startups) {
+        printf("%-24s %14.1f %12zu %16.1f %12zu %12zu %12zu %8s\n", startup.first.c_str(), startup.second.constructTime,
+            startup.second.constructAllocated, startup.second.firstRecordTime, startup.second.firstRecordAllocated,
+            startup.second.endAllocated, startup.second.budget, startup.second.ok() ? "ok" : "FAILED");
+    }
+    printf("\n");
+    for (auto &histogram : histograms) {
+        histogram.second.print(histogram.first.c_str());
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -34,6 +34,7 @@ visit https://zxespectrum.speccy.org/contacto
 */
 
 #include <math.h>
+#include <string.h>
 #include "AySound.h"
 
 // #pragma GCC optimize("O3")
@@ -78,6 +79,12 @@ int AySound::env_pos;                   /**< current position in envelop (0...12
 int AySound::Cur_Seed;                  /**< random numbers counter */
 
 uint8_t AySound::regs[16];
+uint8_t AySound::cpuRegs[16];
+
+uint32_t AySound::writeLog[AY_WRITE_LOG_SIZE];
+int AySound::writeLogCount = 0;
+int AySound::frameTStates = 69888;
+int AySound::renderedSamples = 0;
 
 uint8_t AySound::SamplebufAY[SAMPLES_PER_FRAME] = { 0 };
 
@@ -284,6 +291,12 @@ int AySound::set_stereo(ayemu_stereo_t stereo_type, int *custom_eq)
     return 1;
 }
 
+/** Set the length of a frame in t-states - used to place register writes in the output samples */
+void AySound::set_frame_tstates(int tstates)
+{
+    frameTStates = tstates;
+}
+
 void AySound::prepare_generation()
 {
 
@@ -317,11 +330,137 @@ void AySound::prepare_generation()
     dirty = 0;
 }
 
+//
+// Advance a counter by a number of chip tacts, returns the number of times it reached its period.
+// Matches stepping the counter one tact at a time with "if (++cnt >= period) cnt = 0"
+//
+static inline int advance_counter(int &cnt, int period, int tacts)
+{
+    int first = period - cnt;
+    if (first < 1) first = 1;
+    if (tacts < first) {
+        cnt += tacts;
+        return 0;
+    }
+    int interval = period < 1 ? 1 : period;
+    int rest = tacts - first;
+    cnt = rest % interval;
+    return 1 + rest / interval;
+}
+
 //
 // Generate sound.
 // Fill sound buffer with current register data
 //
+// Rather than stepping every counter one chip tact at a time we work out how many tacts there are
+// until the next counter that can change the output fires and add that whole run in one go.
+// Counters that can't be heard (disabled tone/noise, silent channels, unused envelope) are
+// advanced arithmetically for the whole buffer. Output is identical to gen_sound_per_tact - desktop/sound_bench
+// checks that.
+//
 void AySound::gen_sound(int sound_bufsize, int bufpos)
+{
+    if (sound_bufsize <= 0) return;
+
+    uint8_t *sound_buf = SamplebufAY + bufpos;
+
+    // which counters can affect the output - the registers don't change during this call
+    const bool audible_a = ayregs.env_a || ayregs.vol_a;
+    const bool audible_b = ayregs.env_b || ayregs.vol_b;
+    const bool audible_c = ayregs.env_c || ayregs.vol_c;
+    const bool use_a = ayregs.R7_tone_a && audible_a;
+    const bool use_b = ayregs.R7_tone_b && audible_b;
+    const bool use_c = ayregs.R7_tone_c && audible_c;
+    const bool use_n = (ayregs.R7_noise_a && audible_a) || (ayregs.R7_noise_b && audible_b) || (ayregs.R7_noise_c && audible_c);
+    const bool use_e = ayregs.env_a || ayregs.env_b || ayregs.env_c;
+    const int noise_period = ayregs.noise * 2;
+
+    // the counters nobody can hear just need to end up in the right place
+    const int total_tacts = sound_bufsize * ChipTacts_per_outcount;
+    if (!use_a) bit_a ^= advance_counter(cnt_a, ayregs.tone_a, total_tacts) & 1;
+    if (!use_b) bit_b ^= advance_counter(cnt_b, ayregs.tone_b, total_tacts) & 1;
+    if (!use_c) bit_c ^= advance_counter(cnt_c, ayregs.tone_c, total_tacts) & 1;
+    if (!use_n) {
+        int steps = advance_counter(cnt_n, noise_period, total_tacts);
+        while (steps-- > 0) {
+            Cur_Seed = (Cur_Seed * 2 + 1) ^ \
+                (((Cur_Seed >> 16) ^ (Cur_Seed >> 13)) & 1); 
+        }
+        bit_n = ((Cur_Seed >> 16) & 1);
+    }
+    if (!use_e) {
+        env_pos += advance_counter(cnt_e, ayregs.env_freq, total_tacts);
+        if (env_pos > 127) env_pos = 64 + (env_pos - 128) % 64;
+    }
+
+    // the volume of each channel when its output is on
+    const uint8_t *envelope = Envelope[ayregs.env_style];
+    int amp_a = table[ayregs.env_a ? envelope[env_pos] : Rampa_AY_table[ayregs.vol_a]];
+    int amp_b = table[ayregs.env_b ? envelope[env_pos] : Rampa_AY_table[ayregs.vol_b]];
+    int amp_c = table[ayregs.env_c ? envelope[env_pos] : Rampa_AY_table[ayregs.vol_c]];
+
+    #define AY_LEVEL() ( \
+        (((bit_a | !ayregs.R7_tone_a) & (bit_n | !ayregs.R7_noise_a)) ? amp_a : 0) + \
+        (((bit_b | !ayregs.R7_tone_b) & (bit_n | !ayregs.R7_noise_b)) ? amp_b : 0) + \
+        (((bit_c | !ayregs.R7_tone_c) & (bit_n | !ayregs.R7_noise_c)) ? amp_c : 0))
+
+    int level = AY_LEVEL();
+
+    while (sound_bufsize-- > 0) {
+
+        int mix_l = 0;
+        int tacts = ChipTacts_per_outcount;
+
+        while (tacts > 0) {
+            // find the number of tacts until the next audible counter fires
+            int run = tacts;
+            if (use_a) { int n = ayregs.tone_a - cnt_a; if (n < run) run = n < 1 ? 1 : n; }
+            if (use_b) { int n = ayregs.tone_b - cnt_b; if (n < run) run = n < 1 ? 1 : n; }
+            if (use_c) { int n = ayregs.tone_c - cnt_c; if (n < run) run = n < 1 ? 1 : n; }
+            if (use_n) { int n = noise_period - cnt_n; if (n < run) run = n < 1 ? 1 : n; }
+            if (use_e) { int n = ayregs.env_freq - cnt_e; if (n < run) run = n < 1 ? 1 : n; }
+
+            // nothing changes until the last tact of the run
+            mix_l += (run - 1) * level;
+
+            bool changed = false;
+            if (use_a && advance_counter(cnt_a, ayregs.tone_a, run)) { bit_a = !bit_a; changed = true; }
+            if (use_b && advance_counter(cnt_b, ayregs.tone_b, run)) { bit_b = !bit_b; changed = true; }
+            if (use_c && advance_counter(cnt_c, ayregs.tone_c, run)) { bit_c = !bit_c; changed = true; }
+            if (use_n && advance_counter(cnt_n, noise_period, run)) {
+                /* GenNoise (c) Hacker KAY & Sergey Bulba */
+                Cur_Seed = (Cur_Seed * 2 + 1) ^ \
+                    (((Cur_Seed >> 16) ^ (Cur_Seed >> 13)) & 1); 
+                bit_n = ((Cur_Seed >> 16) & 1);
+                changed = true;
+            }
+            if (use_e && advance_counter(cnt_e, ayregs.env_freq, run)) {
+                if (++env_pos > 127)
+                    env_pos = 64;
+                if (ayregs.env_a) amp_a = table[envelope[env_pos]];
+                if (ayregs.env_b) amp_b = table[envelope[env_pos]];
+                if (ayregs.env_c) amp_c = table[envelope[env_pos]];
+                changed = true;
+            }
+            if (changed) level = AY_LEVEL();
+
+            mix_l += level;
+            tacts -= run;
+        }
+
+        *sound_buf++ = mix_l / Amp_Global;
+
+    }
+
+    #undef AY_LEVEL
+
+}
+
+//
+// Reference generator - steps every counter one chip tact at a time. Only desktop/sound_bench uses it, to check
+// gen_sound against it
+//
+void AySound::gen_sound_per_tact(int sound_bufsize, int bufpos)
 {
 
     int tmpvol;
@@ -444,6 +583,48 @@ void AySound::gen_sound(int sound_bufsize, int bufpos)
 
 }
 
+//
+// Generate the samples for the part of the frame before the given t-state
+//
+void AySound::renderUpTo(uint32_t tstate)
+{
+    int sample = (uint64_t) tstate * SAMPLES_PER_FRAME / frameTStates;
+    if (sample > SAMPLES_PER_FRAME) sample = SAMPLES_PER_FRAME;
+    if (sample > renderedSamples) {
+        gen_sound(sample - renderedSamples, renderedSamples);
+        renderedSamples = sample;
+    }
+}
+
+void AySound::applyWrite(uint32_t write)
+{
+    int reg = (write >> 8) & 0x0f;
+    regs[reg] = write & 0xff;
+    updateReg[reg]();
+}
+
+//
+// Apply the logged writes at the samples they happened on and generate the samples up to the given t-state
+//
+void AySound::flushWriteLog(uint32_t upToTState)
+{
+    for (int i = 0; i < writeLogCount; i++) {
+        renderUpTo(writeLog[i] >> 12);
+        applyWrite(writeLog[i]);
+    }
+    writeLogCount = 0;
+    renderUpTo(upToTState);
+}
+
+//
+// Generate a frame of sound, applying each register write at the sample it happened on
+//
+void AySound::gen_frame()
+{
+    flushWriteLog(frameTStates);
+    renderedSamples = 0;
+}
+
 void AySound::updToneA() {
     ayregs.tone_a = regs[0] + ((regs[1] & 0x0f) << 8);
 }
@@ -513,28 +694,29 @@ void AySound::updIOPortB() {
 uint8_t AySound::getRegisterData()
 {
 
-    if ((selectedRegister >= 14) && ((regs[7] >> (selectedRegister - 8)) & 1) == 0) {
+    if ((selectedRegister >= 14) && ((cpuRegs[7] >> (selectedRegister - 8)) & 1) == 0) {
         // printf("getAYRegister %d: %02X\n", selectedRegister, 0xFF);
         return 0xFF;
     }
 
+    // the CPU sees its own writes straight away, even though they haven't been rendered yet
     switch(selectedRegister) {
-      case 0x00: return ayregs.tone_a & 0xff;
-      case 0x01: return (ayregs.tone_a >> 8) & 0x0f;
-      case 0x02: return ayregs.tone_b & 0xff;
-      case 0x03: return (ayregs.tone_b >> 8) & 0x0f;
-      case 0x04: return ayregs.tone_c & 0xff;
-      case 0x05: return (ayregs.tone_c >> 8) & 0x0f;
-      case 0x06: return ayregs.noise & 0x1f;
-      case 0x07: return regs[7];
-      case 0x08: return ayregs.env_a + ayregs.vol_a;
-      case 0x09: return ayregs.env_b + ayregs.vol_b;
-      case 0x0a: return ayregs.env_c + ayregs.vol_c;
-      case 0x0b: return ayregs.env_freq & 0x00ff;
-      case 0x0c: return ayregs.env_freq >> 8;
-      case 0x0d: return ayregs.env_style & 0x0f;
-      case 0x0e: return ayregs.IOPortA;
-      case 0x0f: return ayregs.IOPortB;
+      case 0x00: return cpuRegs[0];
+      case 0x01: return cpuRegs[1] & 0x0f;
+      case 0x02: return cpuRegs[2];
+      case 0x03: return cpuRegs[3] & 0x0f;
+      case 0x04: return cpuRegs[4];
+      case 0x05: return cpuRegs[5] & 0x0f;
+      case 0x06: return cpuRegs[6] & 0x1f;
+      case 0x07: return cpuRegs[7];
+      case 0x08: return cpuRegs[8] & 0x1f;
+      case 0x09: return cpuRegs[9] & 0x1f;
+      case 0x0a: return cpuRegs[10] & 0x1f;
+      case 0x0b: return cpuRegs[11];
+      case 0x0c: return cpuRegs[12];
+      case 0x0d: return cpuRegs[13] & 0x0f;
+      case 0x0e: return cpuRegs[14];
+      case 0x0f: return cpuRegs[15];
     }
     
     return 0;
@@ -546,16 +728,62 @@ void AySound::selectRegister(uint8_t registerNumber)
     selectedRegister = registerNumber;
 }
 
-void AySound::setRegisterData(uint8_t data)
+void AySound::setRegisterData(uint8_t data, uint32_t tstate)
 {
 
     if (selectedRegister < 16) {
-        regs[selectedRegister] = data;
-        updateReg[selectedRegister]();
+        cpuRegs[selectedRegister] = data;
+        if (writeLogCount == AY_WRITE_LOG_SIZE) {
+            // out of space - render everything up to now and apply the logged writes
+            flushWriteLog(tstate);
+        }
+        writeLog[writeLogCount++] = (tstate << 12) | (selectedRegister << 8) | data;
     }
 
 }
 
+void AySound::getState(ayemu_state_t *state)
+{
+    memcpy(state->regs, regs, 16);
+    memcpy(state->cpuRegs, cpuRegs, 16);
+    state->selectedRegister = selectedRegister;
+    state->bit_a = bit_a;
+    state->bit_b = bit_b;
+    state->bit_c = bit_c;
+    state->bit_n = bit_n;
+    state->cnt_a = cnt_a;
+    state->cnt_b = cnt_b;
+    state->cnt_c = cnt_c;
+    state->cnt_n = cnt_n;
+    state->cnt_e = cnt_e;
+    state->EnvNum = EnvNum;
+    state->env_pos = env_pos;
+    state->Cur_Seed = Cur_Seed;
+}
+
+void AySound::setState(const ayemu_state_t *state)
+{
+    memcpy(regs, state->regs, 16);
+    memcpy(cpuRegs, state->cpuRegs, 16);
+    selectedRegister = state->selectedRegister;
+    // this restarts the envelope so the counters have to go back after it
+    for(int i=0; i < 16; i++) updateReg[i]();
+    bit_a = state->bit_a;
+    bit_b = state->bit_b;
+    bit_c = state->bit_c;
+    bit_n = state->bit_n;
+    cnt_a = state->cnt_a;
+    cnt_b = state->cnt_b;
+    cnt_c = state->cnt_c;
+    cnt_n = state->cnt_n;
+    cnt_e = state->cnt_e;
+    EnvNum = state->EnvNum;
+    env_pos = state->env_pos;
+    Cur_Seed = state->Cur_Seed;
+    writeLogCount = 0;
+    renderedSamples = 0;
+}
+
 void AySound::reset()
 {
 
@@ -575,9 +803,12 @@ void AySound::reset()
 
     prepare_generation();
 
-    for (int i=0;i<16;i++) regs[i] = 0; // All registers are set to 0
+    for (int i=0;i<16;i++) regs[i] = cpuRegs[i] = 0; // All registers are set to 0
     
-    regs[7] = 0xff; // Mixer register
+    regs[7] = cpuRegs[7] = 0xff; // Mixer register
+
+    writeLogCount = 0;
+    renderedSamples = 0;
 
     selectedRegister = 0xff;
 
@@ -42,6 +42,8 @@ visit https://zxespectrum.speccy.org/contacto
 #include <stddef.h>
 
 #define SAMPLES_PER_FRAME 312
+// number of register writes we buffer before rendering the part of the frame they cover
+#define AY_WRITE_LOG_SIZE 256
 
 // typedef unsigned char ayemu_ay_reg_frame_t[14];
 
@@ -118,6 +120,20 @@ typedef struct
 }
 ayemu_regdata_t;
 
+/** generator state, saved and restored with the rest of the machine \internal */
+typedef struct
+{
+    uint8_t regs[16];         /**< registers as seen by the sound generator */
+    uint8_t cpuRegs[16];      /**< registers as seen by the CPU */
+    uint8_t selectedRegister;
+    int bit_a, bit_b, bit_c, bit_n;
+    int cnt_a, cnt_b, cnt_c, cnt_n, cnt_e;
+    int EnvNum;
+    int env_pos;
+    int Cur_Seed;
+}
+ayemu_state_t;
+
 /** Output sound format \internal */
 typedef struct
 {
@@ -147,15 +163,21 @@ public:
     static void reset();
     static uint8_t getRegisterData();
     static void selectRegister(uint8_t data);
-    static void setRegisterData(uint8_t data);
+    static void setRegisterData(uint8_t data, uint32_t tstate);
+    // the state of the chip between frames - see ZXSpectrum::saveState
+    static void getState(ayemu_state_t *state);
+    static void setState(const ayemu_state_t *state);
 
     static void init();
     static int set_chip_type(ayemu_chip_t chip, int *custom_table);
     static void set_chip_freq(int chipfreq);
     static int set_stereo(ayemu_stereo_t stereo, int *custom_eq);
     static int set_sound_format(int freq, int chans, int bits);
+    static void set_frame_tstates(int tstates);
     static void prepare_generation();
     static void gen_sound(int bufsize, int bufpos);
+    static void gen_sound_per_tact(int bufsize, int bufpos);
+    static void gen_frame();
 
     static void(*updateReg[16])();
 
@@ -198,9 +220,20 @@ private:
     static int env_pos;                     /**< current position in envelop (0...127) */
     static int Cur_Seed;                    /**< random numbers counter */
 
-    static uint8_t regs[16];
+    static uint8_t regs[16];                /**< registers as seen by the sound generator */
+    static uint8_t cpuRegs[16];             /**< registers as seen by the CPU - these lead regs until the frame is rendered */
     static uint8_t selectedRegister;
 
+    // register writes waiting to be applied - t-state in the upper bits, register and value in the bottom 12 bits
+    static uint32_t writeLog[AY_WRITE_LOG_SIZE];
+    static int writeLogCount;
+    static int frameTStates;                /**< length of a frame in t-states */
+    static int renderedSamples;             /**< samples of the current frame that have already been generated */
+
+    static void applyWrite(uint32_t write);
+    static void renderUpTo(uint32_t tstate);
+    static void flushWriteLog(uint32_t upToTState);
+
 };
 
 #endif // AySound_h
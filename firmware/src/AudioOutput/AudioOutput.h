@@ -46,4 +46,7 @@ public:
   int getVolume() {
     return mVolume;
   }
+  ISettings *getSettings() {
+    return mSettings;
+  }
 };
@@ -0,0 +1,125 @@
+#include <math.h>
+#include <string.h>
+#include "Resampler.h"
+
+Resampler::Resampler(double inputRate, double outputRate)
+{
+  setRates(inputRate, outputRate);
+}
+
+void Resampler::setRates(double inputRate, double outputRate)
+{
+  this->inputRate = inputRate;
+  this->outputRate = outputRate;
+  buildCoefficients();
+  updateStep();
+  reset();
+}
+
+void Resampler::buildCoefficients()
+{
+  // cut off just below the nyquist frequency of whichever rate is lower
+  double cutoff = 0.45;
+  if (outputRate < inputRate)
+  {
+    cutoff *= outputRate / inputRate;
+  }
+  for (int phase = 0; phase <= PHASES; phase++)
+  {
+    double taps[TAPS];
+    double sum = 0;
+    for (int i = 0; i < TAPS; i++)
+    {
+      // distance in input samples from the output position to this tap
+      double x = (double)phase / PHASES + TAPS / 2 - 1 - i;
+      double sinc = x == 0 ? 1.0 : sin(2 * M_PI * cutoff * x) / (2 * M_PI * cutoff * x);
+      // blackman window
+      double w = (x + TAPS / 2) / TAPS;
+      double window = 0.42 - 0.5 * cos(2 * M_PI * w) + 0.08 * cos(4 * M_PI * w);
+      taps[i] = sinc * window;
+      sum += taps[i];
+    }
+    // normalise to unity gain
+    for (int i = 0; i < TAPS; i++)
+    {
+      coefficients[phase][i] = (int16_t)lround(taps[i] * 16384 / sum);
+    }
+  }
+}
+
+void Resampler::updateStep()
+{
+  step = (uint64_t)(inputRate / outputRate * (1.0 + rateAdjust) * 4294967296.0);
+}
+
+void Resampler::setRateAdjust(double adjust)
+{
+  rateAdjust = adjust;
+  updateStep();
+}
+
+void Resampler::reset()
+{
+  buffer.assign(TAPS, 0);
+  buffered = TAPS;
+  // start far enough in that the first output has a full set of taps behind it
+  position = (uint64_t)(TAPS / 2 - 1) << 32;
+}
+
+int Resampler::maxOutput(int count)
+{
+  return (int)((((uint64_t)count << 32) / step) + 2);
+}
+
+int Resampler::process(const uint8_t *input, int count, int16_t *output, int maxOutput)
+{
+  // add the new samples after the history
+  if ((int)buffer.size() < buffered + count)
+  {
+    buffer.resize(buffered + count);
+  }
+  for (int i = 0; i < count; i++)
+  {
+    buffer[buffered + i] = ((int)input[i] - 128) << 8;
+  }
+  buffered += count;
+
+  int outputCount = 0;
+  while (outputCount < maxOutput)
+  {
+    int index = position >> 32;
+    // we need TAPS/2 samples after the current position
+    if (index + TAPS / 2 >= buffered)
+    {
+      break;
+    }
+    uint32_t fraction = (uint32_t)position;
+    int phase = fraction >> 26;
+    // how far we are between this phase and the next in Q16
+    int32_t weight = (fraction >> 10) & 0xFFFF;
+    const int16_t *samples = &buffer[index - TAPS / 2 + 1];
+    const int16_t *c0 = coefficients[phase];
+    const int16_t *c1 = coefficients[phase + 1];
+    int32_t y0 = 0;
+    int32_t y1 = 0;
+    for (int i = 0; i < TAPS; i++)
+    {
+      y0 += samples[i] * c0[i];
+      y1 += samples[i] * c1[i];
+    }
+    int32_t y = (y0 + (int32_t)(((int64_t)(y1 - y0) * weight) >> 16)) >> 14;
+    output[outputCount++] = y > 32767 ? 32767 : (y < -32768 ? -32768 : y);
+    position += step;
+  }
+
+  // drop the samples we no longer need, keeping enough history for the next call
+  int index = position >> 32;
+  int keepFrom = index - TAPS / 2 + 1;
+  if (keepFrom > 0)
+  {
+    memmove(&buffer[0], &buffer[keepFrom], (buffered - keepFrom) * sizeof(int16_t));
+    buffered -= keepFrom;
+    position -= (uint64_t)keepFrom << 32;
+  }
+  return outputCount;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Fixed point polyphase resampler
+ *
+ * Converts the machine's 8 bit unsigned audio to signed 16 bit at another sample rate. The
+ * filter is a windowed sinc stored as a table of PHASES sub-sample positions, we interpolate
+ * between neighbouring phases so any ratio works - not just nice integer ones.
+ *
+ * It's a streaming API - feed it a frame at a time and it carries its history and position
+ * across calls so there are no discontinuities at frame boundaries.
+ **/
+class Resampler
+{
+public:
+  static const int PHASES = 64;
+  static const int TAPS = 16;
+
+private:
+  // coefficients in Q14 - one extra phase so we can always interpolate with the next one
+  int16_t coefficients[PHASES + 1][TAPS];
+  // previous input samples followed by the ones we are currently processing
+  std::vector<int16_t> buffer;
+  int buffered = 0;
+  // position in buffer in 32.32 fixed point
+  uint64_t position = 0;
+  // how far to move through the input for each output sample in 32.32 fixed point
+  uint64_t step = 0;
+  double inputRate;
+  double outputRate;
+  double rateAdjust = 0;
+
+  void buildCoefficients();
+  void updateStep();
+
+public:
+  Resampler(double inputRate, double outputRate);
+  // change the rates - this rebuilds the filter
+  void setRates(double inputRate, double outputRate);
+  // bend the conversion ratio slightly - used to keep buffers at a constant fill level
+  void setRateAdjust(double adjust);
+  // forget the history
+  void reset();
+  // maximum number of samples that process will output for count input samples
+  int maxOutput(int count);
+  // resample count input samples, returns the number of samples written to output
+  int process(const uint8_t *input, int count, int16_t *output, int maxOutput);
+};
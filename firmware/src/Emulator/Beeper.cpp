@@ -0,0 +1,160 @@
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "Beeper.h"
+
+Beeper::Beeper()
+{
+  buildKernel();
+  setTiming(frameTStates, samplesPerFrame);
+}
+
+Beeper::~Beeper()
+{
+  free(deltas);
+}
+
+void Beeper::buildKernel()
+{
+  // windowed sinc low pass just under the nyquist frequency
+  const double cutoff = 0.45;
+  for (int phase = 0; phase < PHASES; phase++)
+  {
+    double taps[TAPS];
+    double sum = 0;
+    for (int i = 0; i < TAPS; i++)
+    {
+      // distance of this tap from the centre of the step
+      double x = (i - TAPS / 2) - (double)phase / PHASES;
+      double sinc = x == 0 ? 1.0 : sin(2 * M_PI * cutoff * x) / (2 * M_PI * cutoff * x);
+      // blackman window over the width of the kernel
+      double w = (x + TAPS / 2) / TAPS;
+      double window = 0.42 - 0.5 * cos(2 * M_PI * w) + 0.08 * cos(4 * M_PI * w);
+      taps[i] = sinc * window;
+      sum += taps[i];
+    }
+    // normalise so that each phase sums to exactly 1 << 15 - otherwise the integrator would drift
+    int total = 0;
+    int largest = 0;
+    for (int i = 0; i < TAPS; i++)
+    {
+      kernel[phase][i] = (int16_t)lround(taps[i] * 32768 / sum);
+      total += kernel[phase][i];
+      if (kernel[phase][i] > kernel[phase][largest])
+      {
+        largest = i;
+      }
+    }
+    kernel[phase][largest] += 32768 - total;
+  }
+}
+
+void Beeper::setTiming(int frameTStates, int samplesPerFrame)
+{
+  this->frameTStates = frameTStates;
+  this->samplesPerFrame = samplesPerFrame;
+  free(deltas);
+  // leave room for the tail of the steps and transitions that overshoot the end of the frame
+  deltaSize = samplesPerFrame + TAIL;
+  deltas = (int32_t *)malloc(deltaSize * sizeof(int32_t));
+  if (deltas == nullptr)
+  {
+    printf("Failed to allocate beeper buffer\n");
+    deltaSize = 0;
+  }
+  reset();
+}
+
+void Beeper::reset()
+{
+  logCount = 0;
+  level = false;
+  synthLevel = false;
+  integrator = 0;
+  if (deltas)
+  {
+    memset(deltas, 0, deltaSize * sizeof(int32_t));
+  }
+}
+
+void Beeper::getState(State &state)
+{
+  flushLog();
+  state.level = level;
+  state.synthLevel = synthLevel;
+  state.integrator = integrator;
+  memset(state.tail, 0, sizeof(state.tail));
+  if (deltaSize > 0)
+  {
+    memcpy(state.tail, deltas, sizeof(state.tail));
+  }
+}
+
+void Beeper::setState(const State &state)
+{
+  reset();
+  level = state.level;
+  synthLevel = state.synthLevel;
+  integrator = state.integrator;
+  if (deltaSize > 0)
+  {
+    memcpy(deltas, state.tail, sizeof(state.tail));
+  }
+}
+
+void Beeper::addStep(uint32_t tstate, int delta)
+{
+  if (deltaSize == 0)
+  {
+    return;
+  }
+  uint64_t position = (uint64_t)tstate * samplesPerFrame * PHASES / frameTStates;
+  int index = position / PHASES;
+  int phase = position % PHASES;
+  if (index > deltaSize - TAPS)
+  {
+    // should only happen if we've been run outside of the frame loop
+    index = deltaSize - TAPS;
+  }
+  int32_t *dest = deltas + index;
+  const int16_t *taps = kernel[phase];
+  for (int i = 0; i < TAPS; i++)
+  {
+    dest[i] += delta * taps[i];
+  }
+}
+
+void Beeper::flushLog()
+{
+  for (int i = 0; i < logCount; i++)
+  {
+    bool newLevel = log[i] & 1;
+    if (newLevel != synthLevel)
+    {
+      addStep(log[i] >> 1, newLevel ? VOLUME : -VOLUME);
+      synthLevel = newLevel;
+    }
+  }
+  logCount = 0;
+}
+
+void Beeper::endFrame(uint8_t *samples)
+{
+  flushLog();
+  if (deltaSize == 0)
+  {
+    memset(samples, SILENCE, samplesPerFrame);
+    return;
+  }
+  for (int i = 0; i < samplesPerFrame; i++)
+  {
+    integrator += deltas[i];
+    int value = (integrator >> 15) + SILENCE;
+    samples[i] = value < 0 ? 0 : (value > 255 ? 255 : value);
+  }
+  // move the tail of any steps that spill into the next frame down to the start of the buffer
+  int remaining = deltaSize - samplesPerFrame;
+  memmove(deltas, deltas + samplesPerFrame, remaining * sizeof(int32_t));
+  memset(deltas + remaining, 0, samplesPerFrame * sizeof(int32_t));
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+// Band limited beeper synthesis
+//
+// Instead of sampling the speaker bit after every instruction we log each transition of the speaker
+// along with the t-state it happened on. At the end of the frame each transition is turned into a
+// band limited step (BLEP) at the output sample rate - so the cost is proportional to the number of
+// transitions and not the number of instructions executed.
+class Beeper
+{
+public:
+  // number of sub-sample positions a transition can be placed at
+  static const int PHASES = 32;
+  // width of the band limited step in output samples
+  static const int TAPS = 16;
+  // transitions we buffer before pushing them into the synthesiser
+  static const int LOG_SIZE = 512;
+  // output level when the speaker bit is set - matches the old 224 cycles / 4 per sample scaling
+  static const int VOLUME = 56;
+  // output level when the speaker is off - the steps ring below it so it's lifted off zero to keep them
+  // from being clipped
+  static const int SILENCE = 20;
+  // the tail of the steps that spills over into the next frame
+  static const int TAIL = TAPS + 4;
+
+  // what carries over from one frame to the next - see ZXSpectrum::saveState
+  struct State
+  {
+    bool level;
+    bool synthLevel;
+    int32_t integrator;
+    int32_t tail[TAIL];
+  };
+
+private:
+  // the log of transitions - t-state in the upper bits, the new speaker level in bit 0
+  uint32_t log[LOG_SIZE];
+  int logCount = 0;
+  // the current speaker level
+  bool level = false;
+  // the level that has been pushed into the synthesiser
+  bool synthLevel = false;
+  // the band limited step - each phase sums to 1 << 15
+  int16_t kernel[PHASES][TAPS];
+  // the deltas waiting to be integrated into samples - big enough for a frame plus the tail of the steps
+  int32_t *deltas = nullptr;
+  int deltaSize = 0;
+  // running sum of the deltas
+  int32_t integrator = 0;
+  // how the frame t-states map on to output samples
+  int frameTStates = 69888;
+  int samplesPerFrame = 312;
+
+  void buildKernel();
+  void flushLog();
+  void addStep(uint32_t tstate, int delta);
+
+public:
+  Beeper();
+  ~Beeper();
+  // set the length of a frame in t-states and how many samples we should output for it
+  void setTiming(int frameTStates, int samplesPerFrame);
+  // silence the speaker and drop anything that has been logged
+  void reset();
+  // log a change in the speaker level at the given frame t-state
+  inline void setLevel(uint32_t tstate, bool newLevel)
+  {
+    if (newLevel == level)
+    {
+      return;
+    }
+    level = newLevel;
+    if (logCount == LOG_SIZE)
+    {
+      flushLog();
+    }
+    log[logCount++] = (tstate << 1) | (newLevel ? 1 : 0);
+  }
+  // the state between frames - anything logged is pushed into the synthesiser first
+  void getState(State &state);
+  void setState(const State &state);
+  // render the frame's samples into samples (which must hold samplesPerFrame samples)
+  void endFrame(uint8_t *samples);
+};
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+#include "spectrum.h"
+#include "BootImage.h"
+
+static const uint8_t banks48k[] = {5, 2, 0};
+static const uint8_t banks128k[] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+int bootImageBanks(int model, const uint8_t **banks)
+{
+  if (model == SPECMDL_128K)
+  {
+    *banks = banks128k;
+    return sizeof(banks128k);
+  }
+  *banks = banks48k;
+  return sizeof(banks48k);
+}
+
+uint32_t bootImageRomHash(ZXSpectrum *machine)
+{
+  uint32_t hash = 0x811c9dc5;
+  int roms = machine->hwopt.hw_model == SPECMDL_128K ? 2 : 1;
+  for (int rom = 0; rom < roms; rom++)
+  {
+    const uint8_t *data = machine->mem.rom[rom]->data;
+    for (int i = 0; i < 0x4000; i++)
+    {
+      hash = (hash ^ data[i]) * 0x01000193;
+    }
+  }
+  return hash;
+}
+
+static void tapKey(ZXSpectrum *machine, SpecKeys key)
+{
+  machine->updateKey(key, 1);
+  for (int i = 0; i < 10; i++)
+  {
+    machine->runForFrame(nullptr, nullptr);
+  }
+  machine->updateKey(key, 0);
+  for (int i = 0; i < 10; i++)
+  {
+    machine->runForFrame(nullptr, nullptr);
+  }
+}
+
+void bootToTapeLoader(ZXSpectrum *machine)
+{
+  for (int i = 0; i < 200; i++)
+  {
+    machine->runForFrame(nullptr, nullptr);
+  }
+  if (machine->hwopt.hw_model == SPECMDL_48K)
+  {
+    tapKey(machine, SPECKEY_J);
+    machine->updateKey(SPECKEY_SYMB, 1);
+    tapKey(machine, SPECKEY_P);
+    tapKey(machine, SPECKEY_P);
+    machine->updateKey(SPECKEY_SYMB, 0);
+    tapKey(machine, SPECKEY_ENTER);
+  }
+  else
+  {
+    // 128K the tape loader is first in the menu
+    tapKey(machine, SPECKEY_ENTER);
+  }
+}
+
+bool restoreBootImage(ZXSpectrum *machine)
+{
+  int model = machine->hwopt.hw_model;
+  const BootImage *image = model == SPECMDL_128K ? &bootImage128k : model == SPECMDL_48K ? &bootImage48k : nullptr;
+  if (!image || image->version != BOOT_IMAGE_VERSION || image->model != model)
+  {
+    printf("No boot image for this machine\n");
+    return false;
+  }
+  if (image->romHash != bootImageRomHash(machine))
+  {
+    printf("Boot image was made with a different ROM\n");
+    return false;
+  }
+  // unpack the RAM - runs never cross from one bank to the next
+  const uint8_t *banks;
+  int bankCount = bootImageBanks(model, &banks);
+  const uint8_t *src = image->ram;
+  const uint8_t *end = image->ram + image->ramLength;
+  for (int bank = 0; bank < bankCount; bank++)
+  {
+    MemoryPage *page = machine->mem.banks[banks[bank]];
+    int offset = 0;
+    while (offset < 0x4000 && src < end)
+    {
+      if (end - src >= 4 && src[0] == 0xED && src[1] == 0xED)
+      {
+        int count = src[2];
+        if (offset + count > 0x4000)
+        {
+          break;
+        }
+        memset(page->data + offset, src[3], count);
+        offset += count;
+        src += 4;
+      }
+      else
+      {
+        page->data[offset++] = *src++;
+      }
+    }
+    if (offset != 0x4000)
+    {
+      printf("Boot image is corrupt\n");
+      return false;
+    }
+    page->isDirty = true;
+  }
+  Z80Regs *regs = machine->z80Regs;
+  regs->AF.W = image->AF;
+  regs->BC.W = image->BC;
+  regs->DE.W = image->DE;
+  regs->HL.W = image->HL;
+  regs->IX.W = image->IX;
+  regs->IY.W = image->IY;
+  regs->PC.W = image->PC;
+  regs->SP.W = image->SP;
+  regs->R.W = image->R;
+  regs->AFs.W = image->AFs;
+  regs->BCs.W = image->BCs;
+  regs->DEs.W = image->DEs;
+  regs->HLs.W = image->HLs;
+  regs->IFF1 = image->IFF1;
+  regs->IFF2 = image->IFF2;
+  regs->I = image->I;
+  regs->halted = image->halted;
+  regs->IM = image->IM;
+  regs->IRequest = image->IRequest;
+  regs->we_are_on_ddfd = 0;
+  regs->cycles = image->cycles;
+  machine->mem.page(image->hwBank, true);
+  machine->hwopt.BorderColor = image->borderColor;
+  machine->hwopt.SoundBits = image->soundBits;
+  memset(machine->borderColors, image->borderColor & 0x07, sizeof(machine->borderColors));
+  machine->micLevel = image->micLevel;
+  machine->romLoadingRoutineHit = image->romLoadingRoutineHit;
+  machine->tstates = image->tstates;
+  machine->beeper.reset();
+  machine->beeper.setLevel(0, image->soundBits != 0);
+  if (model == SPECMDL_128K)
+  {
+    // the writes are picked up at the start of the next frame
+    AySound::reset();
+    for (int i = 0; i < 16; i++)
+    {
+      AySound::selectRegister(i);
+      AySound::setRegisterData(image->ayRegisters[i], 0);
+    }
+  }
+  return true;
+}
+
+void readyToLoad(ZXSpectrum *machine)
+{
+  if (!restoreBootImage(machine))
+  {
+    bootToTapeLoader(machine);
+  }
+}
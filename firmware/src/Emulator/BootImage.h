@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+class ZXSpectrum;
+
+// bump this whenever the layout of BootImage or what goes into it changes - images from an older version are
+// ignored and the machine is booted the slow way
+#define BOOT_IMAGE_VERSION 1
+
+// The state of a machine that has booted and is waiting for a tape - the 48K has LOAD "" typed at the BASIC
+// prompt and the 128K has picked the Tape Loader from its menu.
+//
+// Booting the ROM and typing the keys takes over four seconds of emulated time. The images are made on the
+// desktop by make_boot_images which does exactly that and saves what it ends up with into boot_images.cpp,
+// so here we only have to copy the state back into the machine.
+struct BootImage
+{
+  uint32_t version;
+  int model;
+  // FNV-1a of the ROMs the image was made with
+  uint32_t romHash;
+  // the Z80
+  uint16_t AF, BC, DE, HL, IX, IY, PC, SP, R;
+  uint16_t AFs, BCs, DEs, HLs;
+  uint8_t IFF1, IFF2, I, halted;
+  int8_t IM;
+  uint16_t IRequest;
+  int cycles;
+  // the ULA and paging
+  uint8_t borderColor;
+  uint8_t soundBits;
+  uint8_t hwBank;
+  bool micLevel;
+  bool romLoadingRoutineHit;
+  int tstates;
+  // the AY registers - only used by the 128K
+  uint8_t ayRegisters[16];
+  // the RAM banks one after the other, with runs of the same byte stored as ED ED count byte
+  const uint8_t *ram;
+  uint32_t ramLength;
+};
+
+extern const BootImage bootImage48k;
+extern const BootImage bootImage128k;
+
+// the RAM banks that are saved in an image for the model - the 48K only has 5, 2 and 0
+int bootImageBanks(int model, const uint8_t **banks);
+// FNV-1a of the machine's ROMs
+uint32_t bootImageRomHash(ZXSpectrum *machine);
+// boot the ROM and type the keys to get it ready to load a tape - this is how the images are made
+void bootToTapeLoader(ZXSpectrum *machine);
+// put the machine into the state from its model's boot image - returns false if there isn't a usable image
+bool restoreBootImage(ZXSpectrum *machine);
+// get a machine that has just been reset ready to load a tape - from the boot image if we can
+void readyToLoad(ZXSpectrum *machine);
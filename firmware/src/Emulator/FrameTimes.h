@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// A histogram of how long each frame took to emulate. The buckets double in size - the first is anything
+// under 64us and the last is anything over 32ms - so a frame that goes over the 20ms a frame has stands out.
+class FrameTimes
+{
+public:
+  static const int BUCKETS = 11;
+  uint32_t counts[BUCKETS] = {0};
+  uint32_t frames = 0;
+  uint32_t worst = 0;
+
+  void add(uint32_t micros)
+  {
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && micros >= (64u << bucket))
+    {
+      bucket++;
+    }
+    counts[bucket]++;
+    frames++;
+    if (micros > worst)
+    {
+      worst = micros;
+    }
+  }
+  void reset()
+  {
+    *this = FrameTimes();
+  }
+  // one line with the buckets that have something in them
+  void print(const char *name)
+  {
+    printf("%s frame times:", name);
+    for (int bucket = 0; bucket < BUCKETS; bucket++)
+    {
+      if (counts[bucket])
+      {
+        if (bucket < BUCKETS - 1)
+        {
+          printf(" <%dus:%d", 64 << bucket, (int)counts[bucket]);
+        }
+        else
+        {
+          printf(" >=%dus:%d", 64 << (bucket - 1), (int)counts[bucket]);
+        }
+      }
+    }
+    printf(" worst %dus\n", (int)worst);
+  }
+};
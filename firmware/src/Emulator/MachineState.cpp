@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <string.h>
+#include "spectrum.h"
+#include "MachineState.h"
+
+static const uint8_t stateMagic[4] = {'Z', 'X', 'S', 'T'};
+
+// the RAM banks a model actually has
+static uint8_t modelBanks(int model)
+{
+  return model == SPECMDL_128K ? 0xFF : 0x25;
+}
+
+static int bankCount(uint8_t banks)
+{
+  int count = 0;
+  for (int i = 0; i < 8; i++)
+  {
+    count += (banks >> i) & 1;
+  }
+  return count;
+}
+
+// writes little endian values - with no buffer it just counts how much space they take
+class StateWriter
+{
+private:
+  uint8_t *buffer;
+  size_t offset = 0;
+
+public:
+  StateWriter(uint8_t *buffer) : buffer(buffer) {}
+  size_t length()
+  {
+    return offset;
+  }
+  void u8(uint8_t value)
+  {
+    if (buffer)
+    {
+      buffer[offset] = value;
+    }
+    offset++;
+  }
+  void u16(uint16_t value)
+  {
+    u8(value);
+    u8(value >> 8);
+  }
+  void u32(uint32_t value)
+  {
+    u16(value);
+    u16(value >> 16);
+  }
+  void bytes(const uint8_t *data, size_t length)
+  {
+    if (buffer)
+    {
+      memcpy(buffer + offset, data, length);
+    }
+    offset += length;
+  }
+};
+
+// reads them back - running off the end gives zeros and clears ok
+class StateReader
+{
+private:
+  const uint8_t *buffer;
+  size_t size;
+  size_t offset = 0;
+
+public:
+  bool ok = true;
+  StateReader(const uint8_t *buffer, size_t size) : buffer(buffer), size(size) {}
+  uint8_t u8()
+  {
+    if (offset >= size)
+    {
+      ok = false;
+      return 0;
+    }
+    return buffer[offset++];
+  }
+  uint16_t u16()
+  {
+    uint16_t value = u8();
+    return value | (u8() << 8);
+  }
+  uint32_t u32()
+  {
+    uint32_t value = u16();
+    return value | ((uint32_t)u16() << 16);
+  }
+  void bytes(uint8_t *data, size_t length)
+  {
+    if (length > size - offset)
+    {
+      ok = false;
+      memset(data, 0, length);
+      return;
+    }
+    memcpy(data, buffer + offset, length);
+    offset += length;
+  }
+};
+
+// everything apart from the header and the RAM banks - the order here is the file format
+static void writeMachine(ZXSpectrum *machine, StateWriter &writer)
+{
+  Z80Regs *regs = machine->z80Regs;
+  const eword *words[] = {&regs->AF, &regs->BC, &regs->DE, &regs->HL, &regs->IX, &regs->IY, &regs->PC,
+                          &regs->SP, &regs->R, &regs->AFs, &regs->BCs, &regs->DEs, &regs->HLs};
+  for (const eword *word : words)
+  {
+    writer.u16(word->W);
+  }
+  writer.u8(regs->IFF1);
+  writer.u8(regs->IFF2);
+  writer.u8(regs->I);
+  writer.u8(regs->halted);
+  writer.u8(regs->IM);
+  writer.u16(regs->IRequest);
+  writer.u8(regs->we_are_on_ddfd);
+  writer.u32(regs->cycles);
+  // the ULA, paging and what's plugged in
+  writer.u8(machine->mem.hwBank);
+  writer.u8(machine->hwopt.BorderColor);
+  writer.u8(machine->hwopt.SoundBits);
+  writer.u8(machine->hwopt.portFF);
+  writer.u8(machine->kempston_port);
+  writer.u8(machine->ulaport_FF);
+  writer.u8(machine->micLevel);
+  writer.u8(machine->romLoadingRoutineHit);
+  writer.u32(machine->tstates);
+  writer.bytes(speckey, 8);
+  writer.bytes(machine->borderColors, sizeof(machine->borderColors));
+  // the speaker - the tail of the last frame's steps is still to be played
+  Beeper::State beeper;
+  machine->beeper.getState(beeper);
+  writer.u8(beeper.level);
+  writer.u8(beeper.synthLevel);
+  writer.u32(beeper.integrator);
+  for (int i = 0; i < Beeper::TAIL; i++)
+  {
+    writer.u32(beeper.tail[i]);
+  }
+  // the AY is only there on the 128K
+  if (machine->hwopt.hw_model == SPECMDL_128K)
+  {
+    ayemu_state_t ay;
+    AySound::getState(&ay);
+    writer.bytes(ay.regs, 16);
+    writer.bytes(ay.cpuRegs, 16);
+    writer.u8(ay.selectedRegister);
+    const int values[] = {ay.bit_a, ay.bit_b, ay.bit_c, ay.bit_n, ay.cnt_a, ay.cnt_b, ay.cnt_c, ay.cnt_n,
+                          ay.cnt_e, ay.EnvNum, ay.env_pos, ay.Cur_Seed};
+    for (int value : values)
+    {
+      writer.u32(value);
+    }
+  }
+}
+
+static void readMachine(ZXSpectrum *machine, StateReader &reader)
+{
+  Z80Regs *regs = machine->z80Regs;
+  eword *words[] = {&regs->AF, &regs->BC, &regs->DE, &regs->HL, &regs->IX, &regs->IY, &regs->PC,
+                    &regs->SP, &regs->R, &regs->AFs, &regs->BCs, &regs->DEs, &regs->HLs};
+  for (eword *word : words)
+  {
+    word->W = reader.u16();
+  }
+  regs->IFF1 = reader.u8();
+  regs->IFF2 = reader.u8();
+  regs->I = reader.u8();
+  regs->halted = reader.u8();
+  regs->IM = reader.u8();
+  regs->IRequest = reader.u16();
+  regs->we_are_on_ddfd = reader.u8();
+  regs->cycles = reader.u32();
+  machine->mem.page(reader.u8(), true);
+  machine->hwopt.BorderColor = reader.u8();
+  machine->hwopt.SoundBits = reader.u8();
+  machine->hwopt.portFF = reader.u8();
+  machine->kempston_port = reader.u8();
+  machine->ulaport_FF = reader.u8();
+  machine->micLevel = reader.u8();
+  machine->romLoadingRoutineHit = reader.u8();
+  machine->tstates = reader.u32();
+  reader.bytes(speckey, 8);
+  reader.bytes(machine->borderColors, sizeof(machine->borderColors));
+  Beeper::State beeper;
+  beeper.level = reader.u8();
+  beeper.synthLevel = reader.u8();
+  beeper.integrator = reader.u32();
+  for (int i = 0; i < Beeper::TAIL; i++)
+  {
+    beeper.tail[i] = reader.u32();
+  }
+  machine->beeper.setState(beeper);
+  if (machine->hwopt.hw_model == SPECMDL_128K)
+  {
+    ayemu_state_t ay;
+    reader.bytes(ay.regs, 16);
+    reader.bytes(ay.cpuRegs, 16);
+    ay.selectedRegister = reader.u8();
+    int *values[] = {&ay.bit_a, &ay.bit_b, &ay.bit_c, &ay.bit_n, &ay.cnt_a, &ay.cnt_b, &ay.cnt_c, &ay.cnt_n,
+                     &ay.cnt_e, &ay.EnvNum, &ay.env_pos, &ay.Cur_Seed};
+    for (int *value : values)
+    {
+      *value = reader.u32();
+    }
+    AySound::setState(&ay);
+  }
+}
+
+size_t ZXSpectrum::stateSize(bool withBanks)
+{
+  StateWriter counter(nullptr);
+  writeMachine(this, counter);
+  size_t size = MACHINE_STATE_HEADER_SIZE + counter.length();
+  if (withBanks)
+  {
+    size += bankCount(modelBanks(hwopt.hw_model)) * 0x4000;
+  }
+  return size;
+}
+
+size_t ZXSpectrum::saveState(uint8_t *buffer, size_t size, MachineStatePages *pages)
+{
+  if (!buffer || size < stateSize(false))
+  {
+    return 0;
+  }
+  // find out which banks we have to copy
+  uint8_t banks = 0;
+  uint8_t available = modelBanks(hwopt.hw_model);
+  for (int i = 0; i < 8; i++)
+  {
+    if ((available >> i) & 1 && !(pages && pages->savePage(i, mem.banks[i])))
+    {
+      banks |= 1 << i;
+    }
+  }
+  size_t length = stateSize(false) + bankCount(banks) * 0x4000;
+  if (size < length)
+  {
+    return 0;
+  }
+  StateWriter writer(buffer);
+  writer.bytes(stateMagic, 4);
+  writer.u16(MACHINE_STATE_VERSION);
+  writer.u8(hwopt.hw_model);
+  writer.u8(banks);
+  writer.u32(length);
+  writeMachine(this, writer);
+  for (int i = 0; i < 8; i++)
+  {
+    if ((banks >> i) & 1)
+    {
+      writer.bytes(mem.banks[i]->data, 0x4000);
+    }
+  }
+  return writer.length();
+}
+
+bool ZXSpectrum::loadState(const uint8_t *buffer, size_t size, MachineStatePages *pages)
+{
+  StateReader reader(buffer, size);
+  uint8_t magic[4];
+  reader.bytes(magic, 4);
+  uint16_t version = reader.u16();
+  int model = reader.u8();
+  uint8_t banks = reader.u8();
+  uint32_t length = reader.u32();
+  if (!reader.ok || memcmp(magic, stateMagic, 4) != 0)
+  {
+    printf("Not a saved state\n");
+    return false;
+  }
+  if (version != MACHINE_STATE_VERSION)
+  {
+    printf("Saved state is version %d - we can only load version %d\n", version, MACHINE_STATE_VERSION);
+    return false;
+  }
+  if ((model != SPECMDL_48K && model != SPECMDL_128K) || (banks & ~modelBanks(model)) || length > size)
+  {
+    printf("Saved state is corrupt\n");
+    return false;
+  }
+  if (hwopt.hw_model != model)
+  {
+    init_spectrum(model);
+  }
+  // now we know the model we can check that the length adds up before we change anything
+  if (length != stateSize(false) + bankCount(banks) * 0x4000)
+  {
+    printf("Saved state is corrupt\n");
+    return false;
+  }
+  readMachine(this, reader);
+  uint8_t available = modelBanks(model);
+  for (int i = 0; i < 8; i++)
+  {
+    if ((banks >> i) & 1)
+    {
+      mem.banks[i]->beforeWrite();
+      reader.bytes(mem.banks[i]->data, 0x4000);
+      mem.banks[i]->isDirty = true;
+    }
+    else if ((available >> i) & 1 && !(pages && pages->loadPage(i, mem.banks[i])))
+    {
+      printf("Saved state is missing RAM bank %d\n", i);
+      return false;
+    }
+  }
+  return reader.ok;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class MemoryPage;
+
+// bump this whenever the layout of a saved state changes - older states won't load
+#define MACHINE_STATE_VERSION 1
+
+// A saved state is everything we need to carry on running a machine from the end of a frame - the Z80, the
+// ULA and paging, the keyboard and joystick, the speaker and the AY. Everything is written a byte at a time
+// in little endian order so a state can be kept in memory, written to a file or loaded on a different build.
+//
+//   "ZXST" version:16 model:8 banks:8 length:32 then the machine then the RAM banks that are in the state
+//
+// banks has a bit set for each RAM bank that follows, in order from bank 0 up. A bank that isn't there was
+// kept by the MachineStatePages that the state was saved with and has to be given back by it when the state
+// is loaded - this is how time travel avoids copying banks that haven't changed.
+#define MACHINE_STATE_HEADER_SIZE 12
+
+// Somewhere to keep the RAM banks of a saved state other than in the state itself.
+class MachineStatePages
+{
+public:
+  virtual ~MachineStatePages() {}
+  // return true if the bank has been taken care of and shouldn't be copied into the state
+  virtual bool savePage(int bank, MemoryPage *page) = 0;
+  // put back a bank that isn't in the state - return false if it can't be found
+  virtual bool loadPage(int bank, MemoryPage *page) = 0;
+};
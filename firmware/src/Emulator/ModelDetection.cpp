@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#include "ModelDetection.h"
+
+// the longest pattern we look for - chunks of a tape overlap by this much so nothing is missed between them
+static const size_t PATTERN_LENGTH = 16;
+
+models_enum detectSnapshotModel(const uint8_t *header, size_t headerLength, size_t fileSize, SnapshotFormat format)
+{
+  if (format == SNAPSHOT_SNA)
+  {
+    // a 128K .sna has the extra banks after the 48K part
+    return fileSize >= 131103 ? SPECMDL_128K : SPECMDL_48K;
+  }
+  if (format == SNAPSHOT_Z80 && headerLength >= 35)
+  {
+    uint8_t buffer[35];
+    memcpy(buffer, header, sizeof(buffer));
+    int version = getZ80Version(buffer);
+    return version == 1 ? SPECMDL_48K : getHardwareModel(buffer, version);
+  }
+  return SPECMDL_UNKNOWN;
+}
+
+// a number in BASIC is written out as digits before its hidden binary form
+static bool basicOutTo(const uint8_t *data, size_t length, size_t i, const char *port)
+{
+  // OUT is token 0xDF
+  size_t p = i + 1;
+  while (p < length && data[p] == ' ')
+  {
+    p++;
+  }
+  size_t portLength = strlen(port);
+  return p + portLength <= length && memcmp(data + p, port, portLength) == 0;
+}
+
+// LD BC,port followed closely by OUT (C),r
+static bool codeOutTo(const uint8_t *data, size_t length, size_t i)
+{
+  if (data[i] != 0x01 || i + 2 >= length || data[i + 1] != 0xFD ||
+      (data[i + 2] != 0x7F && data[i + 2] != 0xFF && data[i + 2] != 0xBF))
+  {
+    return false;
+  }
+  for (size_t p = i + 3; p + 1 < length && p < i + 3 + 8; p++)
+  {
+    // ED 41, 49, 51, 59, 61, 69, 71 and 79 are the OUT (C) instructions
+    if (data[p] == 0xED && (data[p + 1] & 0xC7) == 0x41)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool tapeNeeds128K(const uint8_t *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (data[i] == 0xDF && (basicOutTo(data, length, i, "32765") || basicOutTo(data, length, i, "65533") ||
+                            basicOutTo(data, length, i, "49149")))
+    {
+      return true;
+    }
+    if (codeOutTo(data, length, i))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+models_enum detectModel(const char *filename)
+{
+  std::string extension = filename;
+  extension = extension.substr(extension.find_last_of('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  bool isTape = extension == "tap" || extension == "tzx";
+  SnapshotFormat format = snapshotFormat(filename);
+  if (!isTape && format == SNAPSHOT_UNKNOWN)
+  {
+    return SPECMDL_UNKNOWN;
+  }
+  FILE *fp = fopen(filename, "rb");
+  if (!fp)
+  {
+    return SPECMDL_UNKNOWN;
+  }
+  models_enum model = SPECMDL_48K;
+  if (!isTape)
+  {
+    uint8_t header[35];
+    size_t headerLength = fread(header, 1, sizeof(header), fp);
+    fseek(fp, 0, SEEK_END);
+    model = detectSnapshotModel(header, headerLength, ftell(fp), format);
+  }
+  else
+  {
+    // a chunk at a time - each one starts with the end of the one before
+    uint8_t *buffer = (uint8_t *)malloc(4096 + PATTERN_LENGTH);
+    size_t kept = 0;
+    size_t read;
+    while (buffer && (read = fread(buffer + kept, 1, 4096, fp)) > 0)
+    {
+      if (tapeNeeds128K(buffer, kept + read))
+      {
+        model = SPECMDL_128K;
+        break;
+      }
+      size_t length = kept + read;
+      kept = std::min(length, PATTERN_LENGTH);
+      memmove(buffer, buffer + length - kept, kept);
+    }
+    free(buffer);
+  }
+  fclose(fp);
+  return model;
+}
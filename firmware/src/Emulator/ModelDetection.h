@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "spectrum.h"
+#include "snaps.h"
+
+// Works out which machine a game wants without loading it. Snapshots say in their header (.z80) or by how big
+// they are (.sna). Tapes are searched for BASIC that does an OUT to the paging or AY ports and for code that
+// loads BC with one of those ports and then does an OUT (C) - a game that pages memory or plays the AY is
+// treated as 128K and anything else is 48K. Tapes with protected or compressed loaders can't be seen into so
+// they come out as 48K.
+
+// the model a file needs - SPECMDL_UNKNOWN if it isn't a game we know about
+models_enum detectModel(const char *filename);
+models_enum detectSnapshotModel(const uint8_t *header, size_t headerLength, size_t fileSize, SnapshotFormat format);
+// look through part of a tape - returns true if it has anything that needs a 128K
+bool tapeNeeds128K(const uint8_t *data, size_t length);
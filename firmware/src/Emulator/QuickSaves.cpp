@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_heap_caps.h>
+#endif
+#include "spectrum.h"
+#include "QuickSaves.h"
+#include "RunLength.h"
+
+// a 128K state is too big for internal RAM
+static uint8_t *allocate(size_t size)
+{
+#ifdef ARDUINO_ARCH_ESP32
+  return (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+#else
+  return (uint8_t *)malloc(size);
+#endif
+}
+
+QuickSaves::~QuickSaves()
+{
+  for (Slot &slot : slots)
+  {
+    free(slot.state);
+  }
+}
+
+std::string QuickSaves::quickSaveName(const std::string &gameFilename, int slot)
+{
+  size_t dot = gameFilename.find_last_of('.');
+  size_t slash = gameFilename.find_last_of('/');
+  std::string name = gameFilename;
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+  {
+    name = gameFilename.substr(0, dot);
+  }
+  return name + "-quick" + std::to_string(slot + 1) + ".zxs";
+}
+
+void QuickSaves::setFilename(const std::string &filename)
+{
+  gameFilename = filename;
+  for (int i = 0; i < QUICK_SAVE_SLOTS; i++)
+  {
+    slots[i].length = 0;
+    slots[i].unwritten = false;
+    readFile(i);
+  }
+}
+
+bool QuickSaves::save(ZXSpectrum *machine, int slot)
+{
+  Slot &quickSave = slots[slot];
+  size_t size = machine->stateSize();
+  if (quickSave.size < size)
+  {
+    free(quickSave.state);
+    quickSave.state = allocate(size);
+    quickSave.size = quickSave.state ? size : 0;
+    quickSave.length = 0;
+    if (!quickSave.state)
+    {
+      printf("Not enough memory for quick save %d\n", slot + 1);
+      return false;
+    }
+  }
+  quickSave.length = machine->saveState(quickSave.state, quickSave.size);
+  quickSave.unwritten = quickSave.length > 0 && !gameFilename.empty();
+  return quickSave.length > 0;
+}
+
+bool QuickSaves::restore(ZXSpectrum *machine, int slot)
+{
+  Slot &quickSave = slots[slot];
+  if (quickSave.length == 0)
+  {
+    return false;
+  }
+  return machine->loadState(quickSave.state, quickSave.length);
+}
+
+uint8_t *QuickSaves::takeUnwritten(int slot, size_t *length)
+{
+  Slot &quickSave = slots[slot];
+  if (!quickSave.unwritten)
+  {
+    return nullptr;
+  }
+  uint8_t *copy = allocate(quickSave.length);
+  if (copy)
+  {
+    memcpy(copy, quickSave.state, quickSave.length);
+    *length = quickSave.length;
+    quickSave.unwritten = false;
+  }
+  return copy;
+}
+
+bool QuickSaves::writeFile(const std::string &filename, const uint8_t *state, size_t length)
+{
+  uint8_t *encoded = allocate(4 + RUN_LENGTH_MAX_ENCODED(length));
+  if (!encoded)
+  {
+    printf("Not enough memory to write %s\n", filename.c_str());
+    return false;
+  }
+  encoded[0] = length & 0xFF;
+  encoded[1] = (length >> 8) & 0xFF;
+  encoded[2] = (length >> 16) & 0xFF;
+  encoded[3] = (length >> 24) & 0xFF;
+  size_t encodedLength = 4 + runLengthEncode(state, nullptr, length, encoded + 4);
+  // write to a temporary file first so we never pick up half a quick save
+  std::string tempFile = filename + ".tmp";
+  FILE *fp = fopen(tempFile.c_str(), "wb");
+  bool ok = fp && fwrite(encoded, 1, encodedLength, fp) == encodedLength;
+  if (fp)
+  {
+    ok = fclose(fp) == 0 && ok;
+  }
+  free(encoded);
+  if (ok)
+  {
+    remove(filename.c_str());
+    ok = rename(tempFile.c_str(), filename.c_str()) == 0;
+  }
+  if (!ok)
+  {
+    printf("Failed to write %s\n", filename.c_str());
+    remove(tempFile.c_str());
+  }
+  return ok;
+}
+
+bool QuickSaves::readFile(int slot)
+{
+  if (gameFilename.empty())
+  {
+    return false;
+  }
+  std::string filename = fileName(slot);
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp)
+  {
+    return false;
+  }
+  fseek(fp, 0, SEEK_END);
+  long fileLength = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  uint8_t *encoded = fileLength > 4 ? allocate(fileLength) : nullptr;
+  bool ok = encoded && fread(encoded, 1, fileLength, fp) == (size_t)fileLength;
+  fclose(fp);
+  Slot &quickSave = slots[slot];
+  if (ok)
+  {
+    size_t length = encoded[0] | (encoded[1] << 8) | (encoded[2] << 16) | ((size_t)encoded[3] << 24);
+    // a 128K state is a little over 128K so anything much bigger is junk
+    if (length > 0x30000)
+    {
+      length = 0;
+    }
+    if (quickSave.size < length)
+    {
+      free(quickSave.state);
+      quickSave.state = allocate(length);
+      quickSave.size = quickSave.state ? length : 0;
+    }
+    ok = quickSave.state && length > 0 && length <= quickSave.size;
+    if (ok)
+    {
+      memset(quickSave.state, 0, length);
+      ok = runLengthApply(quickSave.state, length, encoded + 4, fileLength - 4);
+    }
+    quickSave.length = ok ? length : 0;
+  }
+  free(encoded);
+  if (!ok)
+  {
+    printf("Failed to read %s\n", filename.c_str());
+    return false;
+  }
+  printf("Read quick save %d from %s\n", slot + 1, filename.c_str());
+  return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class ZXSpectrum;
+
+// how many quick saves each game gets - override it in the build flags
+#ifndef QUICK_SAVE_SLOTS
+#define QUICK_SAVE_SLOTS 4
+#endif
+
+// Quick saves are saved states (see MachineState.h) kept in PSRAM so saving and restoring take no longer than
+// copying the RAM. Each one is also written next to the game as it's compressed so it's there next time:
+//
+//   length:32 then the state run length encoded (see RunLength.h)
+//
+// Writing the files is slow so it is left to whoever owns the quick saves - they take a copy of a slot that
+// hasn't been written yet with takeUnwritten and then call writeFile with it in the background.
+class QuickSaves
+{
+private:
+  struct Slot
+  {
+    uint8_t *state = nullptr;
+    size_t length = 0;
+    size_t size = 0;
+    bool unwritten = false;
+  };
+  Slot slots[QUICK_SAVE_SLOTS];
+  std::string gameFilename;
+
+public:
+  ~QuickSaves();
+  // the file a slot is kept in for a game
+  static std::string quickSaveName(const std::string &gameFilename, int slot);
+  // forget the slots and pick up the ones that were saved for this game last time
+  void setFilename(const std::string &gameFilename);
+  bool save(ZXSpectrum *machine, int slot);
+  bool restore(ZXSpectrum *machine, int slot);
+  bool isUsed(int slot)
+  {
+    return slots[slot].length > 0;
+  }
+  // a copy of a slot that hasn't been written to its file yet - or nullptr if there's nothing to write. Free
+  // it when you're done with it
+  uint8_t *takeUnwritten(int slot, size_t *length);
+  std::string fileName(int slot)
+  {
+    return quickSaveName(gameFilename, slot);
+  }
+  static bool writeFile(const std::string &filename, const uint8_t *state, size_t length);
+  bool readFile(int slot);
+};
@@ -0,0 +1,107 @@
+#include "RunLength.h"
+
+size_t runLengthEncode(const uint8_t *data, const uint8_t *reference, size_t length, uint8_t *out)
+{
+  uint8_t *start = out;
+  uint8_t *literals = nullptr;
+  bool changed = false;
+  size_t i = 0;
+  while (i < length)
+  {
+    uint8_t value = reference ? data[i] ^ reference[i] : data[i];
+    size_t run = 1;
+    if (reference)
+    {
+      while (i + run < length && run < 0xFFFF && (data[i + run] ^ reference[i + run]) == value)
+      {
+        run++;
+      }
+    }
+    else
+    {
+      while (i + run < length && run < 0xFFFF && data[i + run] == value)
+      {
+        run++;
+      }
+    }
+    changed |= value != 0;
+    if (run >= 3)
+    {
+      if (run <= 0xFE - 0x80 + 3)
+      {
+        *out++ = 0x80 + run - 3;
+      }
+      else
+      {
+        *out++ = 0xFF;
+        *out++ = run & 0xFF;
+        *out++ = run >> 8;
+      }
+      *out++ = value;
+      literals = nullptr;
+      i += run;
+    }
+    else
+    {
+      if (literals && *literals < 0x7F)
+      {
+        (*literals)++;
+      }
+      else
+      {
+        literals = out++;
+        *literals = 0;
+      }
+      *out++ = value;
+      i++;
+    }
+  }
+  return changed || !reference ? out - start : 0;
+}
+
+bool runLengthApply(uint8_t *dest, size_t length, const uint8_t *src, size_t srcLength)
+{
+  const uint8_t *end = src + srcLength;
+  size_t i = 0;
+  while (src < end)
+  {
+    uint8_t token = *src++;
+    if (token < 0x80)
+    {
+      size_t count = token + 1;
+      if ((size_t)(end - src) < count || i + count > length)
+      {
+        return false;
+      }
+      for (size_t j = 0; j < count; j++)
+      {
+        dest[i++] ^= *src++;
+      }
+      continue;
+    }
+    size_t count = token - 0x80 + 3;
+    if (token == 0xFF)
+    {
+      if (end - src < 2)
+      {
+        return false;
+      }
+      count = src[0] | (src[1] << 8);
+      src += 2;
+    }
+    if (src >= end || i + count > length)
+    {
+      return false;
+    }
+    uint8_t value = *src++;
+    if (value)
+    {
+      for (size_t j = 0; j < count; j++)
+      {
+        dest[i + j] ^= value;
+      }
+    }
+    i += count;
+  }
+  return i == length;
+}
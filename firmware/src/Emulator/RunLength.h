@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The run length encoding used by time travel and quick saves. The data is XORed with a reference first (or
+// with zero if there isn't one) so anything that hasn't changed becomes a long run of zeros:
+//
+//   0x00-0x7F  the next token + 1 bytes are literals
+//   0x80-0xFE  token - 0x80 + 3 copies of the next byte
+//   0xFF       a 16 bit count then the byte
+//
+// the most the encoding can take up - a literal token for every 128 bytes
+#define RUN_LENGTH_MAX_ENCODED(length) ((length) + ((length) + 127) / 128)
+
+// returns the encoded length - or 0 if there is a reference and the data is the same as it
+size_t runLengthEncode(const uint8_t *data, const uint8_t *reference, size_t length, uint8_t *out);
+// XOR the encoded data into dest - returns false if it doesn't come to exactly length bytes
+bool runLengthApply(uint8_t *dest, size_t length, const uint8_t *src, size_t srcLength);
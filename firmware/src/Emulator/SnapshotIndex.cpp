@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "spectrum.h"
+#include "SnapshotIndex.h"
+
+static const uint8_t indexMagic[4] = {'Z', 'X', 'I', 'X'};
+static const int INDEX_VERSION = 2;
+static const int HEADER_SIZE = 10;
+static const int ENTRY_SIZE = SnapshotIndex::NAME_LENGTH + 21;
+static const int VERSION_1_ENTRY_SIZE = SnapshotIndex::NAME_LENGTH + 9;
+
+static void writeU32(uint8_t *data, uint32_t value)
+{
+  data[0] = value;
+  data[1] = value >> 8;
+  data[2] = value >> 16;
+  data[3] = value >> 24;
+}
+
+static uint32_t readU32(const uint8_t *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static std::string folderOf(const std::string &filename)
+{
+  size_t slash = filename.find_last_of('/');
+  return slash == std::string::npos ? "." : filename.substr(0, slash);
+}
+
+static std::string nameOf(const std::string &filename)
+{
+  size_t slash = filename.find_last_of('/');
+  return slash == std::string::npos ? filename : filename.substr(slash + 1);
+}
+
+void SnapshotIndex::makeThumbnail(const uint8_t *screen, uint8_t *thumbnail)
+{
+  memset(thumbnail, 0, THUMBNAIL_SIZE);
+  for (int ty = 0; ty < THUMBNAIL_HEIGHT; ty++)
+  {
+    for (int tx = 0; tx < THUMBNAIL_WIDTH; tx++)
+    {
+      // count the ink pixels in the block - it's half of one byte on each of four lines
+      int ink = 0;
+      for (int line = 0; line < 4; line++)
+      {
+        int y = ty * 4 + line;
+        uint8_t pixels = screen[((y & 0xC0) << 5) | ((y & 0x07) << 8) | ((y & 0x38) << 2) | (tx / 2)];
+        ink += __builtin_popcount(tx & 1 ? pixels & 0x0F : pixels & 0xF0);
+      }
+      uint8_t attr = screen[6144 + (ty / 2) * 32 + tx / 2];
+      uint8_t color = (ink >= 8 ? attr : attr >> 3) & 0x07;
+      if (attr & 0x40)
+      {
+        color += 8;
+      }
+      thumbnail[(ty * THUMBNAIL_WIDTH + tx) / 2] |= tx & 1 ? color : color << 4;
+    }
+  }
+}
+
+bool SnapshotIndex::open(const std::string &folder)
+{
+  close();
+  this->folder = folder;
+  fp = fopen((folder + "/" SNAPSHOT_INDEX_NAME).c_str(), "rb");
+  if (!fp)
+  {
+    return false;
+  }
+  uint8_t header[HEADER_SIZE];
+  bool readHeader = fread(header, 1, HEADER_SIZE, fp) == HEADER_SIZE && memcmp(header, indexMagic, 4) == 0;
+  int version = readHeader ? header[4] | (header[5] << 8) : 0;
+  if (version != 1 && version != INDEX_VERSION)
+  {
+    printf("Ignoring the index in %s - it's not one we can read\n", folder.c_str());
+    close();
+    return false;
+  }
+  uint32_t count = readU32(header + 6);
+  entrySize = version == 1 ? VERSION_1_ENTRY_SIZE : ENTRY_SIZE;
+  // read all the entries in one go
+  uint8_t *table = count < 100000 ? (uint8_t *)malloc(count * entrySize + 1) : nullptr;
+  if (!table || fread(table, 1, count * entrySize, fp) != count * entrySize)
+  {
+    printf("Ignoring the index in %s - it's corrupt\n", folder.c_str());
+    free(table);
+    close();
+    return false;
+  }
+  entries.reserve(count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const uint8_t *data = table + i * entrySize;
+    Entry entry;
+    entry.name = std::string((const char *)data, strnlen((const char *)data, NAME_LENGTH));
+    entry.model = data[NAME_LENGTH];
+    entry.saveTime = readU32(data + NAME_LENGTH + 1);
+    entry.fileSize = readU32(data + NAME_LENGTH + 5);
+    if (version != 1)
+    {
+      entry.fileTime = readU32(data + NAME_LENGTH + 9);
+      entry.contentHash = readU32(data + NAME_LENGTH + 13) | ((uint64_t)readU32(data + NAME_LENGTH + 17) << 32);
+    }
+    entry.index = i;
+    byName[entry.name] = i;
+    entries.push_back(entry);
+  }
+  free(table);
+  return true;
+}
+
+void SnapshotIndex::close()
+{
+  if (fp)
+  {
+    fclose(fp);
+    fp = nullptr;
+  }
+  folder.clear();
+  entries.clear();
+  byName.clear();
+}
+
+const SnapshotIndex::Entry *SnapshotIndex::find(const std::string &name)
+{
+  auto it = byName.find(name);
+  return it == byName.end() ? nullptr : &entries[it->second];
+}
+
+bool SnapshotIndex::readThumbnail(const Entry *entry, uint8_t *thumbnail)
+{
+  if (!fp || !entry)
+  {
+    return false;
+  }
+  long offset = HEADER_SIZE + entries.size() * entrySize + (long)entry->index * THUMBNAIL_SIZE;
+  return fseek(fp, offset, SEEK_SET) == 0 && fread(thumbnail, 1, THUMBNAIL_SIZE, fp) == THUMBNAIL_SIZE;
+}
+
+bool SnapshotIndex::update(const std::string &filename, ZXSpectrum *machine, uint64_t contentHash)
+{
+  Entry entry;
+  entry.name = nameOf(filename);
+  struct stat st;
+  bool found = stat(filename.c_str(), &st) == 0;
+  entry.model = machine->hwopt.hw_model;
+  entry.saveTime = time(nullptr);
+  entry.fileSize = found ? st.st_size : 0;
+  entry.fileTime = found ? st.st_mtime : 0;
+  entry.contentHash = contentHash;
+  uint8_t *thumbnail = (uint8_t *)malloc(THUMBNAIL_SIZE);
+  if (!thumbnail)
+  {
+    return false;
+  }
+  makeThumbnail(machine->mem.currentScreen->data, thumbnail);
+  bool ok = addEntries(folderOf(filename), {entry}, thumbnail);
+  free(thumbnail);
+  return ok;
+}
+
+uint64_t SnapshotIndex::hashFile(const std::string &filename)
+{
+  FILE *file = fopen(filename.c_str(), "rb");
+  uint8_t *buffer = (uint8_t *)malloc(4096);
+  if (!file || !buffer)
+  {
+    if (file)
+    {
+      fclose(file);
+    }
+    free(buffer);
+    return 0;
+  }
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  size_t read;
+  while ((read = fread(buffer, 1, 4096, file)) > 0)
+  {
+    for (size_t i = 0; i < read; i++)
+    {
+      hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+    }
+  }
+  free(buffer);
+  fclose(file);
+  // 0 means it hasn't been hashed
+  return hash == 0 ? 1 : hash;
+}
+
+uint64_t SnapshotIndex::contentHash(const std::string &filename)
+{
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0)
+  {
+    return 0;
+  }
+  SnapshotIndex index;
+  index.open(folderOf(filename));
+  const Entry *entry = index.find(nameOf(filename));
+  if (entry && entry->contentHash != 0 && entry->fileSize == (uint32_t)st.st_size && entry->fileTime == (uint32_t)st.st_mtime)
+  {
+    return entry->contentHash;
+  }
+  return hashFile(filename);
+}
+
+bool SnapshotIndex::addEntries(const std::string &folder, const std::vector<Entry> &added, const uint8_t *thumbnails)
+{
+  // the new index is the old one with these entries replaced or added on the end
+  SnapshotIndex index;
+  index.open(folder);
+  std::vector<Entry> newEntries = index.entries;
+  // where each entry's thumbnail comes from - the old index or the ones we've been given
+  std::vector<const uint8_t *> newThumbnails(newEntries.size(), nullptr);
+  for (size_t i = 0; i < added.size(); i++)
+  {
+    if (added[i].name.empty() || added[i].name.length() >= NAME_LENGTH)
+    {
+      printf("Can't add %s to the index - the name is too long\n", added[i].name.c_str());
+      continue;
+    }
+    auto it = index.byName.find(added[i].name);
+    int position = it != index.byName.end() ? it->second : newEntries.size();
+    if (position == (int)newEntries.size())
+    {
+      newEntries.push_back(added[i]);
+      newThumbnails.push_back(nullptr);
+      // it might be added twice
+      index.byName[added[i].name] = position;
+    }
+    newEntries[position] = added[i];
+    newEntries[position].index = position;
+    newThumbnails[position] = thumbnails + i * THUMBNAIL_SIZE;
+  }
+  uint8_t *buffer = (uint8_t *)malloc(THUMBNAIL_SIZE + ENTRY_SIZE);
+  if (!buffer)
+  {
+    return false;
+  }
+  // write to a temporary file first so we never pick up half an index
+  std::string indexFile = folder + "/" SNAPSHOT_INDEX_NAME;
+  std::string tempFile = indexFile + ".tmp";
+  FILE *out = fopen(tempFile.c_str(), "wb");
+  bool ok = out != nullptr;
+  if (ok)
+  {
+    memcpy(buffer, indexMagic, 4);
+    buffer[4] = INDEX_VERSION & 0xFF;
+    buffer[5] = INDEX_VERSION >> 8;
+    writeU32(buffer + 6, newEntries.size());
+    ok = fwrite(buffer, 1, HEADER_SIZE, out) == HEADER_SIZE;
+  }
+  for (size_t i = 0; ok && i < newEntries.size(); i++)
+  {
+    memset(buffer, 0, ENTRY_SIZE);
+    memcpy(buffer, newEntries[i].name.c_str(), newEntries[i].name.length());
+    buffer[NAME_LENGTH] = newEntries[i].model;
+    writeU32(buffer + NAME_LENGTH + 1, newEntries[i].saveTime);
+    writeU32(buffer + NAME_LENGTH + 5, newEntries[i].fileSize);
+    writeU32(buffer + NAME_LENGTH + 9, newEntries[i].fileTime);
+    writeU32(buffer + NAME_LENGTH + 13, newEntries[i].contentHash);
+    writeU32(buffer + NAME_LENGTH + 17, newEntries[i].contentHash >> 32);
+    ok = fwrite(buffer, 1, ENTRY_SIZE, out) == ENTRY_SIZE;
+  }
+  for (size_t i = 0; ok && i < newEntries.size(); i++)
+  {
+    const uint8_t *thumbnail = newThumbnails[i];
+    if (!thumbnail)
+    {
+      ok = index.readThumbnail(&index.entries[i], buffer);
+      thumbnail = buffer;
+    }
+    ok = ok && fwrite(thumbnail, 1, THUMBNAIL_SIZE, out) == THUMBNAIL_SIZE;
+  }
+  free(buffer);
+  index.close();
+  if (out)
+  {
+    ok = fclose(out) == 0 && ok;
+  }
+  if (ok)
+  {
+    remove(indexFile.c_str());
+    ok = rename(tempFile.c_str(), indexFile.c_str()) == 0;
+  }
+  if (!ok)
+  {
+    printf("Failed to update %s\n", indexFile.c_str());
+    remove(tempFile.c_str());
+    return false;
+  }
+  printf("Updated %s - it has %d entries\n", indexFile.c_str(), (int)newEntries.size());
+  return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class ZXSpectrum;
+
+// the index is hidden so it doesn't show up in the pickers
+#define SNAPSHOT_INDEX_NAME ".snapshots.idx"
+
+// Each folder can have an index of the games in it with a thumbnail of their screen, the model, when they were
+// saved and how big they are, so the game picker can show a preview without opening the games. The snapshot
+// writer and the tape cache add to it whenever they save. Tapes also have a hash of everything in them, which
+// names their cached snapshot, along with when the file was last changed so we know if it's still right.
+//
+//   "ZXIX" version:16 count:32
+//   count entries: name:64 (zero padded) model:8 saveTime:32 fileSize:32 fileTime:32 contentHash:64
+//   count thumbnails in the same order
+//
+// Version 1 entries stop after fileSize.
+//
+// The entries are read in one go when the index is opened and the thumbnails are read one at a time when they
+// are wanted, so the picker only ever reads the thumbnails it is showing.
+class SnapshotIndex
+{
+public:
+  static const int THUMBNAIL_WIDTH = 64;
+  static const int THUMBNAIL_HEIGHT = 48;
+  // two pixels a byte - each is a spectrum colour with bright in bit 3
+  static const int THUMBNAIL_SIZE = THUMBNAIL_WIDTH * THUMBNAIL_HEIGHT / 2;
+  static const int NAME_LENGTH = 64;
+  struct Entry
+  {
+    std::string name;
+    int model;
+    // seconds since 1970 - or whatever the clock said if it hasn't been set
+    uint32_t saveTime;
+    uint32_t fileSize;
+    // when the file was last changed and a hash of what's in it - 0 if it hasn't been hashed
+    uint32_t fileTime = 0;
+    uint64_t contentHash = 0;
+    // where its thumbnail is
+    int index;
+  };
+
+private:
+  std::string folder;
+  std::vector<Entry> entries;
+  std::map<std::string, int> byName;
+  FILE *fp = nullptr;
+  // how big the entries are in the version we're reading
+  int entrySize = 0;
+
+public:
+  ~SnapshotIndex()
+  {
+    close();
+  }
+  // shrink a screen down to a thumbnail - each 4x4 block is whichever of ink or paper it has most of
+  static void makeThumbnail(const uint8_t *screen, uint8_t *thumbnail);
+  // add a file that has just been saved to the index of its folder with a thumbnail of the machine's screen
+  static bool update(const std::string &filename, ZXSpectrum *machine, uint64_t contentHash = 0);
+  // FNV-1a over everything in a file - 0 if it can't be read
+  static uint64_t hashFile(const std::string &filename);
+  // the hash of a file from its folder's index if it hasn't changed since then - otherwise it is hashed again
+  static uint64_t contentHash(const std::string &filename);
+  // add or replace entries in a folder's index in one go - the thumbnails are one after another
+  static bool addEntries(const std::string &folder, const std::vector<Entry> &added, const uint8_t *thumbnails);
+  // read the entries of a folder's index - it is kept open to read the thumbnails from. Anything that
+  // replaces the index leaves this reading the old one so close it before then
+  bool open(const std::string &folder);
+  void close();
+  const std::string &getFolder()
+  {
+    return folder;
+  }
+  const std::vector<Entry> &getEntries()
+  {
+    return entries;
+  }
+  // the entry for a file in the folder - or nullptr if it isn't in the index
+  const Entry *find(const std::string &name);
+  bool readThumbnail(const Entry *entry, uint8_t *thumbnail);
+};
@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_heap_caps.h>
+#endif
+#include "spectrum.h"
+#include "TimeTravel.h"
+#include "RunLength.h"
+
+// the most a bank can take up once it's encoded
+#define MAX_ENCODED_BANK RUN_LENGTH_MAX_ENCODED(0x4000)
+// each bank is stored as its number and the length of what follows
+#define BANK_HEADER_SIZE 3
+
+// the history lives in PSRAM - if there isn't any we go without rather than take memory from everything else
+static uint8_t *allocate(size_t size)
+{
+#ifdef ARDUINO_ARCH_ESP32
+  return (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+#else
+  return (uint8_t *)malloc(size);
+#endif
+}
+
+TimeTravel::TimeTravel(size_t budget, int keyframeInterval) : keyframeInterval(keyframeInterval)
+{
+  // nothing is allocated until the first instant is recorded
+  chunkSize = std::min<size_t>(TIME_TRAVEL_CHUNK_SIZE, budget);
+  maxChunks = std::max<size_t>(1, budget / chunkSize);
+}
+
+TimeTravel::~TimeTravel()
+{
+  // don't leave the machine copying into memory we no longer have
+  for (int bank = 0; bank < 8; bank++)
+  {
+    if (pendingPages[bank] && pendingPages[bank]->copyOnWrite == captured + bank * 0x4000)
+    {
+      pendingPages[bank]->copyOnWrite = nullptr;
+    }
+  }
+  for (uint8_t *data : chunks)
+  {
+    free(data);
+  }
+  free(reference);
+  free(captured);
+}
+
+size_t TimeTravel::memoryAllocated()
+{
+  return chunks.size() * chunkSize + (reference ? 2 * 8 * 0x4000 : 0);
+}
+
+size_t TimeTravel::memoryUsed()
+{
+  size_t used = 0;
+  for (const Instant &instant : instants)
+  {
+    used += instant.length;
+  }
+  return used;
+}
+
+void TimeTravel::dropOldest()
+{
+  do
+  {
+    instants.pop_front();
+  } while (!instants.empty() && !instants.front().keyframe);
+  // the keys from before the first instant can't be replayed any more
+  while (!journal.empty() && journal.front().frame < firstFrame())
+  {
+    journal.pop_front();
+  }
+  while (!tapeFrames.empty() && tapeFrames.front().second <= firstFrame())
+  {
+    tapeFrames.pop_front();
+  }
+}
+
+bool TimeTravel::nextChunk()
+{
+  // grow until we reach the budget or run out of memory
+  int next = chunks.empty() ? 0 : chunk + 1;
+  if (next == (int)chunks.size() && (size_t)next < maxChunks)
+  {
+    uint8_t *data = allocate(chunkSize);
+    if (data)
+    {
+      chunks.push_back(data);
+    }
+    else
+    {
+      printf("Time travel could only allocate %d KB\n", (int)(chunks.size() * chunkSize / 1024));
+      maxChunks = chunks.size();
+    }
+  }
+  if (chunks.empty())
+  {
+    return false;
+  }
+  if (next == (int)chunks.size())
+  {
+    next = 0;
+  }
+  // the oldest instants are in the chunk we're going to reuse - but not the one we're still recording
+  while (!instants.empty() && instants.front().chunk == next)
+  {
+    if (recording && instants.size() == 1)
+    {
+      break;
+    }
+    bool lastGroup = true;
+    for (size_t i = 1; i < instants.size() && lastGroup; i++)
+    {
+      lastGroup = !instants[i].keyframe;
+    }
+    if (recording && lastGroup)
+    {
+      // the instant we're recording depends on it
+      return false;
+    }
+    dropOldest();
+  }
+  chunk = next;
+  chunkEnd = 0;
+  return true;
+}
+
+bool TimeTravel::reserve(size_t length)
+{
+  if (length > chunkSize)
+  {
+    return false;
+  }
+  if (!chunks.empty() && chunkSize - chunkEnd >= length)
+  {
+    return true;
+  }
+  return nextChunk();
+}
+
+bool TimeTravel::moveRecording()
+{
+  // the instant must stay in one piece so it goes to the start of the next chunk
+  const uint8_t *from = instantData(instants.back());
+  if (!nextChunk())
+  {
+    return false;
+  }
+  Instant &instant = instants.back();
+  memmove(chunks[chunk], from, instant.length);
+  instant.chunk = chunk;
+  instant.offset = 0;
+  chunkEnd = instant.length;
+  return true;
+}
+
+void TimeTravel::abandonRecording()
+{
+  printf("Not enough memory for time travel\n");
+  for (int bank = 0; bank < 8; bank++)
+  {
+    if (pendingPages[bank])
+    {
+      pendingPages[bank]->copyOnWrite = nullptr;
+      pendingPages[bank] = nullptr;
+    }
+  }
+  if (recording)
+  {
+    instants.pop_back();
+    recording = false;
+  }
+  referenceValid = false;
+}
+
+const uint8_t *TimeTravel::findBank(const Instant &instant, int bank, size_t *length)
+{
+  const uint8_t *data = instantData(instant) + instant.stateLength;
+  const uint8_t *end = instantData(instant) + instant.length;
+  while (end - data >= BANK_HEADER_SIZE)
+  {
+    *length = data[1] | (data[2] << 8);
+    if (data[0] == bank)
+    {
+      return data + BANK_HEADER_SIZE;
+    }
+    data += BANK_HEADER_SIZE + *length;
+  }
+  return nullptr;
+}
+
+bool TimeTravel::savePage(int bank, MemoryPage *page)
+{
+  // this gets encoded later by finishBank
+  page->copyOnWrite = captured + bank * 0x4000;
+  pendingPages[bank] = page;
+  return true;
+}
+
+bool TimeTravel::finishBank()
+{
+  int bank = 0;
+  while (bank < 8 && !pendingPages[bank])
+  {
+    bank++;
+  }
+  if (bank == 8)
+  {
+    recording = false;
+    return false;
+  }
+  // make sure there's room for it however badly it encodes
+  if (chunkSize - chunkEnd < BANK_HEADER_SIZE + MAX_ENCODED_BANK && !moveRecording())
+  {
+    abandonRecording();
+    return false;
+  }
+  // if it hasn't been written to since the instant then it's still how it was
+  MemoryPage *page = pendingPages[bank];
+  const uint8_t *data = captured + bank * 0x4000;
+  if (page->copyOnWrite == data)
+  {
+    data = page->data;
+    page->copyOnWrite = nullptr;
+  }
+  pendingPages[bank] = nullptr;
+  uint8_t *bankReference = reference + bank * 0x4000;
+  uint8_t *out = chunks[chunk] + chunkEnd;
+  size_t length = runLengthEncode(data, recordingKeyframe ? nullptr : bankReference, 0x4000, out + BANK_HEADER_SIZE);
+  if (length > 0)
+  {
+    out[0] = bank;
+    out[1] = length & 0xFF;
+    out[2] = length >> 8;
+    chunkEnd += BANK_HEADER_SIZE + length;
+    memcpy(bankReference, data, 0x4000);
+  }
+  instants.back().length = chunkEnd - instants.back().offset;
+  return true;
+}
+
+void TimeTravel::finishRecording()
+{
+  while (finishBank())
+  {
+  }
+}
+
+bool TimeTravel::loadPage(int bank, MemoryPage *page)
+{
+  // start from the keyframe and apply the changes up to the instant we want
+  int first = rewindIndex;
+  while (first > 0 && !instants[first].keyframe)
+  {
+    first--;
+  }
+  memset(page->data, 0, 0x4000);
+  for (int i = first; i <= rewindIndex; i++)
+  {
+    size_t length;
+    const uint8_t *data = findBank(instants[i], bank, &length);
+    if (data && !runLengthApply(page->data, 0x4000, data, length))
+    {
+      printf("Time travel bank %d is corrupt\n", bank);
+      return false;
+    }
+  }
+  page->isDirty = true;
+  return true;
+}
+
+bool TimeTravel::record(ZXSpectrum *machine)
+{
+  finishRecording();
+  if (maxChunks == 0)
+  {
+    // we've already found out there isn't enough memory
+    return false;
+  }
+  if (!reference)
+  {
+    reference = allocate(8 * 0x4000);
+    captured = allocate(8 * 0x4000);
+    if (!reference || !captured)
+    {
+      printf("Not enough memory for time travel\n");
+      free(reference);
+      free(captured);
+      reference = captured = nullptr;
+      maxChunks = 0;
+      return false;
+    }
+  }
+  size_t stateLength = machine->stateSize(false);
+  if (!reserve(stateLength))
+  {
+    printf("Not enough memory for time travel\n");
+    return false;
+  }
+  int sinceKeyframe = 0;
+  for (auto it = instants.rbegin(); it != instants.rend() && !it->keyframe; ++it)
+  {
+    sinceKeyframe++;
+  }
+  // we need a keyframe if we've got nothing to encode against
+  Instant instant;
+  instant.chunk = chunk;
+  instant.offset = chunkEnd;
+  instant.stateLength = stateLength;
+  instant.frame = frame;
+  instant.keyframe = instants.empty() || !referenceValid || referenceModel != machine->hwopt.hw_model ||
+                     sinceKeyframe + 1 >= keyframeInterval;
+  recordingKeyframe = instant.keyframe;
+  if (machine->saveState(chunks[chunk] + chunkEnd, stateLength, this) != stateLength)
+  {
+    printf("Failed to save the machine for time travel\n");
+    abandonRecording();
+    return false;
+  }
+  // the banks are added as they get encoded
+  instant.length = stateLength;
+  chunkEnd += instant.length;
+  instants.push_back(instant);
+  recording = true;
+  referenceValid = true;
+  referenceModel = machine->hwopt.hw_model;
+  return true;
+}
+
+void TimeTravel::keyChanged(SpecKeys key, uint8_t state)
+{
+  journal.push_back({frame, (uint8_t)key, state});
+}
+
+void TimeTravel::rewind(ZXSpectrum *machine, int index)
+{
+  finishRecording();
+  const Instant &instant = instants[index];
+  rewindIndex = index;
+  if (!machine->loadState(instantData(instant), instant.stateLength, this))
+  {
+    printf("Failed to rewind to time travel instant %d\n", index);
+  }
+  position = instant.frame;
+  positionValid = true;
+  // the machine is no longer where the last instant left it
+  referenceValid = false;
+}
+
+void TimeTravel::endFrame(bool tapePlaying)
+{
+  if (tapePlaying)
+  {
+    if (!tapeFrames.empty() && tapeFrames.back().second == frame)
+    {
+      tapeFrames.back().second++;
+    }
+    else
+    {
+      tapeFrames.push_back({frame, frame + 1});
+    }
+  }
+  frame++;
+  finishBank();
+}
+
+bool TimeTravel::canReplay(ZXSpectrum *machine, uint32_t from, uint32_t to)
+{
+  // the tape would carry on playing from where it is now
+  if (machine->tapeDeck.isPlaying())
+  {
+    return false;
+  }
+  for (auto &tape : tapeFrames)
+  {
+    if (tape.first < to && tape.second > from)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TimeTravel::replay(ZXSpectrum *machine, uint32_t from, uint32_t to)
+{
+  auto event = journal.begin();
+  while (event != journal.end() && event->frame < from)
+  {
+    event++;
+  }
+  for (uint32_t f = from; f < to; f++)
+  {
+    for (; event != journal.end() && event->frame == f; event++)
+    {
+      machine->updateKey((SpecKeys)event->key, event->state);
+    }
+    // the emulator loop takes the MIC level from the audio input, which is silent
+    machine->setMicLow();
+    machine->runForFrame(nullptr, nullptr);
+  }
+}
+
+bool TimeTravel::rewindToFrame(ZXSpectrum *machine, uint32_t &target)
+{
+  finishRecording();
+  if (instants.empty() || target < firstFrame() || target > frame)
+  {
+    return false;
+  }
+  // the latest instant at or before the frame
+  int index = instants.size() - 1;
+  while (index > 0 && instants[index].frame > target)
+  {
+    index--;
+  }
+  uint32_t current = positionValid ? position : frame;
+  uint32_t from = instants[index].frame;
+  // if we're already on the way there we can carry on from here
+  bool carryOn = current >= from && current <= target;
+  if (carryOn)
+  {
+    from = current;
+  }
+  if (!canReplay(machine, from, target))
+  {
+    if (target > current && index + 1 < (int)instants.size())
+    {
+      index++;
+    }
+    target = instants[index].frame;
+    rewind(machine, index);
+    return true;
+  }
+  if (!carryOn)
+  {
+    rewind(machine, index);
+  }
+  replay(machine, from, target);
+  position = target;
+  positionValid = true;
+  return true;
+}
+
+void TimeTravel::resumeFrom(uint32_t target)
+{
+  finishRecording();
+  while (!instants.empty() && instants.back().frame > target)
+  {
+    instants.pop_back();
+  }
+  while (!journal.empty() && journal.back().frame >= target)
+  {
+    journal.pop_back();
+  }
+  while (!tapeFrames.empty() && tapeFrames.back().first >= target)
+  {
+    tapeFrames.pop_back();
+  }
+  if (!tapeFrames.empty() && tapeFrames.back().second > target)
+  {
+    tapeFrames.back().second = target;
+  }
+  if (!instants.empty())
+  {
+    chunk = instants.back().chunk;
+    chunkEnd = instants.back().offset + instants.back().length;
+  }
+  else
+  {
+    chunkEnd = 0;
+  }
+  frame = target;
+  positionValid = false;
+  referenceValid = false;
+}
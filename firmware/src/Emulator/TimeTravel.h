@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "MachineState.h"
+#include "keyboard_defs.h"
+
+class ZXSpectrum;
+
+// how much memory the history can use - override it in the build flags
+#ifndef TIME_TRAVEL_BUDGET
+#define TIME_TRAVEL_BUDGET (3 * 1024 * 1024)
+#endif
+// the history is allocated in pieces this big as it's needed
+#ifndef TIME_TRAVEL_CHUNK_SIZE
+#define TIME_TRAVEL_CHUNK_SIZE (128 * 1024)
+#endif
+// how often an instant is recorded that doesn't depend on the ones before it
+#ifndef TIME_TRAVEL_KEYFRAME_INTERVAL
+#define TIME_TRAVEL_KEYFRAME_INTERVAL 10
+#endif
+
+// Records the state of the machine every so often so we can go back in time.
+//
+// An instant is a saved state without the RAM (see MachineState.h) followed by the RAM banks that have
+// changed since the instant before. Each bank is XORed with how it was last time - so anything that hasn't
+// changed is zero - and then run length encoded. A bank that hasn't changed at all isn't stored. Every
+// keyframe interval the banks are stored in full (XORed with zero) so that instant doesn't need any before it.
+//
+// Recording an instant only saves the state - the banks are marked copy on write and encoded one a frame
+// from endFrame so the emulator never stalls. A bank that's written to before it has been encoded is copied
+// as it was first (see MemoryPage::beforeWrite).
+//
+// The instants go one after another round a ring of chunks of memory. Nothing is allocated until the first
+// instant is recorded and then a chunk is added each time the last one fills up, until we reach the budget
+// or run out of PSRAM. After that the next chunk round the ring is reused - the oldest keyframes in it are
+// thrown away along with the instants that depend on them.
+//
+// Between the instants there is a journal of the keys that were pressed and the frame they were pressed at.
+// To get to any frame we go back to the instant before it and run the machine forward, pressing the keys
+// again, so the history can be scrubbed through a frame at a time. This relies on the keys only being given
+// to the machine at the start of a frame - see Machine::runEmulator. The tape deck isn't part of the saved
+// state so frames where a tape was playing can't be replayed - we can only go to the instants around them.
+class TimeTravel : public MachineStatePages
+{
+private:
+  struct Instant
+  {
+    // where the instant is and how long it is - the saved state comes first, then the banks
+    int chunk;
+    size_t offset;
+    size_t length;
+    size_t stateLength;
+    bool keyframe;
+    // the frame it was recorded after
+    uint32_t frame;
+  };
+  std::deque<Instant> instants;
+  // a key going up or down at the start of a frame
+  struct KeyEvent
+  {
+    uint32_t frame;
+    uint8_t key;
+    uint8_t state;
+  };
+  std::deque<KeyEvent> journal;
+  // the frames a tape was playing for - from the first up to but not including the second
+  std::deque<std::pair<uint32_t, uint32_t>> tapeFrames;
+  // frames that have been run since we started
+  uint32_t frame = 0;
+  // the frame the machine is at while we're going back and forward in time - otherwise it's at frame
+  uint32_t position = 0;
+  bool positionValid = false;
+  std::vector<uint8_t *> chunks;
+  size_t chunkSize;
+  size_t maxChunks;
+  // where the next instant will go
+  int chunk = 0;
+  size_t chunkEnd = 0;
+  int keyframeInterval;
+  // the RAM banks as they were at the last instant - the next instant is encoded against these
+  uint8_t *reference = nullptr;
+  bool referenceValid = false;
+  int referenceModel = 0;
+  // while the banks of the last instant are being encoded - and whether it is a keyframe
+  bool recording = false;
+  bool recordingKeyframe = false;
+  // the banks of the last instant that still have to be encoded and where they are copied if they change first
+  MemoryPage *pendingPages[8] = {nullptr};
+  uint8_t *captured = nullptr;
+  // the instant we're rewinding to
+  int rewindIndex = 0;
+
+  uint8_t *instantData(const Instant &instant)
+  {
+    return chunks[instant.chunk] + instant.offset;
+  }
+  // move on to the next chunk - returns false if there isn't one we can use
+  bool nextChunk();
+  // make room for an instant - returns false if it will never fit
+  bool reserve(size_t length);
+  // the instant being recorded has outgrown its chunk - move it to the next one
+  bool moveRecording();
+  void abandonRecording();
+  // throw away the oldest keyframe and everything that depends on it
+  void dropOldest();
+  // the encoded bank in an instant - returns nullptr if it didn't change
+  const uint8_t *findBank(const Instant &instant, int bank, size_t *length);
+  // encode a bank of the last instant - returns false if there are none left
+  bool finishBank();
+  // run the machine on from one frame to another, pressing the keys from the journal
+  bool canReplay(ZXSpectrum *machine, uint32_t from, uint32_t to);
+  void replay(ZXSpectrum *machine, uint32_t from, uint32_t to);
+
+public:
+  TimeTravel(size_t budget = TIME_TRAVEL_BUDGET, int keyframeInterval = TIME_TRAVEL_KEYFRAME_INTERVAL);
+  ~TimeTravel();
+  size_t size()
+  {
+    return instants.size();
+  }
+  // how much of the budget the recorded instants are using
+  size_t memoryUsed();
+  // how much has been allocated so far
+  size_t memoryAllocated();
+  // record the current state of the machine - and again whenever anything other than the keys changes it
+  bool record(ZXSpectrum *machine);
+  // encode whatever is left of the last instant now rather than waiting for the frames to do it
+  void finishRecording();
+  // a key the machine has been given - call it before running the frame
+  void keyChanged(SpecKeys key, uint8_t state);
+  // call this after each frame has been run - it also encodes a bank of the last instant
+  void endFrame(bool tapePlaying);
+  // the frames we can go back to
+  uint32_t firstFrame()
+  {
+    return instants.empty() ? frame : instants.front().frame;
+  }
+  uint32_t currentFrame()
+  {
+    return frame;
+  }
+  // the frame an instant was recorded after
+  uint32_t instantFrame(int index)
+  {
+    return instants[index].frame;
+  }
+  // rewind the machine to a previous state
+  void rewind(ZXSpectrum *machine, int index);
+  // put the machine back to how it was after any frame from firstFrame to currentFrame - if it can't be
+  // replayed to then target is moved to the instant before it (or after it if we're going forwards)
+  bool rewindToFrame(ZXSpectrum *machine, uint32_t &target);
+  // carry on from a frame we've rewound to - everything after it is forgotten
+  void resumeFrom(uint32_t target);
+  // called by saveState and loadState for each RAM bank
+  bool savePage(int bank, MemoryPage *page) override;
+  bool loadPage(int bank, MemoryPage *page) override;
+};
@@ -0,0 +1,387 @@
+// Made by desktop/src/make_boot_images.cpp - run make -f Makefile.bootimages in desktop to remake it
+#include "BootImage.h"
+
+static const uint8_t bootImage48kRam[] = {
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0x18, 0x00, 0xed, 0xed, 0xff, 0x38, 0xed, 0xed, 0xff, 0x38,
+  0xed, 0xed, 0xff, 0x38, 0x38, 0x38, 0x38, 0xed, 0xed, 0xff, 0x00, 0x00,
+  0xff, 0x00, 0x00, 0x00, 0x0d, 0x05, 0x23, 0x0d, 0x0d, 0x23, 0x05, 0xed,
+  0xed, 0x05, 0x00, 0x01, 0x00, 0x06, 0x00, 0x0b, 0x00, 0x01, 0x00, 0x01,
+  0x00, 0x06, 0x00, 0x10, 0xed, 0xed, 0x1a, 0x00, 0x3c, 0x40, 0x00, 0xff,
+  0x8c, 0x01, 0x54, 0xff, 0xed, 0xed, 0x05, 0x00, 0xff, 0xfe, 0xff, 0x01,
+  0x38, 0x00, 0x00, 0xcb, 0x5c, 0x00, 0x00, 0xb6, 0x5c, 0xb6, 0x5c, 0xcb,
+  0x5c, 0xd0, 0x5c, 0xca, 0x5c, 0xcc, 0x5c, 0xcf, 0x5c, 0xcf, 0x5c, 0x00,
+  0x00, 0xd1, 0x5c, 0xf3, 0x5c, 0xf3, 0x5c, 0x1b, 0x92, 0x5c, 0x10, 0x02,
+  0xed, 0xed, 0x08, 0x00, 0x01, 0x1a, 0x00, 0x00, 0xb3, 0x00, 0x00, 0x58,
+  0xff, 0x00, 0x00, 0x21, 0x00, 0x5b, 0x21, 0x17, 0x00, 0x40, 0xe0, 0x50,
+  0x21, 0x18, 0x21, 0x17, 0x01, 0x38, 0x00, 0x38, 0xed, 0xed, 0x22, 0x00,
+  0x57, 0xff, 0xff, 0xff, 0xf4, 0x09, 0xa8, 0x10, 0x4b, 0xf4, 0x09, 0xc4,
+  0x15, 0x53, 0x81, 0x0f, 0xc4, 0x15, 0x52, 0xf4, 0x09, 0xc4, 0x15, 0x50,
+  0x80, 0x80, 0xef, 0x22, 0x22, 0x0d, 0x80, 0x00, 0xff, 0xed, 0xed, 0x09,
+  0x20, 0x00, 0x00, 0x00, 0x80, 0xed, 0xed, 0x12, 0x00, 0x80, 0x0d, 0xce,
+  0x5c, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0x2d,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0x40, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0x57,
+  0x00, 0xf3, 0x0d, 0xce, 0x0b, 0xe3, 0x50, 0xce, 0x0b, 0xe4, 0x50, 0x1d,
+  0x17, 0xdc, 0x0a, 0xce, 0x0b, 0xe7, 0x50, 0x1a, 0x17, 0xdc, 0x0a, 0xd7,
+  0x18, 0x38, 0x00, 0x38, 0x00, 0x0d, 0x19, 0xcf, 0x5c, 0xa9, 0x18, 0x06,
+  0x03, 0x07, 0x5c, 0xb1, 0x33, 0xb1, 0x33, 0xd6, 0x5c, 0xd0, 0x5c, 0x13,
+  0x01, 0x6f, 0x05, 0x3f, 0x05, 0x71, 0x07, 0xe2, 0x5c, 0xcb, 0x5c, 0x76,
+  0x1b, 0x03, 0x13, 0x00, 0x3e, 0x00, 0x3c, 0x42, 0x42, 0x7e, 0x42, 0x42,
+  0x00, 0x00, 0x7c, 0x42, 0x7c, 0x42, 0x42, 0x7c, 0x00, 0x00, 0x3c, 0x42,
+  0x40, 0x40, 0x42, 0x3c, 0x00, 0x00, 0x78, 0x44, 0x42, 0x42, 0x44, 0x78,
+  0x00, 0x00, 0x7e, 0x40, 0x7c, 0x40, 0x40, 0x7e, 0x00, 0x00, 0x7e, 0x40,
+  0x7c, 0x40, 0x40, 0x40, 0x00, 0x00, 0x3c, 0x42, 0x40, 0x4e, 0x42, 0x3c,
+  0x00, 0x00, 0x42, 0x42, 0x7e, 0x42, 0x42, 0x42, 0x00, 0x00, 0x3e, 0x08,
+  0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x02, 0x02, 0x02, 0x42, 0x42, 0x3c,
+  0x00, 0x00, 0x44, 0x48, 0x70, 0x48, 0x44, 0x42, 0x00, 0x00, 0xed, 0xed,
+  0x05, 0x40, 0x7e, 0x00, 0x00, 0x42, 0x66, 0x5a, 0x42, 0x42, 0x42, 0x00,
+  0x00, 0x42, 0x62, 0x52, 0x4a, 0x46, 0x42, 0x00, 0x00, 0x3c, 0x42, 0x42,
+  0x42, 0x42, 0x3c, 0x00, 0x00, 0x7c, 0x42, 0x42, 0x7c, 0x40, 0x40, 0x00,
+  0x00, 0x3c, 0x42, 0x42, 0x52, 0x4a, 0x3c, 0x00, 0x00, 0x7c, 0x42, 0x42,
+  0x7c, 0x44, 0x42, 0x00, 0x00, 0x3c, 0x40, 0x3c, 0x02, 0x42, 0x3c, 0x00,
+  0x00, 0xfe, 0xed, 0xed, 0x05, 0x10, 0x00, 0x00, 0xed, 0xed, 0x05, 0x42,
+  0x3c, 0x00,
+};
+
+extern const BootImage bootImage48k = {
+  1, 2, 0x8985adc2,
+  0x0054, 0x3702, 0x0011, 0x053f, 0x5ce2, 0x5c3a, 0x05f8, 0xff48, 0x0038,
+  0x0001, 0x1721, 0x369b, 0x0000,
+  0, 0, 0x3f, 0, 1, 65535, -5,
+  7, 0x00, 0x20, false, true, 5,
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  bootImage48kRam, sizeof(bootImage48kRam)};
+
+static const uint8_t bootImage128kRam[] = {
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00,
+  0xed, 0xed, 0x64, 0x00, 0xec, 0xed, 0xed, 0x0e, 0x00, 0xdb, 0x02, 0x7c,
+  0x38, 0xec, 0xeb, 0xdb, 0x02, 0x7c, 0x38, 0xb1, 0x33, 0xd6, 0x5c, 0xd0,
+  0x5c, 0x6f, 0x05, 0x3f, 0x05, 0x71, 0x07, 0xe2, 0x5c, 0xcb, 0x5c, 0x14,
+  0x5b, 0x21, 0x18, 0x1d, 0x5b, 0x00, 0x3e, 0x14, 0x1b, 0x00, 0x3c, 0x42,
+  0x42, 0x7e, 0x42, 0x42, 0x00, 0x00, 0x7c, 0x42, 0x7c, 0x42, 0x42, 0x7c,
+  0x00, 0x00, 0x3c, 0x42, 0x40, 0x40, 0x42, 0x3c, 0x00, 0x00, 0x78, 0x44,
+  0x42, 0x42, 0x44, 0x78, 0x00, 0x00, 0x7e, 0x40, 0x7c, 0x40, 0x40, 0x7e,
+  0x00, 0x00, 0x7e, 0x40, 0x7c, 0x40, 0x40, 0x40, 0x00, 0x00, 0x3c, 0x42,
+  0x40, 0x4e, 0x42, 0x3c, 0x00, 0x00, 0x42, 0x42, 0x7e, 0x42, 0x42, 0x42,
+  0x00, 0x00, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x02, 0x02,
+  0x02, 0x42, 0x42, 0x3c, 0x00, 0x00, 0x44, 0x48, 0x70, 0x48, 0x44, 0x42,
+  0x00, 0x00, 0xed, 0xed, 0x05, 0x40, 0x7e, 0x00, 0x00, 0x42, 0x66, 0x5a,
+  0x42, 0x42, 0x42, 0x00, 0x00, 0x42, 0x62, 0x52, 0x4a, 0x46, 0x42, 0x00,
+  0x00, 0x3c, 0x42, 0x42, 0x42, 0x42, 0x3c, 0x00, 0x00, 0x7c, 0x42, 0x42,
+  0x7c, 0x40, 0x40, 0x00, 0x00, 0x3c, 0x42, 0x42, 0x52, 0x4a, 0x3c, 0x00,
+  0x00, 0x7c, 0x42, 0x42, 0x7c, 0x44, 0x42, 0x00, 0x00, 0x3c, 0x40, 0x3c,
+  0x02, 0x42, 0x3c, 0x00, 0x00, 0xfe, 0xed, 0xed, 0x05, 0x10, 0x00, 0x00,
+  0xed, 0xed, 0x05, 0x42, 0x3c, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0x40, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0x40, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0x40, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0x40, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xca, 0x00, 0x01, 0xfe,
+  0x01, 0xfe, 0x01, 0xed, 0xed, 0xe1, 0x00, 0xfe, 0x00, 0x00, 0x00, 0x00,
+  0x40, 0x00, 0x00, 0x04, 0xed, 0xed, 0x11, 0x00, 0x03, 0xfc, 0x03, 0xfc,
+  0x03, 0xed, 0xed, 0x21, 0x00, 0xfe, 0xed, 0xed, 0x07, 0x00, 0x10, 0xed,
+  0xed, 0x09, 0x00, 0x7c, 0x7c, 0x7e, 0x3c, 0x44, 0x00, 0x10, 0x00, 0x10,
+  0xed, 0xed, 0xa5, 0x00, 0x10, 0x38, 0x78, 0x38, 0x00, 0x40, 0x38, 0x38,
+  0x04, 0x38, 0x1c, 0xed, 0xed, 0x0f, 0x00, 0x07, 0xf8, 0x07, 0xf8, 0x07,
+  0xed, 0xed, 0x21, 0x00, 0x10, 0x38, 0x00, 0x1c, 0x38, 0x78, 0x1c, 0x38,
+  0x10, 0x00, 0x00, 0x00, 0x78, 0x1c, 0x38, 0x38, 0x38, 0x00, 0x42, 0x42,
+  0x40, 0x42, 0x48, 0x00, 0x38, 0x44, 0x00, 0x1c, 0x38, 0xed, 0xed, 0xa3,
+  0x00, 0x10, 0x04, 0x44, 0x44, 0x00, 0x40, 0x44, 0x04, 0x3c, 0x44, 0x20,
+  0xed, 0xed, 0x0f, 0x00, 0x0f, 0xf0, 0x0f, 0xf0, 0x0f, 0xed, 0xed, 0x21,
+  0x00, 0x10, 0x44, 0x00, 0x20, 0x04, 0x44, 0x20, 0x44, 0x10, 0x00, 0x00,
+  0x00, 0x44, 0x20, 0x44, 0x40, 0x40, 0x00, 0x7c, 0x42, 0x7c, 0x42, 0x70,
+  0x00, 0x10, 0x54, 0x30, 0x20, 0x44, 0xed, 0xed, 0xa3, 0x00, 0x10, 0x3c,
+  0x44, 0x78, 0x00, 0x40, 0x44, 0x3c, 0x44, 0x78, 0x20, 0xed, 0xed, 0x0f,
+  0x00, 0x1f, 0xe0, 0x1f, 0xe0, 0x1f, 0xed, 0xed, 0x21, 0x00, 0x10, 0x44,
+  0x00, 0x20, 0x3c, 0x44, 0x20, 0x78, 0x10, 0x00, 0x3e, 0x00, 0x44, 0x20,
+  0x78, 0x38, 0x38, 0x00, 0x42, 0x7c, 0x40, 0x7e, 0x48, 0x00, 0x10, 0x54,
+  0x10, 0x20, 0x78, 0xed, 0xed, 0xa3, 0x00, 0x10, 0x44, 0x78, 0x40, 0x00,
+  0x40, 0x44, 0x44, 0x44, 0x40, 0x20, 0xed, 0xed, 0x0f, 0x00, 0x3f, 0xc0,
+  0x3f, 0xc0, 0x3f, 0xed, 0xed, 0x21, 0x00, 0x10, 0x44, 0x00, 0x20, 0x44,
+  0x44, 0x20, 0x40, 0x10, 0x00, 0x00, 0x00, 0x78, 0x20, 0x40, 0x04, 0x04,
+  0x00, 0x42, 0x44, 0x40, 0x42, 0x44, 0x00, 0x10, 0x54, 0x10, 0x20, 0x40,
+  0xed, 0xed, 0xa3, 0x00, 0x10, 0x3c, 0x40, 0x3c, 0x00, 0x7e, 0x38, 0x3c,
+  0x3c, 0x3c, 0x20, 0xed, 0xed, 0x0f, 0x00, 0x7f, 0x80, 0x7f, 0x80, 0x7f,
+  0xed, 0xed, 0x21, 0x00, 0x10, 0x38, 0x00, 0x1c, 0x3c, 0x44, 0x1c, 0x3c,
+  0x0c, 0x00, 0x00, 0x00, 0x40, 0x20, 0x3c, 0x78, 0x78, 0x00, 0x7c, 0x42,
+  0x7e, 0x42, 0x42, 0x00, 0x0c, 0x28, 0x38, 0x1c, 0x3c, 0xed, 0xed, 0xa5,
+  0x00, 0x40, 0xed, 0xed, 0x17, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0xed,
+  0xed, 0x2d, 0x00, 0x40, 0xed, 0xed, 0x13, 0x00, 0xed, 0xed, 0xff, 0x38,
+  0xed, 0xed, 0xff, 0x38, 0xed, 0xed, 0xa2, 0x38, 0xed, 0xed, 0x0b, 0x47,
+  0xed, 0xed, 0x0f, 0x40, 0x42, 0x72, 0x74, 0x6c, 0x68, 0x40, 0xed, 0xed,
+  0x40, 0x38, 0xf5, 0xc5, 0x01, 0xfd, 0x7f, 0x3a, 0x5c, 0x5b, 0xee, 0x10,
+  0xf3, 0x32, 0x5c, 0x5b, 0xed, 0xed, 0x01, 0xed, 0x79, 0xfb, 0xc1, 0xf1,
+  0xc9, 0xcd, 0x00, 0x5b, 0xe5, 0x2a, 0x5a, 0x5b, 0xe3, 0xc9, 0xf3, 0x3a,
+  0x5c, 0x5b, 0xe6, 0xef, 0x32, 0x5c, 0x5b, 0x01, 0xfd, 0x7f, 0xed, 0xed,
+  0x01, 0xed, 0x79, 0xfb, 0xc3, 0xc3, 0x00, 0x21, 0xd8, 0x06, 0x18, 0x03,
+  0x21, 0xca, 0x07, 0x08, 0x01, 0xfd, 0x7f, 0x3a, 0x5c, 0x5b, 0xf5, 0xe6,
+  0xef, 0xf3, 0x32, 0x5c, 0x5b, 0xed, 0xed, 0x01, 0xed, 0x79, 0xc3, 0xe6,
+  0x05, 0x08, 0xf1, 0x01, 0xfd, 0x7f, 0xf3, 0x32, 0x5c, 0x5b, 0xed, 0xed,
+  0x01, 0xed, 0x79, 0xfb, 0x08, 0xc9, 0x61, 0x07, 0x2e, 0x15, 0x10, 0xcf,
+  0x00, 0x0b, 0x00, 0x00, 0x00, 0x00, 0x50, 0x00, 0x11, 0xed, 0xed, 0x1a,
+  0x00, 0xf3, 0x5b, 0xec, 0xeb, 0xec, 0x2b, 0x01, 0x00, 0x00, 0x00, 0x21,
+  0x03, 0xed, 0xed, 0x07, 0x00, 0x0a, 0x00, 0x0a, 0x00, 0x01, 0x03, 0x07,
+  0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0xfe, 0xfc, 0xf8, 0xf0, 0xe0, 0xc0, 0x80,
+  0xed, 0xed, 0x20, 0x00, 0xc4, 0x38, 0xfd, 0x01, 0x30, 0x39, 0xa3, 0x39,
+  0xdb, 0x02, 0x7c, 0x38, 0x6c, 0xfd, 0x4d, 0x00, 0xeb, 0x57, 0x00, 0x00,
+  0x07, 0x3d, 0x54, 0x00, 0xce, 0x0b, 0xfc, 0x50, 0x05, 0x17, 0xf3, 0x0d,
+  0x21, 0x18, 0x00, 0x00, 0x74, 0x00, 0x00, 0x00, 0x27, 0x1f, 0xf7, 0x02,
+  0xe7, 0x3f, 0x2b, 0x27, 0xe7, 0x3f, 0x7a, 0x26, 0x11, 0x0d, 0x67, 0x26,
+  0x00, 0xff, 0x00, 0x00, 0x00, 0x0d, 0x05, 0x1f, 0x0d, 0x0d, 0x23, 0x02,
+  0x00, 0x00, 0x00, 0x16, 0x00, 0x01, 0x00, 0x06, 0x00, 0x0b, 0x00, 0x01,
+  0x00, 0x01, 0x00, 0x06, 0x00, 0x10, 0xed, 0xed, 0x1a, 0x00, 0x3c, 0x40,
+  0x00, 0xff, 0x9c, 0x20, 0x52, 0xff, 0xed, 0xed, 0x05, 0x00, 0xff, 0xfe,
+  0xff, 0x01, 0x38, 0x00, 0x00, 0xcb, 0x5c, 0x00, 0x00, 0xb6, 0x5c, 0xbb,
+  0x5c, 0xcb, 0x5c, 0xd0, 0x5c, 0xca, 0x5c, 0xcc, 0x5c, 0xcc, 0x5c, 0xcf,
+  0x5c, 0x00, 0x00, 0xd1, 0x5c, 0xf3, 0x5c, 0xf3, 0x5c, 0x7f, 0x92, 0x5c,
+  0x00, 0x02, 0xed, 0xed, 0x08, 0x00, 0x01, 0x17, 0x00, 0x00, 0x9b, 0x00,
+  0x00, 0x58, 0xff, 0xed, 0xed, 0x05, 0x00, 0x04, 0x17, 0x00, 0x40, 0xfd,
+  0x50, 0x21, 0x18, 0x04, 0x17, 0x01, 0x38, 0x00, 0x38, 0xed, 0xed, 0x22,
+  0x00, 0x57, 0xff, 0xff, 0xff, 0xf4, 0x09, 0xa8, 0x10, 0x4b, 0xf4, 0x09,
+  0xc4, 0x15, 0x53, 0x81, 0x0f, 0xc4, 0x15, 0x52, 0x34, 0x5b, 0x2f, 0x5b,
+  0x50, 0x80, 0x80, 0xef, 0x22, 0x22, 0x0d, 0x80, 0x00, 0xff, 0xed, 0xed,
+  0x09, 0x20, 0x00, 0x00, 0x00, 0x80, 0xed, 0xed, 0x12, 0x00, 0x80, 0x0d,
+  0xce, 0x5c, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0x2d, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0x40, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0x23, 0x00, 0xc0, 0xed,
+  0xed, 0x15, 0x00, 0x80, 0xff, 0x38, 0x00, 0x38, 0x00, 0x00, 0x00, 0x14,
+  0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xe2, 0x00,
+  0x20, 0xed, 0xed, 0x05, 0x00, 0x05, 0x17, 0x00, 0x40, 0xfc, 0x50, 0x21,
+  0x18, 0x05, 0x17, 0x01, 0x38, 0x00, 0x38, 0xed, 0xed, 0x71, 0x00, 0xed,
+  0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed,
+  0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed,
+  0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed,
+  0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed,
+  0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed,
+  0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed,
+  0xed, 0x0e, 0x38, 0xed, 0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed,
+  0xed, 0x70, 0x00, 0xed, 0xed, 0x0e, 0x38, 0xed, 0xed, 0xff, 0x00, 0xed,
+  0xed, 0xf8, 0x00, 0x44, 0x27, 0x54, 0x27, 0x00, 0x00, 0x00, 0x04, 0x10,
+  0x14, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff,
+  0x00, 0xed, 0xed, 0x7c, 0x00, 0x01, 0x05, 0x00, 0x00, 0x14, 0x00, 0x00,
+  0x00, 0x0f, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed, 0xff, 0x00, 0xed, 0xed,
+  0x8f, 0x00,
+};
+
+extern const BootImage bootImage128k = {
+  1, 3, 0x7e85e506,
+  0x0054, 0x9102, 0x0011, 0x053f, 0x5ce2, 0x5c3a, 0x05ed, 0xff44, 0x0078,
+  0x0001, 0x1821, 0x369b, 0x0038,
+  0, 0, 0x00, 0, 1, 65535, -7,
+  7, 0x00, 0x10, false, true, 7,
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00},
+  bootImage128kRam, sizeof(bootImage128kRam)};
@@ -30,125 +30,88 @@
 #include "./z80/z80.h"
 #include "./spectrum.h"
 #include "./snaps.h"
-
-bool Load(ZXSpectrum *speccy, const char *filename)
-{
-  // convert the filename to lower case
-  std::string filenameStr = filename;
-  std::transform(filenameStr.begin(), filenameStr.end(), filenameStr.begin(), ::tolower);
-  if (strstr(filenameStr.c_str(), ".sna") != NULL)
-  {
-    return LoadSNA(speccy, filename);
-  }
-  else if (strstr(filenameStr.c_str(), ".z80") != NULL)
-  {
-    return LoadZ80(speccy, filename);
-  }
-  return false;
-}
+#include "../TZX/TapeSource.h"
 
 #define Z80BL_V1UNCOMP 0
 #define Z80BL_V1COMPRE 1
 #define Z80BL_V2UNCOMP 3
 #define Z80BL_V2COMPRE 4
 
-// Decompress a block of data from a V2 or V3 Z80 snapshot
-void decompressZ80BlockV2orV3(FILE *fp, uint32_t compressedSize, uint8_t *decompressedData, uint32_t decompressedSize)
+// copy length bytes starting at offset into dest - returns false if the source is too short
+static bool readBytes(TapeSource &source, uint32_t offset, uint8_t *dest, uint32_t length)
 {
-  uint16_t dataOff = 0;
-  uint8_t ed_cnt = 0;
-  uint8_t repcnt = 0;
-  uint8_t repval = 0;
-  uint16_t memidx = 0;
-
-  while (dataOff < compressedSize && memidx < decompressedSize)
+  if (offset > source.size() || length > source.size() - offset)
   {
-    uint8_t databyte = fgetc(fp);
-    if (ed_cnt == 0)
-    {
-      if (databyte != 0xED)
-        decompressedData[memidx++] = databyte;
-      else
-        ed_cnt++;
-    }
-    else if (ed_cnt == 1)
-    {
-      if (databyte != 0xED)
-      {
-        decompressedData[memidx++] = 0xED;
-        decompressedData[memidx++] = databyte;
-        ed_cnt = 0;
-      }
-      else
-        ed_cnt++;
-    }
-    else if (ed_cnt == 2)
-    {
-      repcnt = databyte;
-      ed_cnt++;
-    }
-    else if (ed_cnt == 3)
-    {
-      repval = databyte;
-      for (uint16_t i = 0; i < repcnt; i++)
-        decompressedData[memidx++] = repval;
-      ed_cnt = 0;
-    }
+    return false;
   }
+  while (length > 0)
+  {
+    uint32_t chunk = std::min<uint32_t>(length, TAPE_WINDOW_SIZE);
+    memcpy(dest, source.get(offset, chunk), chunk);
+    dest += chunk;
+    offset += chunk;
+    length -= chunk;
+  }
+  return true;
 }
 
-// special handling for V1 which is just a stream of RAM - we'll poke this into the Z80 memory
-void decompressZ80BlockV1(FILE *fp, uint32_t compressedSize, ZXSpectrum *speccy)
+// Decompress Z80 RLE data between offset and end into the pages - ED ED count byte is a run and anything else
+// is copied as it is. Version 1 files are one long stream for the whole of RAM so runs can cross pages.
+static void decompressZ80Block(TapeSource &source, uint32_t offset, uint32_t end, MemoryPage **pages, int pageCount)
 {
-  uint32_t inPos = 0; // Position in the compressed data
-  // start writing at the start of RAM
-  uint32_t outPos = 0x4000;
-  uint32_t maxOutPos = 0xC000;
-
-  while (inPos < compressedSize && outPos < maxOutPos)
+  if (end > source.size())
+  {
+    end = source.size();
+  }
+  int page = 0;
+  uint32_t memidx = 0;
+  while (offset < end && page < pageCount)
   {
-    // Read the current byte
-    uint8_t byte = fgetc(fp);
-    inPos++;
-    if (inPos < compressedSize)
+    uint8_t *out = pages[page]->data;
+    if (source[offset] == 0xED && offset + 1 < end && source[offset + 1] == 0xED)
     {
-      uint8_t nextByte = fgetc(fp);
-      inPos++;
-      // Check if this is an RLE encoded sequence
-      if (byte == 0xED && nextByte == 0xED)
+      if (offset + 3 >= end)
       {
-        // Read the repetition count and value
-        uint8_t repeatCount = fgetc(fp);
-        inPos++;
-        uint8_t repeatValue = fgetc(fp);
-        inPos++;
-
-        // Repeat the value in the output buffer
-        for (int i = 0; i < repeatCount; i++)
-        {
-          if (outPos < maxOutPos)
-          {
-            speccy->z80_poke(outPos++, repeatValue);
-          }
-        }
+        break;
       }
-      else
+      uint32_t count = source[offset + 2];
+      uint8_t value = source[offset + 3];
+      offset += 4;
+      while (count > 0 && page < pageCount)
       {
-        // If not a compressed sequence, copy the bytes directly
-        if (outPos < maxOutPos - 1)
+        uint32_t chunk = std::min<uint32_t>(count, 0x4000 - memidx);
+        memset(pages[page]->data + memidx, value, chunk);
+        count -= chunk;
+        memidx += chunk;
+        if (memidx == 0x4000)
         {
-          speccy->z80_poke(outPos++, byte);
-          speccy->z80_poke(outPos++, nextByte);
+          page++;
+          memidx = 0;
         }
       }
+      continue;
     }
-    else
+    // copy everything up to the next ED in one go - source[offset] has made sure the window holds offset
+    uint32_t chunk = std::min(std::min(source.available(offset), end - offset), 0x4000 - memidx);
+    if (chunk > TAPE_WINDOW_SIZE)
     {
-      if (outPos < maxOutPos)
-      {
-        speccy->z80_poke(outPos++, byte);
-      }
+      chunk = TAPE_WINDOW_SIZE;
     }
+    const uint8_t *data = source.get(offset, chunk);
+    const uint8_t *ed = (const uint8_t *)memchr(data + 1, 0xED, chunk - 1);
+    uint32_t literal = ed ? ed - data : chunk;
+    memcpy(out + memidx, data, literal);
+    offset += literal;
+    memidx += literal;
+    if (memidx == 0x4000)
+    {
+      page++;
+      memidx = 0;
+    }
+  }
+  for (int i = 0; i < pageCount; i++)
+  {
+    pages[i]->isDirty = true;
   }
 }
 
@@ -205,35 +168,36 @@ void loadZ80Regs(ZXSpectrum *speccy, uint8_t *buffer)
   speccy->z80Regs->IM = buffer[29] & 0x03;
 }
 
-bool loadZ80Version1(ZXSpectrum *speccy, uint8_t *buffer, FILE *fp)
+bool loadZ80Version1(ZXSpectrum *speccy, uint8_t *buffer, TapeSource &source)
 {
   // only 48K is supported
   if (speccy->hwopt.hw_model != SPECMDL_48K)
   {
     speccy->init_spectrum(SPECMDL_48K);
   }
-  // get the file size
-  fseek(fp, 0, SEEK_END);
-  int totalSize = ftell(fp);
-  fseek(fp, 30, SEEK_SET);
+  // RAM from 0x4000 onwards
+  MemoryPage *pages[3] = {speccy->mem.banks[5], speccy->mem.banks[2], speccy->mem.banks[0]};
+  uint32_t totalSize = source.size();
   if (buffer[12] & 0x20)
   {
     printf("Loading compressed data %x\n", totalSize - 30);
-    decompressZ80BlockV1(fp, totalSize - 30, speccy);
+    decompressZ80Block(source, 30, totalSize, pages, 3);
   }
   else
   {
     printf("Loading uncompressed data %x\n", totalSize - 30);
-    for (int i = 0; i < 0xC000 && i < totalSize - 30; i++)
+    for (int i = 0; i < 3; i++)
     {
-      speccy->z80_poke(i + 0x4000, fgetc(fp));
+      uint32_t offset = 30 + i * 0x4000;
+      uint32_t length = offset < totalSize ? std::min<uint32_t>(0x4000, totalSize - offset) : 0;
+      readBytes(source, offset, pages[i]->data, length);
+      pages[i]->isDirty = true;
     }
   }
   speccy->z80Regs->PC.B.l = buffer[6];
   speccy->z80Regs->PC.B.h = buffer[7];
   printf("PC: %x\n", speccy->z80Regs->PC.W);
   loadZ80Regs(speccy, buffer);
-  printf("PC: %x\n", speccy->z80Regs->PC.W);
   return true;
 }
 
@@ -278,7 +242,7 @@ models_enum getHardwareModel(uint8_t *buffer, int version)
   return SPECMDL_UNKNOWN;
 }
 
-bool loadZ80Version2or3(ZXSpectrum *speccy, uint8_t *buffer, int version, FILE *fp)
+bool loadZ80Version2or3(ZXSpectrum *speccy, uint8_t *buffer, int version, TapeSource &source)
 {
   models_enum hwmodel = getHardwareModel(buffer, version);
   printf("Hardware model %d\n", hwmodel);
@@ -289,13 +253,10 @@ bool loadZ80Version2or3(ZXSpectrum *speccy, uint8_t *buffer, int version, FILE *
       return false;
     }
   }
-  // get the total length of the file
-  fseek(fp, 0, SEEK_END);
-  int totalSize = ftell(fp);
+  uint32_t totalSize = source.size();
   // move to the start of the memory pages
   printf("Extra data length %d\n", buffer[30]);
-  int dataOffset = 30 + 2 + buffer[30];
-  fseek(fp, dataOffset, SEEK_SET);
+  uint32_t dataOffset = 30 + 2 + buffer[30];
 
   MemoryPage *pageMap[16] = {0};
   if (hwmodel == SPECMDL_48K)
@@ -315,31 +276,28 @@ bool loadZ80Version2or3(ZXSpectrum *speccy, uint8_t *buffer, int version, FILE *
     pageMap[9] = speccy->mem.banks[6];
     pageMap[10] = speccy->mem.banks[7];
   }
-  while (dataOffset < totalSize)
+  while (dataOffset + 3 <= totalSize)
   {
-    int length = fgetc(fp) + (fgetc(fp) << 8);
-    int page = fgetc(fp);
+    int length = source[dataOffset] + (source[dataOffset + 1] << 8);
+    int page = source[dataOffset + 2];
     int actualLength = length == 0xFFFF ? 0x4000 : length;
-    dataOffset += 3 + actualLength;
+    dataOffset += 3;
     printf("Got page %d, length %d\n", page, length);
-    if (pageMap[page] == NULL)
+    if (page >= 16 || pageMap[page] == NULL)
     {
       // nothing to write to this page
       printf("Skipping page %d\n", page);
-      continue;
     }
-    // if the data is compressed, we need to uncompress it
-    if (length == 0xFFFF)
+    else if (length == 0xFFFF)
     {
-      printf("Reading page %d %d\n", page, actualLength);
-      fread(pageMap[page]->data, actualLength, 1, fp);
-      pageMap[page]->isDirty = true;
-      printf("Read page %d\n", page);
-    } else {
-      printf("Decompressing page %d\n", page);
-      decompressZ80BlockV2orV3(fp, length, pageMap[page]->data, 0x4000);
+      readBytes(source, dataOffset, pageMap[page]->data, 0x4000);
       pageMap[page]->isDirty = true;
     }
+    else
+    {
+      decompressZ80Block(source, dataOffset, dataOffset + length, &pageMap[page], 1);
+    }
+    dataOffset += actualLength;
   }
   printf("Setting the PC registers\n");
   speccy->z80Regs->PC.B.l = buffer[32];
@@ -360,18 +318,15 @@ bool loadZ80Version2or3(ZXSpectrum *speccy, uint8_t *buffer, int version, FILE *
   return true;
 }
 
-bool LoadZ80(ZXSpectrum *speccy, const char *filename)
+static bool loadZ80(ZXSpectrum *speccy, TapeSource &source)
 {
-  printf("Loading Z80 file %s\n", filename);
-  FILE *fp = fopen(filename, "rb");
-  if (!fp)
+  // read in the header
+  uint8_t buffer[87];
+  if (!readBytes(source, 0, buffer, 87))
   {
-    printf("Could not open file\n");
+    printf("Z80 file is too short\n");
     return false;
   }
-  // read in the header
-  uint8_t buffer[87];
-  fread(buffer, 87, 1, fp);
   if (buffer[12] == 255)
     buffer[12] = 1; /*as told in CSS FAQ / .z80 section */
   bool res = false;
@@ -381,54 +336,47 @@ bool LoadZ80(ZXSpectrum *speccy, const char *filename)
   {
   case 1:
     printf("Loading Z80 version 1\n");
-    res = loadZ80Version1(speccy, buffer, fp);
+    res = loadZ80Version1(speccy, buffer, source);
     break;
   case 2:
   case 3:
     printf("Loading Z80 version %d\n", version);
-    res = loadZ80Version2or3(speccy, buffer, version, fp);
+    res = loadZ80Version2or3(speccy, buffer, version, source);
     break;
   default:
     printf("Unknown Z80 version %d\n", version);
     break;
   }
-  fclose(fp);
   return res;
 }
 
 /*-----------------------------------------------------------------
- char LoadSNA( Z80Regs *regs, char *filename );
- This loads a .SNA file from disk to the Z80 registers/memory.
+ This loads a .SNA snapshot into the Z80 registers/memory.
 ------------------------------------------------------------------*/
-bool LoadSNA(ZXSpectrum *speccy, const char *filename)
+static bool loadSNA(ZXSpectrum *speccy, TapeSource &source)
 {
-  uint8_t page;
   uint8_t buffer[27];
-  uint8_t unbyte;
   int model;
-  printf("Cargamos un SNA (by filename)\n");
-  FILE *fp = fopen(filename, "rb");
-  if (!fp)
-  {
-    printf("Algo fallo cargando el SNA\n");
-    return false;
-  }
+  printf("Cargamos un SNA\n");
   // get the size of the file
-  fseek(fp, 0, SEEK_END);
-  int size = ftell(fp);
+  uint32_t size = source.size();
   if (size == 49179)
     model = SPECMDL_48K; // es un 48Kb
   else if (size == 16411)
     model = SPECMDL_16K; // 16Kb UNSUPPORTED!!
-  else
+  else if (size >= 131103)
     model = SPECMDL_128K;
+  else
+  {
+    printf("Algo fallo cargando el SNA\n");
+    return false;
+  }
 
   if (speccy->hwopt.hw_model != model)
   {
     speccy->init_spectrum(model);
   }
-  fseek(fp, 0, SEEK_SET);
-  fread(buffer, 27, 1, fp);
+  readBytes(source, 0, buffer, 27);
   speccy->z80Regs->I = buffer[0];
   speccy->z80Regs->HLs.B.l = buffer[1];
   speccy->z80Regs->HLs.B.h = buffer[2];
@@ -457,46 +405,28 @@ bool LoadSNA(ZXSpectrum *speccy, const char *filename)
   speccy->z80Regs->IM = buffer[25];
   speccy->hwopt.BorderColor = buffer[26];
 
-  if (model == SPECMDL_48K)
+  if (model == SPECMDL_128K)
   {
-    // read in each chunk of RAM
-    fread(speccy->mem.mappedMemory[1], 0x4000, 1, fp);
-    fread(speccy->mem.mappedMemory[2], 0x4000, 1, fp);
-    fread(speccy->mem.mappedMemory[3], 0x4000, 1, fp);
-    speccy->z80Regs->PC.B.l = speccy->z80_peek(speccy->z80Regs->SP.W);
-    speccy->z80Regs->SP.W++;
-    speccy->z80Regs->PC.B.h = speccy->z80_peek(speccy->z80Regs->SP.W);
-    speccy->z80Regs->SP.W++;
+    // the PC and paging come after the first 48K
+    speccy->z80Regs->PC.B.l = source[49179];
+    speccy->z80Regs->PC.B.h = source[49180];
+    uint8_t page = source[49181];
+    // switch the pages to the correct ones
+    speccy->mem.page(page, true);
   }
-  else if (model == SPECMDL_16K)
+  // read in each chunk of RAM that is currently mapped in
+  int chunks = model == SPECMDL_16K ? 1 : 3;
+  for (int i = 0; i < chunks; i++)
   {
-    fread(speccy->mem.mappedMemory[1], 0x4000, 1, fp);
-    speccy->z80Regs->PC.B.l = speccy->z80_peek(speccy->z80Regs->SP.W);
-    speccy->z80Regs->SP.W++;
-    speccy->z80Regs->PC.B.h = speccy->z80_peek(speccy->z80Regs->SP.W);
-    speccy->z80Regs->SP.W++;
+    readBytes(source, 27 + i * 0x4000, speccy->mem.mappedMemory[i + 1]->data, 0x4000);
+    speccy->mem.mappedMemory[i + 1]->isDirty = true;
   }
-  else
+  if (model == SPECMDL_128K)
   {
-    // 128K
-    fseek(fp, 49179, SEEK_SET);
-    fread(&unbyte, 1, 1, fp); // FIXME seguro que hay formas mejores
-    speccy->z80Regs->PC.B.l = unbyte;
-    fread(&unbyte, 1, 1, fp);
-    speccy->z80Regs->PC.B.h = unbyte;
-    fread(&page, 1, 1, fp);
-    // switch the pages to the correct ones
-    speccy->mem.page(page, true);
-    // ahora empezamos a rellenar ram.
-    fseek(fp, 27, SEEK_SET);
-    // load up the current RAM
-    fread(speccy->mem.mappedMemory[1], 0x4000, 1, fp);
-    fread(speccy->mem.mappedMemory[2], 0x4000, 1, fp);
-    fread(speccy->mem.mappedMemory[3], 0x4000, 1, fp);
     // load the rest of the pages - ignoring the ones we've already loaded (5, 2, currentPage)
-    fseek(fp, 49183, SEEK_SET);
+    uint32_t offset = 49183;
     // this is the page that is mapped into the memory already and has already been loaded
-    int currentPage = page & 0x07;
+    int currentPage = speccy->mem.hwBank & 0x07;
     for (int i = 0; i < 8; i++)
     {
       if (i == currentPage || i == 5 || i == 2)
@@ -504,16 +434,87 @@ bool LoadSNA(ZXSpectrum *speccy, const char *filename)
         // nothing to do for these banks as they've already been loaded
         continue;
       }
-      else
-      {
-        fread(speccy->mem.banks[i]->data, 0x4000, 1, fp);
-      }
+      readBytes(source, offset, speccy->mem.banks[i]->data, 0x4000);
+      speccy->mem.banks[i]->isDirty = true;
+      offset += 0x4000;
     }
   }
-  fclose(fp);
+  else
+  {
+    // the PC was pushed on to the stack
+    speccy->z80Regs->PC.B.l = speccy->z80_peek(speccy->z80Regs->SP.W);
+    speccy->z80Regs->SP.W++;
+    speccy->z80Regs->PC.B.h = speccy->z80_peek(speccy->z80Regs->SP.W);
+    speccy->z80Regs->SP.W++;
+  }
   return true;
 }
 
+SnapshotFormat snapshotFormat(const char *filename)
+{
+  // convert the filename to lower case
+  std::string filenameStr = filename;
+  std::transform(filenameStr.begin(), filenameStr.end(), filenameStr.begin(), ::tolower);
+  if (strstr(filenameStr.c_str(), ".sna") != NULL)
+  {
+    return SNAPSHOT_SNA;
+  }
+  else if (strstr(filenameStr.c_str(), ".z80") != NULL)
+  {
+    return SNAPSHOT_Z80;
+  }
+  return SNAPSHOT_UNKNOWN;
+}
+
+static bool loadSnapshot(ZXSpectrum *speccy, TapeSource &source, SnapshotFormat format)
+{
+  switch (format)
+  {
+  case SNAPSHOT_SNA:
+    return loadSNA(speccy, source);
+  case SNAPSHOT_Z80:
+    return loadZ80(speccy, source);
+  default:
+    return false;
+  }
+}
+
+static bool loadFile(ZXSpectrum *speccy, const char *filename, SnapshotFormat format)
+{
+  FILE *fp = fopen(filename, "rb");
+  if (!fp)
+  {
+    printf("Could not open file %s\n", filename);
+    return false;
+  }
+  // the file is read through a window so we never need all of it in memory
+  TapeSource source(fp, true);
+  return loadSnapshot(speccy, source, format);
+}
+
+bool Load(ZXSpectrum *speccy, const char *filename)
+{
+  return loadFile(speccy, filename, snapshotFormat(filename));
+}
+
+bool Load(ZXSpectrum *speccy, const uint8_t *data, size_t length, SnapshotFormat format)
+{
+  TapeSource source(data, length);
+  return loadSnapshot(speccy, source, format);
+}
+
+bool LoadZ80(ZXSpectrum *speccy, const char *filename)
+{
+  printf("Loading Z80 file %s\n", filename);
+  return loadFile(speccy, filename, SNAPSHOT_Z80);
+}
+
+bool LoadSNA(ZXSpectrum *speccy, const char *filename)
+{
+  printf("Loading SNA file %s\n", filename);
+  return loadFile(speccy, filename, SNAPSHOT_SNA);
+}
+
 uint8_t LoadSCR(ZXSpectrum *speccy, FILE *fp)
 {
   int i;
@@ -33,20 +33,161 @@
 #include "./z80/z80.h"
 #include "./spectrum.h"
 
+enum SnapshotFormat
+{
+  SNAPSHOT_UNKNOWN = 0,
+  SNAPSHOT_Z80,
+  SNAPSHOT_SNA
+};
+
+// work out what sort of snapshot a file is from its extension
+SnapshotFormat snapshotFormat(const char *filename);
+// what the header of a .z80 file says - the header needs to be at least 35 bytes
+int getZ80Version(uint8_t *buffer);
+models_enum getHardwareModel(uint8_t *buffer, int version);
 bool Load( ZXSpectrum *speccy, const char *filename);
+// load a snapshot that is already in memory
+bool Load(ZXSpectrum *speccy, const uint8_t *data, size_t length, SnapshotFormat format);
 bool LoadSNA(ZXSpectrum *speccy, const char *filename);
 bool LoadZ80(ZXSpectrum *speccy, const char *filename);
+// runs of the same byte are written as ED ED count byte as they're compressed - this is how much of
+// the compressed page we hold on to before handing it to writeBytes
+#define Z80_WRITER_SCRATCH 512
+
 class Z80Writer
 {
 protected:
   ZXSpectrum *speccy;
+  uint8_t scratch[Z80_WRITER_SCRATCH];
+  size_t scratchUsed = 0;
   virtual bool start() = 0;
   virtual void writeByte(uint8_t byte) = 0;
   virtual void writeBytes(const uint8_t *data, size_t size) = 0;
   virtual void end() = 0;
+  // the RAM banks that go in the file for each page number
+  void mapPages(uint8_t *pageMap[16])
+  {
+    memset(pageMap, 0, 16 * sizeof(uint8_t *));
+    if (speccy->hwopt.hw_model == SPECMDL_48K)
+    {
+      pageMap[4] = speccy->mem.banks[2]->data;
+      pageMap[5] = speccy->mem.banks[0]->data;
+      pageMap[8] = speccy->mem.banks[5]->data;
+    }
+    else if (speccy->hwopt.hw_model == SPECMDL_128K)
+    {
+      pageMap[3] = speccy->mem.banks[0]->data;
+      pageMap[4] = speccy->mem.banks[1]->data;
+      pageMap[5] = speccy->mem.banks[2]->data;
+      pageMap[6] = speccy->mem.banks[3]->data;
+      pageMap[7] = speccy->mem.banks[4]->data;
+      pageMap[8] = speccy->mem.banks[5]->data;
+      pageMap[9] = speccy->mem.banks[6]->data;
+      pageMap[10] = speccy->mem.banks[7]->data;
+    }
+  }
+  inline void put(uint8_t byte, bool emit)
+  {
+    if (!emit)
+    {
+      return;
+    }
+    if (scratchUsed == Z80_WRITER_SCRATCH)
+    {
+      flush();
+    }
+    scratch[scratchUsed++] = byte;
+  }
+  void flush()
+  {
+    if (scratchUsed > 0)
+    {
+      writeBytes(scratch, scratchUsed);
+      scratchUsed = 0;
+    }
+  }
+  // Compress a 16K page - returns the compressed length and writes it out if emit is set.
+  // Five or more of the same byte (or two or more EDs) become ED ED count byte. A single ED is written as it
+  // is and the byte after it is never the start of a run so the loader doesn't mistake it for one - unless it is
+  // the last byte of the page, which has to be a run of one as there is nothing to follow it.
+  size_t compressPage(const uint8_t *data, bool emit)
+  {
+    size_t length = 0;
+    int i = 0;
+    while (i < 0x4000)
+    {
+      uint8_t value = data[i];
+      int run = 1;
+      while (i + run < 0x4000 && run < 255 && data[i + run] == value)
+      {
+        run++;
+      }
+      if (run >= 5 || (value == 0xED && (run >= 2 || i == 0x3FFF)))
+      {
+        put(0xED, emit);
+        put(0xED, emit);
+        put(run, emit);
+        put(value, emit);
+        length += 4;
+        i += run;
+      }
+      else if (value == 0xED)
+      {
+        put(0xED, emit);
+        put(data[i + 1], emit);
+        length += 2;
+        i += 2;
+      }
+      else
+      {
+        put(value, emit);
+        length++;
+        i++;
+      }
+    }
+    return length;
+  }
+  // pages that don't get any smaller are written uncompressed
+  void writePage(int page, const uint8_t *data)
+  {
+    size_t length = compressPage(data, false);
+    bool compressed = length < 0x4000;
+    if (!compressed)
+    {
+      length = 0xFFFF;
+    }
+    put(length & 0xFF, true);
+    put(length >> 8, true);
+    put(page, true);
+    if (compressed)
+    {
+      compressPage(data, true);
+    }
+    else
+    {
+      flush();
+      writeBytes(data, 0x4000);
+    }
+  }
 public:
   Z80Writer(ZXSpectrum *speccy) : speccy(speccy) {}
   virtual ~Z80Writer() {}
+  // how big the file will be
+  size_t compressedSize()
+  {
+    size_t size = 30 + 54 + 2;
+    uint8_t *pageMap[16];
+    mapPages(pageMap);
+    for (int page = 0; page < 16; ++page)
+    {
+      if (pageMap[page] != NULL)
+      {
+        size_t length = compressPage(pageMap[page], false);
+        size += 3 + (length < 0x4000 ? length : 0x4000);
+      }
+    }
+    return size;
+  }
   virtual bool saveZ80()
   {
     if (!start())
@@ -108,41 +249,19 @@ public:
     // e.g., include additional data like the interrupt mode or border color as needed.
     writeBytes(header, sizeof(header));
   
-    // Write the memory pages, uncompressed
-    uint8_t *pageMap[16] = {0};
-  
-    // Map pages based on 48K or 128K model
-    if (speccy->hwopt.hw_model == SPECMDL_48K)
-    {
-      pageMap[4] = speccy->mem.banks[2]->data;
-      pageMap[5] = speccy->mem.banks[0]->data;
-      pageMap[8] = speccy->mem.banks[5]->data;
-    }
-    else if (speccy->hwopt.hw_model == SPECMDL_128K)
-    {
-      pageMap[3] = speccy->mem.banks[0]->data;
-      pageMap[4] = speccy->mem.banks[1]->data;
-      pageMap[5] = speccy->mem.banks[2]->data;
-      pageMap[6] = speccy->mem.banks[3]->data;
-      pageMap[7] = speccy->mem.banks[4]->data;
-      pageMap[8] = speccy->mem.banks[5]->data;
-      pageMap[9] = speccy->mem.banks[6]->data;
-      pageMap[10] = speccy->mem.banks[7]->data;
-    }
-  
+    // Write the memory pages, compressed
+    uint8_t *pageMap[16];
+    mapPages(pageMap);
+    scratchUsed = 0;
     for (int page = 0; page < 16; ++page)
     {
         if (pageMap[page] != NULL)
         {
             printf("Writing page: %d\n", page);
-            // Write uncompressed page
-            uint16_t length = 0xFFFF; // Indicates uncompressed block
-            writeByte(length & 0xFF); // low byte
-            writeByte(length >> 8);   // high byte
-            writeByte(page);          // page number
-            writeBytes(pageMap[page], 0x4000); // Write full 16KB page
+            writePage(page, pageMap[page]);
         }
     }
+    flush();
     end();
     return true;
   }
@@ -193,8 +312,12 @@ class Z80MemoryWriter : public Z80Writer
     size_t bufferSize = 0;
     size_t offset = 0;
     virtual bool start() {
+      // make the buffer just big enough for the compressed file
+      free(buffer);
+      bufferSize = compressedSize();
+      buffer = (uint8_t *)malloc(bufferSize);
       offset = 0;
-      return true;
+      return buffer != nullptr;
     }
     virtual void writeByte(uint8_t byte) {
       if (offset < bufferSize)
@@ -211,23 +334,12 @@ class Z80MemoryWriter : public Z80Writer
     }
     virtual void end() {}
   public:
-    Z80MemoryWriter(ZXSpectrum *speccy): Z80Writer(speccy) {
-      // create space for the z80 file - the header is 30 + 54 + 2 bytes and 
-      // if we are a 48K machine we write 3 pages of 16384 + 3 bytes
-      // and if we are a 128K machine we write 8 pages of 16384 + 3 bytes
-      if (speccy->hwopt.hw_model == SPECMDL_48K) {
-        bufferSize = 30 + 54 + 2 + 3 * (16384 + 3);
-      }
-      if (speccy->hwopt.hw_model == SPECMDL_128K) {
-        bufferSize = 30 + 54 + 2 + 8 * (16384 + 3);
-      }
-      buffer = (uint8_t *)malloc(bufferSize);
-    }
+    Z80MemoryWriter(ZXSpectrum *speccy): Z80Writer(speccy) {}
     ~Z80MemoryWriter() {
       free(buffer);
     }
     size_t size() {
-      return bufferSize;
+      return offset;
     }
     uint8_t *data() {
       return buffer;
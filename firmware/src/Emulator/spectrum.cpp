@@ -24,6 +24,7 @@
 #include "spectrum.h"
 #include "48k_rom.h"
 #include "128k_rom.h"
+#include "../TZX/TapeSource.h"
 
 const uint16_t specpal565[16] = {
     0x0000, 0x1B00, 0x00B8, 0x17B8, 0xE005, 0xF705, 0xE0BD, 0x18C6, 0x0000, 0x1F00, 0x00F8, 0x1FF8, 0xE007, 0xFF07, 0xE0FF, 0xFFFF
@@ -45,7 +46,7 @@ uint8_t speckey[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 int keys[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 int oldkeys[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
-ZXSpectrum::ZXSpectrum()
+ZXSpectrum::ZXSpectrum() : tapeDeck(this)
 {
   z80Regs = (Z80Regs *)malloc(sizeof(Z80Regs));
   z80Regs->userInfo = this;
@@ -61,12 +62,18 @@ int ZXSpectrum::runForFrame(AudioOutput *audioOutput, FILE *audioFile)
 {
   uint8_t audioBuffer[312];
   uint8_t *attrBase = mem.currentScreen->data + 0x1800;
+  if (tstates >= FRAME_TSTATES)
+  {
+    // we've been run outside of the frame loop (e.g. by the tape loader) so start afresh
+    tstates = 0;
+    beeper.reset();
+  }
   int c = 0;
   // Each line should be 224 tstates long...
   // And a complete frame is (64+192+56)*224=69888 tstates long
   for (int i = 0; i < 312; i++)
   {
-    if (audioOutput) {
+    if (audioOutput && !tapeDeck.isPlaying()) {
       setMicValue(audioOutput->getMicValue());
     }
     // handle port FF for the border - is this actually doing anything useful?
@@ -80,23 +87,30 @@ int ZXSpectrum::runForFrame(AudioOutput *audioOutput, FILE *audioFile)
       uint8_t attr = *(attrBase + 32 * (i - 64) / 8);
       hwopt.portFF = attr;
     }
-    // run for 224 cycles
-    c += 224;
-    uint16_t speakerValue = runForCycles(224);
+    // run up to the end of this line - any overshoot from the previous line is taken off this one
+    c += runForCycles((i + 1) * 224 - tstates);
     borderColors[i] = hwopt.BorderColor & 0b00000111;
-    audioBuffer[i] = speakerValue/4;
   }
   interrupt();
+  tapeDeck.endFrame(FRAME_TSTATES);
+  tapeRecorder.endFrame(FRAME_TSTATES);
+  // the speaker transitions were logged as they happened - turn them into samples
+  beeper.endFrame(audioBuffer);
+  // carry any overshoot into the next frame
+  tstates -= FRAME_TSTATES;
 
   // AY emulation
   if (hwopt.hw_model == SPECMDL_128K)
   {
-    AySound::gen_sound(312, 0);
+    // register writes were logged with their t-states during the frame - render them in place
+    AySound::gen_frame();
     // merge the AY sound with the audio buffer
     for (int i = 0; i < 312; i++)
     {
-      // max output from the AYSound is 158 (I think...), scale it up to 255 and combine with the buzzer output
-      audioBuffer[i] = std::max((int) audioBuffer[i], (int) AySound::SamplebufAY[i] * 255 / 158);
+      // max output from the AYSound is 158 (I think...), scale it up to 255 and combine with the buzzer output -
+      // both are silent at the same level
+      audioBuffer[i] = std::max((int) audioBuffer[i],
+                                Beeper::SILENCE + (int) AySound::SamplebufAY[i] * (255 - Beeper::SILENCE) / 158);
     }
   }
   if (audioFile != NULL) {
@@ -116,6 +130,215 @@ void ZXSpectrum::interrupt()
   Z80Interrupt(z80Regs, 0x38);
 }
 
+// the S, Z, 5, 3 and parity flags that XOR and OR leave - H, N and the carry are reset
+static uint8_t logicFlags(uint8_t value)
+{
+  return (value & 0xA8) | (value == 0 ? 0x40 : 0) | (__builtin_parity(value) ? 0 : 0x04);
+}
+
+// The ROM tape loader is at LD-START (0x056C) or is in LD-SAMPLE (0x05ED) looking for the first
+// edge of a block - instead of timing the edges we copy the block straight into memory and leave
+// the registers as LD-BYTES would have done.
+// On entry A' holds the flag byte we are looking for, the carry in F' is set for LOAD and reset
+// for VERIFY, IX is the destination, DE the number of bytes wanted and C has the EAR level the
+// loader started with in bit 5.
+// LD-BYTES reads DE bytes after the flag byte and then one more for the parity. It returns:
+//  - from LD-FLAG if the flag byte is wrong: A = flag wanted XOR flag read, F from the XOR
+//  - from LD-VERIFY if a byte doesn't match: A = memory XOR byte read, F from the XOR
+//  - from LD-8-BITS if the tape runs out: A = 0, F = 0x50 from the INC B that timed out, B = 0, L = 1
+//  - after the parity byte: A = H, F from CP 01 so the carry is set if the parity is good, B = 0xB0
+// H is the parity of everything read, L the last byte read and IX and DE have moved on by the bytes
+// stored or verified. C is complemented on every edge so bit 5 follows the EAR level, the sync pulse
+// swaps the border colours in bits 0-1 and LD-FLAG loses bit 7. A' and F' are whatever LD-LOOP last
+// swapped out. The only thing we leave differently is the free memory below the stack, where the
+// loader's calls leave their return addresses - desktop/flash_load_bench checks all of these against
+// the ROM.
+// We then jump to the RET at 0x05E2 which returns through SA/LD-RET exactly as the ROM does.
+void ZXSpectrum::trapLoadBlock()
+{
+  const uint8_t CARRY = 0x01;
+  // only the 48K BASIC ROM has LD-BYTES here - on the 128K it's ROM 1
+  if (mem.mappedMemory[0] != mem.rom[hwopt.hw_model == SPECMDL_128K ? 1 : 0])
+  {
+    return;
+  }
+  Z80Regs *regs = z80Regs;
+  if (regs->PC.W == 0x05ED)
+  {
+    // LD-SAMPLE is used throughout the loader - we only want it when it was called from LD-START
+    uint16_t returnAddress = mem.peek(regs->SP.W) | (mem.peek(regs->SP.W + 1) << 8);
+    if (returnAddress != 0x056F)
+    {
+      return;
+    }
+    // throw away the return to LD-START
+    regs->SP.W += 2;
+  }
+  flashLoadDone = true;
+  TapeSource &tape = *flashLoadSource;
+  uint32_t start = flashLoadOffset;
+  int length = flashLoadLength;
+  regs->PC.W = 0x05E2;
+  bool verify = !(regs->AFs.B.l & CARRY);
+  uint8_t wantedFlag = regs->AFs.B.h;
+  // standard pilot tones have an odd number of pulses so the sync pulses end on the other level
+  bool syncLevel = !flashLoadLevel;
+  uint8_t c = regs->BC.B.l;
+  if (((c & 0x20) != 0) != syncLevel)
+  {
+    c = ~c;
+  }
+  c ^= 0x03;
+  regs->BC.B.h = 0xB0;
+  if (length == 0)
+  {
+    // nothing after the sync pulses - it times out waiting for the flag byte
+    regs->AF.B.h = 0;
+    regs->AF.B.l = 0x50;
+    regs->BC.B.h = 0;
+    // the signal going low for the pause is one more edge
+    regs->BC.B.l = syncLevel ? ~c : c;
+    regs->HL.W = 0x0001;
+    return;
+  }
+  uint8_t parity = tape[start];
+  regs->HL.B.l = parity;
+  if (regs->DE.W == 0)
+  {
+    // nothing wanted - the flag byte is taken as the parity byte
+    regs->BC.B.l = c;
+    regs->HL.B.h = parity;
+    regs->AF.B.h = parity;
+    regs->AF.B.l = (parity == 0 ? CARRY : 0) | 0x02 | (parity == 1 ? 0x40 : 0) | ((parity & 0x0F) == 0 ? 0x10 : 0) | (parity == 0x80 ? 0x04 : 0) | ((parity - 1) & 0x80);
+    return;
+  }
+  // LD-LOOP swaps the flag wanted back in and leaves D OR E in A'
+  uint8_t left = regs->DE.B.h | regs->DE.B.l;
+  regs->AFs.B.h = left;
+  regs->AFs.B.l = logicFlags(left);
+  if (parity != wantedFlag)
+  {
+    // wrong type of block - LD-FLAG rotates the carry into C before it checks
+    regs->BC.B.l = (c << 1) | (verify ? 0 : CARRY);
+    regs->HL.B.h = parity;
+    regs->AF.B.h = wantedFlag ^ parity;
+    regs->AF.B.l = logicFlags(wantedFlag ^ parity);
+    return;
+  }
+  // LD-FLAG rotates C back again through the carry the XOR reset and then swaps C and the flags out
+  c &= 0x7F;
+  regs->BC.B.l = c;
+  regs->AFs.B.h = c;
+  regs->AFs.B.l = 0x44 | (c & 0x28) | (verify ? 0 : CARRY);
+  // the data follows the flag byte and ends with the parity byte
+  int available = length - 1;
+  int toRead = available;
+  if (toRead > regs->DE.W)
+  {
+    toRead = regs->DE.W;
+  }
+  for (int i = 0; i < toRead; i++)
+  {
+    uint8_t value = tape[start + 1 + i];
+    uint16_t address = regs->IX.W + i;
+    parity ^= value;
+    if (verify)
+    {
+      if (mem.peek(address) != value)
+      {
+        uint16_t wanted = regs->DE.W - i;
+        regs->AFs.B.h = (wanted >> 8) | (wanted & 0xFF);
+        regs->AFs.B.l = logicFlags(regs->AFs.B.h);
+        regs->AF.B.h = mem.peek(address) ^ value;
+        regs->AF.B.l = logicFlags(regs->AF.B.h);
+        regs->HL.B.h = parity;
+        regs->HL.B.l = value;
+        regs->IX.W += i;
+        regs->DE.W -= i;
+        return;
+      }
+      // each byte that matches leaves a zero in A' with Z and P set
+      regs->AFs.B.h = 0;
+      regs->AFs.B.l = 0x44;
+    }
+    else
+    {
+      mem.poke(address, value);
+    }
+  }
+  regs->IX.W += toRead;
+  regs->DE.W -= toRead;
+  if (toRead > 0)
+  {
+    regs->HL.B.l = tape[start + toRead];
+  }
+  if (regs->DE.W == 0 && toRead < available)
+  {
+    // check the parity byte - the ROM does LD A,H then CP 01 which sets the carry if the parity is zero
+    regs->HL.B.l = tape[start + toRead + 1];
+    parity ^= tape[start + toRead + 1];
+    uint8_t a = parity;
+    uint8_t result = a - 1;
+    regs->AF.B.h = a;
+    regs->AF.B.l = (a == 0 ? CARRY : 0) | 0x02 | (result == 0 ? 0x40 : 0) | ((a & 0x0F) == 0 ? 0x10 : 0) | (a == 0x80 ? 0x04 : 0) | (result & 0x80);
+  }
+  else
+  {
+    // the block was shorter than we wanted - it times out waiting for the next byte and the signal going
+    // low for the pause is one more edge
+    regs->AF.B.h = 0;
+    regs->AF.B.l = 0x50;
+    regs->BC.B.h = 0;
+    regs->BC.B.l = syncLevel ? ~c : c;
+    regs->HL.B.l = 1;
+  }
+  regs->HL.B.h = parity;
+}
+
+// The ROM is about to save a block with SA-BYTES (0x04C2) - instead of playing it out of the MIC socket
+// we write it straight to the tape recorder and leave the registers as SA-BYTES would have done.
+// On entry A holds the flag byte, IX the start of the data and DE its length.
+// On exit:
+//  A  = 0, F = 0x51 (the INC A that ends the last byte with the carry from the BREAK check)
+//  BC = 0x000E (C is what it was sending to port 0xFE), HL = 0 (the parity of everything sent including the
+//  parity byte)
+//  IX : moved past the data, DE = 0xFFFF
+// We then jump to SA/LD-RET (0x053F) which SA-BYTES leaves on the stack for its RET - it restores
+// the border, checks for BREAK and enables interrupts just as it would after a real save.
+void ZXSpectrum::trapSaveBlock()
+{
+  // only the 48K BASIC ROM has SA-BYTES here - on the 128K it's ROM 1
+  if (mem.mappedMemory[0] != mem.rom[hwopt.hw_model == SPECMDL_128K ? 1 : 0])
+  {
+    return;
+  }
+  Z80Regs *regs = z80Regs;
+  int length = regs->DE.W;
+  // the flag byte, the data and the parity byte
+  std::vector<uint8_t> block(length + 2);
+  uint8_t parity = regs->AF.B.h;
+  block[0] = parity;
+  for (int i = 0; i < length; i++)
+  {
+    // a block that runs past 0xFFFF carries on from 0x0000 as it does on a real machine
+    block[1 + i] = mem.peek((uint16_t)(regs->IX.W + i));
+    parity ^= block[1 + i];
+  }
+  block[length + 1] = parity;
+  if (!tapeRecorder.saveBlock(block.data(), block.size()))
+  {
+    // let the ROM play it out of the MIC socket instead
+    return;
+  }
+  regs->IX.W += length + 1;
+  regs->DE.W = 0xFFFF;
+  regs->HL.W = 0;
+  regs->BC.W = 0x000E;
+  regs->AF.B.h = 0;
+  regs->AF.B.l = 0x51;
+  regs->PC.W = 0x053F;
+}
+
 void ZXSpectrum::updateKey(SpecKeys key, uint8_t state)
 {
   // Bit pattern: XXXFULDR
@@ -278,6 +501,7 @@ bool ZXSpectrum::init_128k()
   AySound::init();
   AySound::set_sound_format(15625,1,8);
   AySound::set_stereo(AYEMU_MONO,NULL);
+  AySound::set_frame_tstates(FRAME_TSTATES);
   AySound::reset();
 
   // Empty audio buffers
@@ -7,9 +7,15 @@
 #include "keyboard_defs.h"
 #include <string.h>
 #include "../AYSound/AySound.h"
+#include "Beeper.h"
+#include "../TZX/TapeDeck.h"
+#include "../TZX/TapeRecorder.h"
 
 extern uint8_t speckey[8];
 
+// (64+192+56)*224 t-states in a frame
+#define FRAME_TSTATES 69888
+
 extern const uint16_t specpal565[16];
 
 enum models_enum
@@ -62,11 +68,19 @@ class MemoryPage {
 public:
   bool isDirty;
   uint8_t *data;
+  // time travel wants the page as it was when it was recorded - it gets copied here before it next changes
+  uint8_t *copyOnWrite = nullptr;
   MemoryPage() {
     isDirty = false;
     data = (uint8_t *) malloc(0x4000);
     memset(data, 0, 0x4000);
   }
+  inline void beforeWrite() {
+    if (copyOnWrite) {
+      memcpy(copyOnWrite, data, 0x4000);
+      copyOnWrite = nullptr;
+    }
+  }
 };
 
 class Memory {
@@ -124,6 +138,7 @@ class Memory {
       if (memoryBank == 0) {
         // ignore writes to rom
       } else {
+        mappedMemory[memoryBank]->beforeWrite();
         mappedMemory[memoryBank]->data[bankAddress] = value;
         mappedMemory[memoryBank]->isDirty = true;
       }
@@ -139,6 +154,8 @@ class Memory {
 };
 
 class AudioOutput;
+class TapeSource;
+class MachineStatePages;
 
 class ZXSpectrum
 {
@@ -152,17 +169,70 @@ public:
   uint8_t borderColors[312] = {0};
   // indicates that the ROM loading routine is active
   bool romLoadingRoutineHit = false;
+  // a standard speed tape block that can be copied straight into memory when the ROM loader reaches LD-START
+  TapeSource *flashLoadSource = nullptr;
+  uint32_t flashLoadOffset = 0;
+  int flashLoadLength = 0;
+  // the EAR level when the offered block started - the ROM loader's C register depends on it
+  bool flashLoadLevel = false;
+  // set when the offered block has been loaded
+  bool flashLoadDone = false;
+  // band limited synthesis of the speaker
+  Beeper beeper;
+  // the tape deck plugged into the EAR socket
+  TapeDeck tapeDeck;
+  // the tape recorder plugged into the MIC socket
+  TapeRecorder tapeRecorder;
+  // t-states executed so far in the current frame
+  int tstates = 0;
+  // the frame t-state that the current call to Z80Run will stop at
+  int sliceEndTStates = 0;
 
   ZXSpectrum();
   void reset();
   int runForFrame(AudioOutput *audioOutput, FILE *audioFile);
   inline int runForCycles(int cycles)
   {
-    return Z80Run(z80Regs, cycles);
+    if (tstates >= 2 * FRAME_TSTATES)
+    {
+      // we're being run outside of the frame loop - stop the counter from growing forever
+      tstates -= FRAME_TSTATES;
+    }
+    sliceEndTStates = tstates + cycles;
+    int executed = Z80Run(z80Regs, cycles);
+    tstates += executed;
+    return executed;
+  }
+  // the frame t-state of the instruction that is currently executing
+  inline int currentTState()
+  {
+    return sliceEndTStates - z80Regs->cycles;
   }
 
   void interrupt();
   void updateKey(SpecKeys key, uint8_t state);
+  // offer a block for flash loading - pass nullptr to withdraw it
+  void offerFlashLoad(TapeSource *source, uint32_t offset, int length)
+  {
+    flashLoadSource = source;
+    flashLoadOffset = offset;
+    flashLoadLength = length;
+    // blocks are offered before their first pulse is played - the deck only brings micLevel up to date when
+    // the EAR is read
+    flashLoadLevel = tapeDeck.isPlaying() ? tapeDeck.getLevel() : micLevel;
+    flashLoadDone = false;
+  }
+  // called by the Z80 when it reaches LD-START with a block on offer
+  void trapLoadBlock();
+  // called by the Z80 when it reaches SA-BYTES and the tape recorder is recording
+  void trapSaveBlock();
+  // save the state of the machine between frames - see MachineState.h. Returns the length of the state or 0
+  // if it doesn't fit in the buffer. The RAM banks are copied into the state unless pages keeps them.
+  size_t saveState(uint8_t *buffer, size_t size, MachineStatePages *pages = nullptr);
+  // carry on from a saved state - banks that aren't in the state are asked for from pages
+  bool loadState(const uint8_t *buffer, size_t size, MachineStatePages *pages = nullptr);
+  // the most space a state can take up - just the machine if the RAM banks are being kept elsewhere
+  size_t stateSize(bool withBanks = true);
 
   inline uint8_t z80_peek(uint16_t address)
   {
@@ -197,6 +267,16 @@ inline uint8_t z80_in(uint16_t port)
     if (!(port & 0x8000))
       data &= speckey[7]; // keys b-m,symb,space
 
+    // the tape is only played up to now when we need to know the EAR level
+    if (tapeDeck.isPlaying())
+    {
+      micLevel = tapeDeck.update(currentTState());
+      // skip ahead if this is a loader waiting for the next edge
+      if (tapeDeck.skipLoaderLoop(z80Regs->PC.W, currentTState(), micLevel ? data | 0x40 : data & 0xBF))
+      {
+        micLevel = tapeDeck.update(currentTState());
+      }
+    }
     // set bit 6 if the MIC is active
     if (micLevel)
     {
@@ -237,6 +317,11 @@ inline void z80_out(uint16_t port, uint8_t data)
   {
     hwopt.BorderColor = (data & 0x07);
     hwopt.SoundBits = (data & 0b00010000);
+    beeper.setLevel(currentTState(), hwopt.SoundBits != 0);
+    if (tapeRecorder.isRecording())
+    {
+      tapeRecorder.setMic(currentTState(), data & 0b00001000);
+    }
   }
   else
   {
@@ -247,7 +332,7 @@ inline void z80_out(uint16_t port, uint8_t data)
         if ((port & 0x4000) != 0) {
             AySound::selectRegister(data);
         } else {
-            AySound::setRegisterData(data);
+            AySound::setRegisterData(data, currentTState());
         }
       }
     }
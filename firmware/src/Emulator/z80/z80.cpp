@@ -26,6 +26,7 @@
   int memoryBank = (where) >> 14;                   \
   if (memoryBank != 0)                              \
   {                                                 \
+    mappedMemory[memoryBank]->beforeWrite();        \
     mappedMemory[memoryBank]->data[(where) & 0x3fff] = A; \
     mappedMemory[memoryBank]->isDirty = true;       \
   }                                                 \
@@ -87,7 +88,7 @@ void Z80Reset(Z80Regs *regs)
 }
 
 /*====================================================================
-  word Z80Run( Z80Regs *regs, int numopcodes )
+  int Z80Run( Z80Regs *regs, int numcycles )
 
   This function does the whole Z80 simulation. It consists on a
   for(;;) loop (as stated on Marat's Fayzullin HOWTO -How to
@@ -114,8 +115,11 @@ void Z80Reset(Z80Regs *regs)
 
   Pass as numcycles the number of clock cycle you want to execute
   z80 opcodes for or < 0 (negative) to execute "infinite" opcodes.
+
+  Returns the number of cycles actually executed - this can overshoot
+  numcycles by up to one instruction.
  ===================================================================*/
-uint16_t Z80Run(Z80Regs *regs, int numcycles)
+int Z80Run(Z80Regs *regs, int numcycles)
 {
   ZXSpectrum *spectrum = ((ZXSpectrum *)regs->userInfo);
   Memory &memory = spectrum->mem;
@@ -131,10 +135,8 @@ uint16_t Z80Run(Z80Regs *regs, int numcycles)
   // loop = (regs->cycles - numcycles);
   regs->cycles = numcycles;
   /* this is the emulation main loop */
-  uint16_t micValue = 0;
   while (regs->cycles > 0)
   {
-    int startCycles = regs->cycles;
     if (regs->halted == 1)
     {
       r_PC--;
@@ -173,19 +175,25 @@ uint16_t Z80Run(Z80Regs *regs, int numcycles)
       regs->we_are_on_ddfd = 0;
       break;
     }
-    int totalCycles = startCycles - regs->cycles;
-    micValue += spectrum->hwopt.SoundBits != 0 ? totalCycles : 0;
     /* patch ROM loading routine */
     // address contributed by Ignacio Burgueño :)
     if (r_PC >= 0x04C2  && r_PC < 0x09F4) {
-      // set a flag to indicate that the ROM loading routine has been hit
-      spectrum->romLoadingRoutineHit = true;
+      // set a flag to indicate that the ROM loading routine has been hit - SA-BYTES and SA-CONTRL are saving
+      spectrum->romLoadingRoutineHit = r_PC >= 0x0556 && r_PC < 0x0970;
+      // SA-BYTES is about to save a block
+      if (r_PC == 0x04C2 && spectrum->tapeRecorder.isTrappingSaves()) {
+        spectrum->trapSaveBlock();
+      }
     // printf("ROM loading routine hit\n");
+      // a tape block is waiting to be flash loaded - LD-START or LD-SAMPLE could be the loader looking for it
+      if ((r_PC == 0x056C || r_PC == 0x05ED) && spectrum->flashLoadSource && !spectrum->flashLoadDone) {
+        spectrum->trapLoadBlock();
+      }
     } else {
       spectrum->romLoadingRoutineHit = false;
     }
   }
-  return micValue;
+  return numcycles - regs->cycles;
 }
 
 /*====================================================================
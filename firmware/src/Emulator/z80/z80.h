@@ -146,7 +146,7 @@ typedef struct {
  ===================================================================*/ 
 void     Z80Reset (Z80Regs * regs);
 void     Z80Interrupt (Z80Regs *, uint16_t);
-uint16_t Z80Run (Z80Regs *, int);
+int      Z80Run (Z80Regs *, int);
 void     Z80Patch (Z80Regs *);
 byte     Z80Debug (Z80Regs *);
 void     Z80FlagTables (void);
@@ -4,4 +4,12 @@ class ISettings {
   public:
     virtual int getVolume() = 0;
     virtual void setVolume(int volume) = 0;
+    // keep a snapshot of each tape once it has loaded so it starts straight away next time
+    virtual bool getSnapshotCache() = 0;
+    virtual void setSnapshotCache(bool enabled) = 0;
+    // copy standard speed blocks straight into memory and how many times faster than real time tapes play
+    virtual bool getFlashLoad() = 0;
+    virtual void setFlashLoad(bool enabled) = 0;
+    virtual int getTapeSpeed() = 0;
+    virtual void setTapeSpeed(int speed) = 0;
 };
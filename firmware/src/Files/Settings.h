@@ -54,6 +54,28 @@ class Settings: public ISettings {
       doc["volume"] = volume;
       save();
     }
+    bool getSnapshotCache() {
+      // settings saved before this was added don't have it
+      return doc["snapshotCache"] | true;
+    }
+    void setSnapshotCache(bool enabled) {
+      doc["snapshotCache"] = enabled;
+      save();
+    }
+    bool getFlashLoad() {
+      return doc["flashLoad"] | true;
+    }
+    void setFlashLoad(bool enabled) {
+      doc["flashLoad"] = enabled;
+      save();
+    }
+    int getTapeSpeed() {
+      return doc["tapeSpeed"] | 1;
+    }
+    void setTapeSpeed(int speed) {
+      doc["tapeSpeed"] = speed;
+      save();
+    }
   private:
     IFiles *m_files;
     JsonDocument doc;
@@ -63,7 +63,71 @@ EmulatorScreen::EmulatorScreen(Display &tft, HDMIDisplay *hdmiDisplay, AudioOutp
                         {
     Serial.println("ROM loading routine hit");
     triggerLoadTape(); });
-  gameLoader = new GameLoader(machine, renderer, audioOutput);
+  gameLoader = new GameLoader(machine, renderer, audioOutput, m_files);
+  settings = audioOutput ? audioOutput->getSettings() : nullptr;
+  if (settings)
+  {
+    gameLoader->setFlashLoad(settings->getFlashLoad());
+    gameLoader->setTapeSpeed(settings->getTapeSpeed());
+    gameLoader->setSnapshotCache(settings->getSnapshotCache());
+  }
+}
+
+std::string EmulatorScreen::tapeOptionsPrompt()
+{
+  bool flashLoad = !settings || settings->getFlashLoad();
+  int tapeSpeed = settings ? settings->getTapeSpeed() : 1;
+  bool snapshotCache = !settings || settings->getSnapshotCache();
+  char prompt[60];
+  snprintf(prompt, sizeof(prompt), "Tape  1-Flash %s  2-Speed %dx  3-Cache %s", flashLoad ? "On" : "Off", tapeSpeed,
+           snapshotCache ? "On" : "Off");
+  return prompt;
+}
+
+void EmulatorScreen::toggleFlashLoad()
+{
+  if (!settings)
+  {
+    return;
+  }
+  bool enabled = !settings->getFlashLoad();
+  settings->setFlashLoad(enabled);
+  gameLoader->setFlashLoad(enabled);
+  // and for the tape that's in now
+  machine->getMachine()->tapeDeck.setFlashLoad(enabled);
+}
+
+void EmulatorScreen::nextTapeSpeed()
+{
+  if (!settings)
+  {
+    return;
+  }
+  // 1x, 2x, 4x, 8x and back to 1x - the extra frames are run without sound as fast as we can
+  int speed = settings->getTapeSpeed() * 2;
+  if (speed > 8)
+  {
+    speed = 1;
+  }
+  settings->setTapeSpeed(speed);
+  gameLoader->setTapeSpeed(speed);
+  machine->getMachine()->tapeDeck.setSpeed(speed);
+}
+
+void EmulatorScreen::toggleSnapshotCache()
+{
+  if (!settings)
+  {
+    return;
+  }
+  bool enabled = !settings->getSnapshotCache();
+  settings->setSnapshotCache(enabled);
+  gameLoader->setSnapshotCache(enabled);
+  if (!enabled)
+  {
+    // a multi-load game that is loading now shouldn't be cached either
+    machine->setSnapshotCacheFile("");
+  }
 }
 
 void EmulatorScreen::run(std::string filename, models_enum model)
@@ -72,6 +136,10 @@ void EmulatorScreen::run(std::string filename, models_enum model)
   renderer->start();
   auto bl = BusyLight();
   machine->setup(model);
+  // anything the game saves to tape goes in a TAP file next to it
+  ZXSpectrum *spectrum = machine->getMachine();
+  spectrum->tapeRecorder.setFilename(filename.size() > 0 ? TapeRecorder::savedTapeName(filename) : m_files->getPath("/saved.tap"));
+  machine->setQuickSaveFilename(filename.size() > 0 ? filename : m_files->getPath("/basic"));
   if (filename.size() > 0)
   {
     // check for tap or tpz files
@@ -81,8 +149,12 @@ void EmulatorScreen::run(std::string filename, models_enum model)
                    { return std::tolower(c); });
     if (ext == "tap" || ext == "tzx")
     {
-      machine->startLoading();
-      gameLoader->loadTape(filename.c_str());
+      // we only need to load the tape the first time
+      if (!gameLoader->loadCachedSnapshot(filename, model))
+      {
+        machine->startLoading();
+        gameLoader->loadTape(filename.c_str());
+      }
     }
     else
     {
@@ -132,6 +204,9 @@ void EmulatorScreen::pressKey(SpecKeys key)
   {
     if (renderer->isShowingMenu) {
       renderer->isShowingMenu = false;
+      isChoosingQuickSave = false;
+      isChoosingTapeOptions = false;
+      renderer->menuPrompt.clear();
       renderer->forceRedraw();
       machine->resume();
     } else {
@@ -158,7 +233,55 @@ void EmulatorScreen::pressKey(SpecKeys key)
         machine->stepForward();
         renderer->forceRedraw();
       }
+      // a frame at a time
+      if (key == SPECKEY_6) {
+        machine->timeTravelBy(-1);
+        renderer->forceRedraw();
+      }
+      if (key == SPECKEY_7) {
+        machine->timeTravelBy(1);
+        renderer->forceRedraw();
+      }
     }
+  } else if (renderer->isShowingMenu && isChoosingQuickSave)
+  {
+    // 1-4 save and 5-8 load - anything else goes back to the menu
+    const SpecKeys saveKeys[] = {SPECKEY_1, SPECKEY_2, SPECKEY_3, SPECKEY_4};
+    const SpecKeys loadKeys[] = {SPECKEY_5, SPECKEY_6, SPECKEY_7, SPECKEY_8};
+    isChoosingQuickSave = false;
+    renderer->menuPrompt.clear();
+    for (int slot = 0; slot < 4 && slot < QUICK_SAVE_SLOTS; slot++) {
+      if (key == saveKeys[slot] || key == loadKeys[slot]) {
+        renderer->isShowingMenu = false;
+        bool ok = key == saveKeys[slot] ? machine->quickSave(slot) : machine->quickLoad(slot);
+        if (ok) {
+          playSuccessBeep();
+        } else {
+          playErrorBeep();
+        }
+        renderer->forceRedraw();
+        machine->resume();
+        return;
+      }
+    }
+    renderer->forceRedraw();
+  } else if (renderer->isShowingMenu && isChoosingTapeOptions)
+  {
+    // each number changes a setting and anything else goes back to the menu
+    if (key == SPECKEY_1 || key == SPECKEY_2 || key == SPECKEY_3) {
+      if (key == SPECKEY_1) {
+        toggleFlashLoad();
+      } else if (key == SPECKEY_2) {
+        nextTapeSpeed();
+      } else {
+        toggleSnapshotCache();
+      }
+      renderer->menuPrompt = tapeOptionsPrompt();
+    } else {
+      isChoosingTapeOptions = false;
+      renderer->menuPrompt.clear();
+    }
+    renderer->forceRedraw();
   } else if (renderer->isShowingMenu) 
   {
     if (key == SPECKEY_1) {
@@ -171,6 +294,14 @@ void EmulatorScreen::pressKey(SpecKeys key)
       renderer->isShowingMenu = false;
       // show the save snapshot UI
       m_navigationStack->push(new SaveSnapshotScreen(m_tft, m_hdmiDisplay, m_audioOutput, machine->getMachine(), m_files));
+    } else if (key == SPECKEY_3) {
+      isChoosingQuickSave = true;
+      renderer->menuPrompt = "Quick Save 1-4  Load 5-8";
+      renderer->forceRedraw();
+    } else if (key == SPECKEY_4) {
+      isChoosingTapeOptions = true;
+      renderer->menuPrompt = tapeOptionsPrompt();
+      renderer->forceRedraw();
     } else if (key == SPECKEY_P) {
       renderer->isShowingMenu = false;
       m_navigationStack->push(new PokeScreen(m_tft, m_hdmiDisplay, m_audioOutput, machine->getMachine()));
@@ -191,10 +322,11 @@ void EmulatorScreen::pressKey(SpecKeys key)
 void EmulatorScreen::loadTape(std::string filename)
 {
   isLoading = true;
+  // the game asked for this tape so the end of it isn't somewhere we can start from
+  machine->setSnapshotCacheFile("");
   renderer->resume();
   renderer->setNeedsRedraw();
   gameLoader->loadTape(filename);
-  renderer->setIsLoading(false);
   renderer->setNeedsRedraw();
   machine->resume();
   isLoading = false;
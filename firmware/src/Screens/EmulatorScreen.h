@@ -12,6 +12,7 @@ class GameLoader;
 class Renderer;
 class IFiles;
 class HDMIDisplay;
+class ISettings;
 
 class EmulatorScreen : public Screen
 {
@@ -22,6 +23,16 @@ class EmulatorScreen : public Screen
     FILE *audioFile = nullptr;
     void triggerLoadTape();
     bool isLoading = false;
+    // the menu is asking which quick save to use
+    bool isChoosingQuickSave = false;
+    // the menu is showing the tape settings
+    bool isChoosingTapeOptions = false;
+    // the settings come with the audio output - there aren't any if there isn't one
+    ISettings *settings = nullptr;
+    std::string tapeOptionsPrompt();
+    void toggleFlashLoad();
+    void nextTapeSpeed();
+    void toggleSnapshotCache();
   public:
     EmulatorScreen(Display &tft, HDMIDisplay *hdmiDisplay, AudioOutput *audioOutput, IFiles *files);
     void updateKey(SpecKeys key, uint8_t state);
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <string>
+#include "../../Emulator/spectrum.h"
 
 class Machine;
 class AudioOutput;
 class Renderer;
+class IFiles;
 
 class GameLoader
 {
@@ -12,7 +14,32 @@ class GameLoader
     Machine *machine = nullptr;
     Renderer *renderer = nullptr;
     AudioOutput *audioOutput = nullptr;
+    IFiles *files = nullptr;
+    // copy standard speed blocks straight into memory when the ROM loader is used
+    bool flashLoad = true;
+    // how many frames to run for each real frame while the tape is playing - both of these come from the
+    // tape settings in the emulator menu
+    int tapeSpeed = 1;
+    // keep a snapshot of the machine once a tape has loaded so we don't have to load it again - turn
+    // this off for multi-load games where the end of the tape isn't the start of the game (the tape
+    // settings in the emulator menu)
+    bool snapshotCache = true;
+    // the snapshot for a tape is named after a hash of everything in it and the model it was loaded on
+    std::string cachedSnapshotName(uint64_t contentHash, models_enum model);
   public:
-    GameLoader(Machine *machine, Renderer *renderer, AudioOutput *audioOutput);
+    GameLoader(Machine *machine, Renderer *renderer, AudioOutput *audioOutput, IFiles *files);
+    void setFlashLoad(bool enabled) {
+      flashLoad = enabled;
+    }
+    void setTapeSpeed(int speed) {
+      tapeSpeed = speed;
+    }
+    void setSnapshotCache(bool enabled) {
+      snapshotCache = enabled;
+    }
+    // load the snapshot from the last time the tape was loaded - returns false if there isn't one, in
+    // which case a snapshot will be saved when the tape has finished loading
+    bool loadCachedSnapshot(std::string filename, models_enum model);
+    // put the tape in the machine's tape deck and start it playing
     void loadTape(std::string filename);
 };
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "./Machine.h"
 #include "./Renderer.h"
 #include "../../AudioOutput/AudioOutput.h"
+#include "../../Emulator/snaps.h"
+#include "../../Emulator/BootImage.h"
+#include "../../Emulator/SnapshotIndex.h"
 
 void runnerTask(void *pvParameter)
 {
@@ -8,13 +11,45 @@ void runnerTask(void *pvParameter)
   machine->runEmulator();
 }
 
+void quickSaveTask(void *pvParameter)
+{
+  Machine *machine = (Machine *)pvParameter;
+  machine->writeQuickSaves();
+}
+
 void Machine::runEmulator() {
   unsigned long lastTime = millis();
   while (1)
   {
     if (isRunning)
     {
+      unsigned long frameStart = micros();
+      TapeDeck &tapeDeck = machine->tapeDeck;
+      applyPendingKeys();
+      bool tapePlaying = tapeDeck.isPlaying();
+      if (tapePlaying)
+      {
+        // turbo loading - run the extra frames without any audio
+        for (int i = 1; i < tapeDeck.getSpeed(); i++)
+        {
+          cycleCount += machine->runForFrame(nullptr, nullptr);
+          timeTravel->endFrame(true);
+        }
+      }
       cycleCount += machine->runForFrame(audioOutput, audioFile);
+      timeTravel->endFrame(tapePlaying || tapeDeck.isPlaying());
+      renderer->setIsLoading(tapeDeck.isPlaying());
+      if (tapeDeck.isPlaying())
+      {
+        // the tape length is only an estimate when we stream it from the file so don't go past 100%
+        uint64_t length = tapeDeck.getLength();
+        uint64_t position = tapeDeck.getPosition();
+        renderer->setLoadProgress(length > 0 && position < length ? position * 100 / length : 100);
+      }
+      if (!snapshotCacheFile.empty() && tapeDeck.isFinished())
+      {
+        saveSnapshotCache();
+      }
       renderer->triggerDraw(machine->mem.currentScreen->data, machine->borderColors);
       unsigned long currentTime = millis();
       unsigned long elapsed = currentTime - lastTime;
@@ -30,10 +65,24 @@ void Machine::runEmulator() {
         timeTravel->record(machine);
         Serial.printf("Free heap: %d\n", ESP.getFreeHeap());
         Serial.printf("Free PSRAM: %d\n", ESP.getFreePsram());
+        if (frameTimes.frames >= 500)
+        {
+          frameTimes.print("Emulator");
+          frameTimes.reset();
+        }
       }
-      if (machine->romLoadingRoutineHit)
+      frameTimes.add(micros() - frameStart);
+      if (machine->romLoadingRoutineHit && !tapeDeck.isPlaying())
       {
-        romLoadingRoutineHitCallback();
+        if (tapeDeck.hasTape() && !tapeDeck.isFinished())
+        {
+          // the tape was stopped part way through - carry on now the loader wants it again
+          tapeDeck.play();
+        }
+        else
+        {
+          romLoadingRoutineHitCallback();
+        }
       }
     }
     else
@@ -44,19 +93,57 @@ void Machine::runEmulator() {
 }
 
 
+void Machine::saveSnapshotCache()
+{
+  // write to a temporary file first so we never pick up half a snapshot
+  std::string tempFile = snapshotCacheFile + ".tmp";
+  Z80FileWriter writer(machine, tempFile.c_str());
+  if (writer.saveZ80() && rename(tempFile.c_str(), snapshotCacheFile.c_str()) == 0)
+  {
+    Serial.printf("Saved snapshot to %s\n", snapshotCacheFile.c_str());
+    if (!snapshotCacheTape.empty())
+    {
+      SnapshotIndex::update(snapshotCacheTape, machine, snapshotCacheHash);
+    }
+  }
+  else
+  {
+    Serial.printf("Failed to save snapshot to %s\n", snapshotCacheFile.c_str());
+    remove(tempFile.c_str());
+  }
+  snapshotCacheFile.clear();
+  snapshotCacheTape.clear();
+  snapshotCacheHash = 0;
+}
+
 Machine::Machine(Renderer *renderer, AudioOutput *audioOutput, std::function<void()> romLoadingRoutineHitCallback)
 : renderer(renderer), audioOutput(audioOutput), romLoadingRoutineHitCallback(romLoadingRoutineHitCallback) {
   Serial.println("Creating machine");
   machine = new ZXSpectrum();
   timeTravel = new TimeTravel();
+  pendingKeysLock = xSemaphoreCreateMutex();
+  quickSaves = new QuickSaves();
+  quickSavesLock = xSemaphoreCreateMutex();
 }
 
 void Machine::updateKey(SpecKeys key, uint8_t state) {
   if (isRunning) {
-    machine->updateKey(key, state);
+    xSemaphoreTake(pendingKeysLock, portMAX_DELAY);
+    pendingKeys.push_back({key, state});
+    xSemaphoreGive(pendingKeysLock);
   }
 }
 
+void Machine::applyPendingKeys() {
+  xSemaphoreTake(pendingKeysLock, portMAX_DELAY);
+  for (auto &pendingKey : pendingKeys) {
+    machine->updateKey(pendingKey.first, pendingKey.second);
+    timeTravel->keyChanged(pendingKey.first, pendingKey.second);
+  }
+  pendingKeys.clear();
+  xSemaphoreGive(pendingKeysLock);
+}
+
 void Machine::setup(models_enum model) {
   Serial.println("Setting up machine");
   machine->reset();
@@ -69,6 +156,66 @@ void Machine::start(FILE *audioFile) {
   this->audioFile = audioFile;
   isRunning = true;
   xTaskCreatePinnedToCore(runnerTask, "z80Runner", 8192, this, 5, NULL, 0);
+  // writing the quick saves can take as long as it likes
+  xTaskCreatePinnedToCore(quickSaveTask, "quickSaves", 8192, this, 1, NULL, 1);
+}
+
+void Machine::setQuickSaveFilename(const std::string &gameFilename)
+{
+  xSemaphoreTake(quickSavesLock, portMAX_DELAY);
+  quickSaves->setFilename(gameFilename);
+  xSemaphoreGive(quickSavesLock);
+}
+
+bool Machine::quickSave(int slot)
+{
+  xSemaphoreTake(quickSavesLock, portMAX_DELAY);
+  unsigned long start = micros();
+  bool saved = quickSaves->save(machine, slot);
+  unsigned long elapsed = micros() - start;
+  xSemaphoreGive(quickSavesLock);
+  Serial.printf("Quick save %d %s in %luus\n", slot + 1, saved ? "saved" : "failed", elapsed);
+  return saved;
+}
+
+bool Machine::quickLoad(int slot)
+{
+  xSemaphoreTake(quickSavesLock, portMAX_DELAY);
+  unsigned long start = micros();
+  bool loaded = quickSaves->restore(machine, slot);
+  unsigned long elapsed = micros() - start;
+  xSemaphoreGive(quickSavesLock);
+  Serial.printf("Quick save %d %s in %luus\n", slot + 1, loaded ? "restored" : "failed", elapsed);
+  if (loaded)
+  {
+    renderer->forceRedraw(machine->mem.currentScreen->data, machine->borderColors);
+  }
+  return loaded;
+}
+
+void Machine::writeQuickSaves()
+{
+  while (1)
+  {
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    for (int slot = 0; slot < QUICK_SAVE_SLOTS; slot++)
+    {
+      // take a copy so the slot can be saved to again while we're writing it
+      size_t length = 0;
+      xSemaphoreTake(quickSavesLock, portMAX_DELAY);
+      uint8_t *state = quickSaves->takeUnwritten(slot, &length);
+      std::string filename = quickSaves->fileName(slot);
+      xSemaphoreGive(quickSavesLock);
+      if (state)
+      {
+        unsigned long start = millis();
+        bool written = QuickSaves::writeFile(filename, state, length);
+        free(state);
+        Serial.printf("Quick save %d %s %s in %lums\n", slot + 1, written ? "written to" : "failed to write",
+                      filename.c_str(), millis() - start);
+      }
+    }
+  }
 }
 
 void Machine::tapKey(SpecKeys key)
@@ -88,25 +235,7 @@ void Machine::tapKey(SpecKeys key)
 
 void Machine::startLoading()
 {
-  for (int i = 0; i < 200; i++)
-  {
-    machine->runForFrame(nullptr, nullptr);
-  }
-  renderer->triggerDraw(machine->mem.currentScreen->data, machine->borderColors);
-  // TODO load screenshot...
-  if (machine->hwopt.hw_model == SPECMDL_48K)
-  {
-    tapKey(SPECKEY_J);
-    machine->updateKey(SPECKEY_SYMB, 1);
-    tapKey(SPECKEY_P);
-    tapKey(SPECKEY_P);
-    machine->updateKey(SPECKEY_SYMB, 0);
-    tapKey(SPECKEY_ENTER);
-  }
-  else
-  {
-    // 128K the tape loader is first in the menu
-    tapKey(SPECKEY_ENTER);
-  }
+  // the boot image is already sitting at the tape loader so there's no need to boot the ROM
+  readyToLoad(machine);
   renderer->triggerDraw(machine->mem.currentScreen->data, machine->borderColors);
 }
\ No newline at end of file
@@ -5,143 +5,23 @@
 #include <list>
 #include <vector>
 #include <deque>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "Renderer.h"
 #include "../../Emulator/spectrum.h"
+#include "../../Emulator/TimeTravel.h"
+#include "../../Emulator/FrameTimes.h"
+#include "../../Emulator/QuickSaves.h"
 #include "../../Serial.h"
 
 void runnerTask(void *pvParameter);
+void quickSaveTask(void *pvParameter);
 
 class Renderer;
 class ZXSpectrum;
 class AudioOutput;
 
-// handles the time travel functionality - this captures the state of the machine at a point in time
-struct MemoryBank {
-  // the index
-  uint8_t index = 0;
-  // the memory bank
-  uint8_t *data = nullptr;
-};
-
-struct TimeTravelInstant {
-  // the current memory pages
-  uint8_t hwBank = 0;
-  // the memory banks
-  std::vector<MemoryBank *> memoryBanks;
-  // the z80 registers
-  Z80Regs z80Regs;
-  // the border colors
-  uint8_t borderColors[312] = {0};
-};
-
-class TimeTravel {
-private:
-  // list of time travel instants that have been recorded
-  std::deque<TimeTravelInstant *> timeTravelInstants;
-  // pool of memory banks that we can reuse
-  std::list<MemoryBank *> memoryBanks;
-  bool ensureMemoryBanks(size_t required) {
-    while(memoryBanks.size() < required && timeTravelInstants.size() > 0) {
-      TimeTravelInstant *oldestInstant = timeTravelInstants.front();
-      timeTravelInstants.pop_front();
-      for (MemoryBank *memoryBank : oldestInstant->memoryBanks) {
-        memoryBanks.push_back(memoryBank);
-      }
-      delete oldestInstant;
-    }
-    return memoryBanks.size() >= required;
-  }
-public:
-  TimeTravel() {
-    // allocate some memory banks
-    for (int i = 0; i < 240; i++) {
-      MemoryBank *memoryBank = new MemoryBank();
-      if (!memoryBank) {
-        Serial.println("Could not allocate memory bank");
-        return;
-      }
-      memoryBank->data = (uint8_t *) ps_malloc(0x4000);
-      if (!memoryBank->data) {
-        Serial.println("Could not allocate memory bank data");
-        return;
-      }
-      memoryBanks.push_back(memoryBank);
-    }
-  }
-  size_t size() {
-    return timeTravelInstants.size();
-  }
-  // record the current state of the machine
-  bool record(ZXSpectrum *machine) {
-    // how many memory banks do we need?
-    int memoryBankCount = 0;
-    for(int i = 0; i<8; i++) {
-      if (machine->mem.banks[i]->isDirty) {
-        memoryBankCount++;
-      }
-    }
-    ensureMemoryBanks(memoryBankCount);
-    Serial.printf("Saving %d memory banks\n", memoryBankCount);
-    // create a new time travel instant
-    TimeTravelInstant *instant = new TimeTravelInstant();
-    // copy the memory banks
-    for(int i = 0; i<8; i++) {
-      if (machine->mem.banks[i]->isDirty) {
-        MemoryBank *memoryBank = memoryBanks.front();
-        memoryBanks.pop_front();
-        memoryBank->index = i;
-        memcpy(memoryBank->data, machine->mem.banks[i]->data, 0x4000);
-        machine->mem.banks[i]->isDirty = false;
-        instant->memoryBanks.push_back(memoryBank);
-      }
-    }
-    // copy the z80 registers
-    memcpy(&instant->z80Regs, machine->z80Regs, sizeof(Z80Regs));
-    // copy the border colors
-    memcpy(instant->borderColors, machine->borderColors, 312);
-    // make sure the correct paging is set
-    instant->hwBank = machine->mem.hwBank;
-    // add the instant to the list
-    timeTravelInstants.push_back(instant);
-    // if we have more than 30 seconds of time travel, remove the oldest instant
-    if (timeTravelInstants.size() > 30) {
-      TimeTravelInstant *oldestInstant = timeTravelInstants.front();
-      timeTravelInstants.pop_front();
-      for (MemoryBank *memoryBank : oldestInstant->memoryBanks) {
-        memoryBanks.push_back(memoryBank);
-      }
-      delete oldestInstant;
-    }
-    Serial.printf("Recorded time travel instant %d\n", timeTravelInstants.size());
-    return true;
-  }
-  // rewind the machine to a previous state
-  void rewind(ZXSpectrum *machine, int index) {
-    TimeTravelInstant *instant = timeTravelInstants[index];
-    // copy the memory banks
-    for (MemoryBank *memoryBank : instant->memoryBanks) {
-      memcpy(machine->mem.banks[memoryBank->index]->data, memoryBank->data, 0x4000);
-    }
-    // copy the z80 registers
-    memcpy(machine->z80Regs, &instant->z80Regs, sizeof(Z80Regs));
-    // copy the border colors
-    memcpy(machine->borderColors, instant->borderColors, 312);
-    // make sure the correct paging is set
-    machine->mem.page(instant->hwBank, true);
-  }
-  // remove everything from this point in time
-  void reset(int index) {
-    while(timeTravelInstants.size() > index) {
-      TimeTravelInstant *instant = timeTravelInstants.back();
-      timeTravelInstants.pop_back();
-      for (MemoryBank *memoryBank : instant->memoryBanks) {
-        memoryBanks.push_back(memoryBank);
-      }
-      delete instant;
-    }
-  }
-};
-
 class Machine {
   private:
     // the actual machine
@@ -159,12 +39,30 @@ class Machine {
     FILE *audioFile = nullptr;
     // keeps track of how many tstates we've run
     uint32_t cycleCount = 0;
+    // how long each frame takes - printed every 10 seconds or so
+    FrameTimes frameTimes;
     // time travel
     TimeTravel *timeTravel;
-    // current time travel position
-    int timeTravelPosition = 0;
+    // the frame we've travelled to
+    uint32_t timeTravelFrame = 0;
+    // keys wait here until the start of the next frame so time travel can replay them exactly
+    std::vector<std::pair<SpecKeys, uint8_t>> pendingKeys;
+    SemaphoreHandle_t pendingKeysLock;
+    void applyPendingKeys();
+    // quick saves are kept in memory and written to their files in the background
+    QuickSaves *quickSaves;
+    SemaphoreHandle_t quickSavesLock;
+    friend void quickSaveTask(void *pvParameter);
+    void writeQuickSaves();
     // callback for when rom loading routine is hit
     std::function<void()> romLoadingRoutineHitCallback;
+    // where to save a snapshot once the tape has finished - empty if we don't want one
+    std::string snapshotCacheFile;
+    // the tape it's for - it goes in the index of the tape's folder so the picker can show it, along with the
+    // hash of the tape so it doesn't have to be hashed again
+    std::string snapshotCacheTape;
+    uint64_t snapshotCacheHash = 0;
+    void saveSnapshotCache();
   public:
     Machine(Renderer *renderer, AudioOutput *audioOutput, std::function<void()> romLoadingRoutineHitCallback);
     void updateKey(SpecKeys key, uint8_t state);
@@ -174,36 +72,51 @@ class Machine {
       isRunning = false;
     }
     void resume() {
+      // whatever happened while we were paused can't be replayed from the key journal
+      timeTravel->record(machine);
       isRunning = true;
     }
     void startTimeTravel() {
       // record the current state
       timeTravel->record(machine);
-      timeTravelPosition = timeTravel->size() - 1;
-      Serial.printf("Starting time travel %d\n", timeTravelPosition);
+      timeTravelFrame = timeTravel->currentFrame();
+      Serial.printf("Starting time travel %d\n", timeTravelFrame);
     }
-    void stepBack() {
-      if (timeTravelPosition > 0) {
-        timeTravelPosition--;
-        timeTravel->rewind(machine, timeTravelPosition);
+    // move through time a number of frames - there are 50 in a second
+    void timeTravelBy(int frames) {
+      int64_t wanted = (int64_t) timeTravelFrame + frames;
+      wanted = std::max<int64_t>(wanted, timeTravel->firstFrame());
+      wanted = std::min<int64_t>(wanted, timeTravel->currentFrame());
+      // this can end up somewhere else if a tape was loading
+      uint32_t target = wanted;
+      if (target != timeTravelFrame && timeTravel->rewindToFrame(machine, target)) {
+        timeTravelFrame = target;
         renderer->forceRedraw(machine->mem.currentScreen->data, machine->borderColors);
-        Serial.printf("Time travel %d\n", timeTravelPosition);
+        Serial.printf("Time travel %d\n", timeTravelFrame);
       }
     }
+    void stepBack() {
+      timeTravelBy(-50);
+    }
     void stepForward() {
-      if (timeTravelPosition < timeTravel->size() - 1) {
-        timeTravelPosition++;
-        timeTravel->rewind(machine, timeTravelPosition);
-        renderer->forceRedraw(machine->mem.currentScreen->data, machine->borderColors);
-        Serial.printf("Time travel %d\n", timeTravelPosition);
-      }
+      timeTravelBy(50);
     }
     void stopTimeTravel() {
-      timeTravel->reset(timeTravelPosition);
+      timeTravel->resumeFrom(timeTravelFrame);
     }
     ZXSpectrum *getMachine() {
       return machine;
     }
     void tapKey(SpecKeys key);
     void startLoading();
+    void setSnapshotCacheFile(const std::string &filename, const std::string &tapeFilename = "", uint64_t tapeHash = 0) {
+      snapshotCacheFile = filename;
+      snapshotCacheTape = tapeFilename;
+      snapshotCacheHash = tapeHash;
+    }
+    // quick saves for a game - any that were saved last time are loaded
+    void setQuickSaveFilename(const std::string &gameFilename);
+    // only while we're paused
+    bool quickSave(int slot);
+    bool quickLoad(int slot);
 };
\ No newline at end of file
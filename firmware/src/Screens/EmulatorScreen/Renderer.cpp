@@ -219,18 +219,18 @@ void Renderer::drawTimeTravel() {
     m_tft.loadFont(GillSans_15_vlw);
     m_tft.setTextColor(TFT_WHITE, TFT_BLACK);
     
-    // Draw the left control "<5"
-    m_tft.drawString("<5", 5, 0);
+    // Draw the left controls "<5 <6" - a second and a frame
+    m_tft.drawString("<5 <6", 5, 0);
     
     // Draw the center text "Time Travel - Enter=Jump"
     Point centerSize = m_tft.measureString("Time Travel - Enter=Jump");
     int centerX = (m_tft.width() - centerSize.x) / 2;
     m_tft.drawString("Time Travel - Enter=Jump", centerX, 0);
     
-    // Draw the right control "8>"
-    Point rightSize = m_tft.measureString("8>");
+    // Draw the right controls "7> 8>"
+    Point rightSize = m_tft.measureString("7> 8>");
     int rightX = m_tft.width() - rightSize.x - 5;  // 5 pixels from right edge
-    m_tft.drawString("8>", rightX, 0);
+    m_tft.drawString("7> 8>", rightX, 0);
 }
 
 void Renderer::drawMenu() {
@@ -239,9 +239,10 @@ void Renderer::drawMenu() {
     m_tft.loadFont(GillSans_15_vlw);
     m_tft.setTextColor(TFT_WHITE, TFT_BLACK);
     
-    Point menuSize = m_tft.measureString("1-Time Travel  2-Snapshot  ENTER-Resume");
+    const char *menuText = menuPrompt.empty() ? "1-Travel  2-Snapshot  3-Quick  4-Tape  ENTER-Resume" : menuPrompt.c_str();
+    Point menuSize = m_tft.measureString(menuText);
     int centerX = (m_tft.width() - menuSize.x) / 2;
-    m_tft.drawString("1-Time Travel  2-Snapshot  ENTER-Resume", centerX, 0);
+    m_tft.drawString(menuText, centerX, 0);
 
     // Draw the volume control
     const char *volumeText = "<5       Volume       8>";
@@ -1,6 +1,7 @@
 #pragma once
 #include <freertos/FreeRTOS.h>
 #include <string.h>
+#include <string>
 #include "../../TFT/Display.h"
 #include "../../Serial.h"
 
@@ -125,4 +126,6 @@ public:
     }
     bool isShowingMenu = false;
     bool isShowingTimeTravel = false;
+    // shown in the menu bar instead of the menu when we need to ask something
+    std::string menuPrompt;
 };
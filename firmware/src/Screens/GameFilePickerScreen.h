@@ -3,9 +3,33 @@
 #include "PickerScreen.h"
 #include "../Files/Files.h"
 #include "EmulatorScreen.h"
+#include "../Emulator/SnapshotIndex.h"
+#include "../Emulator/ModelDetection.h"
 
 class GameFilePickerScreen : public PickerScreen<FileInfoPtr>
 {
+  private:
+      // the index of the folder we're showing - we only read the thumbnails from it, never the games
+      SnapshotIndex snapshotIndex;
+      uint8_t thumbnail[SnapshotIndex::THUMBNAIL_SIZE];
+      uint16_t thumbnailLine[SnapshotIndex::THUMBNAIL_WIDTH * 2];
+      const SnapshotIndex::Entry *findInIndex(FileInfoPtr item) {
+        std::string path = item->getPath();
+        std::string folder = path.substr(0, path.find_last_of('/'));
+        if (snapshotIndex.getFolder() != folder) {
+          snapshotIndex.open(folder);
+        }
+        return snapshotIndex.find(item->getName());
+      }
+      // the index remembers the model a game was run on - otherwise we work it out from the file
+      models_enum modelFor(FileInfoPtr item) {
+        const SnapshotIndex::Entry *entry = findInIndex(item);
+        if (entry && (entry->model == SPECMDL_48K || entry->model == SPECMDL_128K)) {
+          return (models_enum) entry->model;
+        }
+        models_enum model = detectModel(item->getPath().c_str());
+        return model == SPECMDL_128K ? SPECMDL_128K : SPECMDL_48K;
+      }
   public:
       GameFilePickerScreen(Display &tft, HDMIDisplay *hdmiDisplay, AudioOutput *audioOutput, IFiles *files)
       : PickerScreen("Games", tft, hdmiDisplay, audioOutput, files) {}
@@ -31,16 +55,53 @@ class GameFilePickerScreen : public PickerScreen<FileInfoPtr>
           emulatorScreen->loadTape(item->getPath());
           return;
         }
-        Serial.println("Starting new emulator screen");
         drawBusy();
+        models_enum model = modelFor(item);
+        snapshotIndex.close();
+        Serial.printf("Starting new emulator screen as a %s\n", model == SPECMDL_128K ? "128K" : "48K");
         emulatorScreen = new EmulatorScreen(m_tft, m_hdmiDisplay, m_audioOutput, m_files);
-        // TODO - we should pick the machine to run on - 48k or 128k
-        // there's no way to know from the file name or the file contents
-        emulatorScreen->run(item->getPath(), models_enum::SPECMDL_48K);
+        emulatorScreen->run(item->getPath(), model);
         m_navigationStack->push(emulatorScreen);
       }
       void onBack() {
         m_navigationStack->pop();
       }
+      // the emulator and the snapshot screen replace the index while we're away so read it again when we're back
+      void didAppear() {
+        snapshotIndex.close();
+        PickerScreen::didAppear();
+      }
+      void willDisappear() {
+        snapshotIndex.close();
+      }
+      void drawSelectedItem(FileInfoPtr item) {
+        // the thumbnail is drawn at twice the size in the top right corner with the model and size under it
+        const int width = SnapshotIndex::THUMBNAIL_WIDTH * 2;
+        const int height = SnapshotIndex::THUMBNAIL_HEIGHT * 2;
+        int x = m_tft.width() - width - 5;
+        int y = 25;
+        const SnapshotIndex::Entry *entry = findInIndex(item);
+        m_tft.fillRect(x, y + height, width, 20, TFT_BLACK);
+        if (!entry || !snapshotIndex.readThumbnail(entry, thumbnail)) {
+          m_tft.fillRect(x, y, width, height, TFT_BLACK);
+          return;
+        }
+        m_tft.setWindow(x, y, x + width - 1, y + height - 1);
+        for (int ty = 0; ty < SnapshotIndex::THUMBNAIL_HEIGHT; ty++) {
+          for (int tx = 0; tx < SnapshotIndex::THUMBNAIL_WIDTH; tx++) {
+            uint8_t pixels = thumbnail[(ty * SnapshotIndex::THUMBNAIL_WIDTH + tx) / 2];
+            uint16_t color = specpal565[tx & 1 ? pixels & 0x0F : pixels >> 4];
+            thumbnailLine[tx * 2] = color;
+            thumbnailLine[tx * 2 + 1] = color;
+          }
+          m_tft.pushPixels(thumbnailLine, width);
+          m_tft.pushPixels(thumbnailLine, width);
+        }
+        char info[40];
+        snprintf(info, sizeof(info), "%s  %dK", entry->model == SPECMDL_128K ? "128K" : "48K", (int)((entry->fileSize + 1023) / 1024));
+        m_tft.loadFont(GillSans_15_vlw);
+        m_tft.setTextColor(TFT_WHITE, TFT_BLACK);
+        m_tft.drawString(info, x, y + height + 2);
+      }
 };
 
@@ -55,6 +55,8 @@ public:
     m_navigationStack->pop();
   }
   virtual void onItemSelect(ItemT item, int index) = 0;
+  // anything else to show for the selected item
+  virtual void drawSelectedItem(ItemT item) {}
 
   void pressKey(SpecKeys key)
   {
@@ -146,6 +148,10 @@ public:
       m_tft.setTextColor(itemIndex == m_selectedItem ? TFT_GREEN : TFT_WHITE, TFT_BLACK);
       m_tft.drawString(m_items[itemIndex]->getTitle().c_str(), 5, 10 + 15 + i * 25);
     }
+    if (m_selectedItem < m_items.size())
+    {
+      drawSelectedItem(m_items[m_selectedItem]);
+    }
     // draw the spectrum flash
     m_tft.setWindow(m_tft.width() - rainbowImageWidth, m_tft.height() - rainbowImageHeight, m_tft.width() - 1, m_tft.height() - 1);
     m_tft.pushPixels((uint16_t *) rainbowImageData, rainbowImageWidth * rainbowImageHeight);
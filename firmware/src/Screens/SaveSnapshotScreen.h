@@ -6,6 +6,7 @@
 #include "fonts/GillSans_15_vlw.h"
 #include "../Emulator/spectrum.h"
 #include "../Emulator/snaps.h"
+#include "../Emulator/SnapshotIndex.h"
 
 class IFiles;
 
@@ -40,7 +41,9 @@ public:
         drawBusy();
         std::string fname = m_files->getPath("/snapshots") + "/" + filename + ".Z80";
         Z80FileWriter writer(machine, fname.c_str());
-        writer.saveZ80();
+        if (writer.saveZ80()) {
+          SnapshotIndex::update(fname, machine);
+        }
         playSuccessBeep();
         vTaskDelay(500 / portTICK_PERIOD_MS);
         m_navigationStack->pop();
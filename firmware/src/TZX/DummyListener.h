@@ -20,6 +20,14 @@ class DummyListener: public TapeListener {
     void pause1Millis() {
       addTicks(MILLI_SECOND);
     }
+    // we only need to know how long the pulses are
+    void playPulses(const uint32_t *pulses, int count) {
+      uint64_t ticks = 0;
+      for (int i = 0; i < count; i++) {
+        ticks += PULSE_TICKS(pulses[i]);
+      }
+      addTicks(ticks);
+    }
   void finish() {
   }
 };
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include "LoaderAccelerator.h"
+#include "../Emulator/spectrum.h"
+
+// the longest loop we'll look at either side of the IN
+#define MAX_LOOP_BYTES 24
+
+uint8_t *LoaderAccelerator::registerFor(uint8_t index)
+{
+  Z80Regs *regs = spectrum->z80Regs;
+  switch (index)
+  {
+  case 0:
+    return &regs->BC.B.h;
+  case 1:
+    return &regs->BC.B.l;
+  case 2:
+    return &regs->DE.B.h;
+  case 3:
+    return &regs->DE.B.l;
+  case 4:
+    return &regs->HL.B.h;
+  case 5:
+    return &regs->HL.B.l;
+  default:
+    return nullptr;
+  }
+}
+
+int LoaderAccelerator::decode(uint16_t address, uint16_t inAddress, bool beforeIn, bool afterCounter, LoaderLoop &loop, bool &loopsBack)
+{
+  uint8_t opcode = spectrum->z80_peek(address);
+  loopsBack = false;
+  loop.instructions++;
+  if (opcode == 0x00)
+  {
+    loop.tstates += 4;
+    return 1;
+  }
+  // RRA, RLA, RRCA, RLCA and CPL only touch A and F
+  if (!beforeIn && (opcode == 0x1F || opcode == 0x17 || opcode == 0x0F || opcode == 0x07 || opcode == 0x2F))
+  {
+    loop.tstates += 4;
+    return 1;
+  }
+  // AND n, XOR n, OR n, CP n
+  if (!beforeIn && (opcode == 0xE6 || opcode == 0xEE || opcode == 0xF6 || opcode == 0xFE))
+  {
+    loop.tstates += 7;
+    return 2;
+  }
+  // AND r, XOR r, OR r, CP r - but not (HL) as memory might change
+  if (!beforeIn && opcode >= 0xA0 && opcode <= 0xBF && (opcode & 0x07) != 6)
+  {
+    loop.tstates += 4;
+    return 1;
+  }
+  // LD A,n sets up the port to read
+  if (beforeIn && opcode == 0x3E)
+  {
+    loop.tstates += 7;
+    return 2;
+  }
+  // INC r or DEC r counts how long we've waited for an edge
+  if (beforeIn && (opcode & 0xC6) == 0x04 && registerFor((opcode >> 3) & 0x07) && !loop.counter)
+  {
+    loop.counter = registerFor((opcode >> 3) & 0x07);
+    loop.counterIncrements = (opcode & 0x01) == 0;
+    loop.tstates += 4;
+    return 1;
+  }
+  // conditional exits are fine as long as they aren't taken - after the counter they can only be checking
+  // for it reaching zero
+  int condition = -1;
+  int length = 0;
+  int target = 0;
+  if ((opcode & 0xC7) == 0xC0)
+  {
+    // RET cc
+    condition = (opcode >> 3) & 0x07;
+    length = 1;
+    target = -1;
+  }
+  else if (opcode == 0x18 || (opcode & 0xE7) == 0x20)
+  {
+    // JR e and JR cc,e
+    condition = opcode == 0x18 ? 8 : (opcode >> 3) & 0x03;
+    length = 2;
+    target = (uint16_t)(address + 2 + (int8_t)spectrum->z80_peek(address + 1));
+  }
+  else if ((opcode & 0xC7) == 0xC2)
+  {
+    // JP cc,nn
+    condition = (opcode >> 3) & 0x07;
+    length = 3;
+    target = spectrum->z80_peek(address + 1) | (spectrum->z80_peek(address + 2) << 8);
+  }
+  else
+  {
+    return 0;
+  }
+  if (!beforeIn && target >= 0 && target <= inAddress && inAddress - target <= MAX_LOOP_BYTES)
+  {
+    // back to the start of the loop
+    loopsBack = true;
+    loop.tstates += length == 2 ? 12 : 10;
+    return length;
+  }
+  if (condition == 8 || (target >= 0 && target > address - MAX_LOOP_BYTES && target <= address))
+  {
+    // anything else that jumps backwards isn't a simple loop
+    return 0;
+  }
+  if (afterCounter)
+  {
+    if (condition != 1)
+    {
+      return 0;
+    }
+    loop.counterExits = true;
+  }
+  loop.tstates += length == 1 ? 5 : length == 2 ? 7 : 10;
+  return length;
+}
+
+bool LoaderAccelerator::analyse(uint16_t inAddress, LoaderLoop &loop)
+{
+  if (spectrum->z80_peek(inAddress) != 0xDB)
+  {
+    return false;
+  }
+  loop.tstates = 11;
+  loop.instructions = 1;
+  // follow the code after the IN round to the jump back to the start of the loop
+  uint16_t address = inAddress + 2;
+  uint16_t loopStart = 0;
+  bool loopsBack = false;
+  // the registers that the code after the IN reads
+  uint8_t readRegisters = 0;
+  while (!loopsBack)
+  {
+    if (address - inAddress > MAX_LOOP_BYTES)
+    {
+      return false;
+    }
+    uint8_t opcode = spectrum->z80_peek(address);
+    if (opcode >= 0xA0 && opcode <= 0xBF)
+    {
+      readRegisters |= 1 << (opcode & 0x07);
+    }
+    int length = decode(address, inAddress, false, false, loop, loopsBack);
+    if (length == 0)
+    {
+      return false;
+    }
+    if (loopsBack)
+    {
+      loopStart = spectrum->z80_peek(address) == 0x18 || (spectrum->z80_peek(address) & 0xE7) == 0x20
+                      ? address + 2 + (int8_t)spectrum->z80_peek(address + 1)
+                      : spectrum->z80_peek(address + 1) | (spectrum->z80_peek(address + 2) << 8);
+    }
+    address += length;
+  }
+  // now the code from the start of the loop up to the IN
+  address = loopStart;
+  while (address != inAddress)
+  {
+    if (address > inAddress)
+    {
+      return false;
+    }
+    bool afterCounter = loop.counter != nullptr;
+    int length = decode(address, inAddress, true, afterCounter, loop, loopsBack);
+    if (length == 0)
+    {
+      return false;
+    }
+    address += length;
+  }
+  // the code after the IN must give the same answer every time round
+  if (loop.counter)
+  {
+    for (int i = 0; i < 6; i++)
+    {
+      if ((readRegisters & (1 << i)) && registerFor(i) == loop.counter)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool LoaderAccelerator::skip(uint16_t pc, int tstate, uint8_t value, int nextEdge)
+{
+  bool sameRead = haveLastRead && pc == lastPC && value == lastValue;
+  int elapsed = tstate - lastTState;
+  haveLastRead = true;
+  lastPC = pc;
+  lastTState = tstate;
+  lastValue = value;
+  if (!sameRead || nextEdge <= tstate)
+  {
+    return false;
+  }
+  // we must have come straight round the loop since the last read for it to be waiting on the edge
+  if (!haveLoop || pc != loopPC)
+  {
+    // the same IN tends to be read over and over so remember what we found out about it last time
+    loopPC = pc;
+    haveLoop = true;
+    loop = LoaderLoop();
+    loopValid = analyse(pc - 1, loop);
+  }
+  if (!loopValid || elapsed != loop.tstates)
+  {
+    return false;
+  }
+  // the trip round the loop that will see the edge - don't go past the end of the frame
+  int trips = (nextEdge - tstate + loop.tstates - 1) / loop.tstates;
+  int frameTrips = (FRAME_TSTATES - 1 - tstate) / loop.tstates;
+  if (trips > frameTrips)
+  {
+    trips = frameTrips;
+  }
+  if (loop.counter && loop.counterExits)
+  {
+    // stop before the counter runs out so the loop can time out by itself
+    int counterTrips = loop.counterIncrements ? 255 - *loop.counter : (*loop.counter - 1) & 0xFF;
+    if (trips > counterTrips)
+    {
+      trips = counterTrips;
+    }
+  }
+  if (trips <= 0)
+  {
+    return false;
+  }
+  Z80Regs *regs = spectrum->z80Regs;
+  if (loop.counter)
+  {
+    // the counter was the last thing to set the flags before the IN
+    uint8_t before = *loop.counter + (loop.counterIncrements ? trips - 1 : 1 - trips);
+    uint8_t after = loop.counterIncrements ? before + 1 : before - 1;
+    uint8_t flags = regs->AF.B.l & C_FLAG;
+    if (loop.counterIncrements)
+    {
+      flags |= (after == 0x80 ? O_FLAG : 0) | ((after & 0x0F) ? 0 : H_FLAG);
+    }
+    else
+    {
+      flags |= ((before & 0x0F) ? 0 : H_FLAG) | N_FLAG | (after == 0x7F ? O_FLAG : 0);
+    }
+    flags |= (after ? 0 : Z_FLAG) | sz53_table[after];
+    *loop.counter = after;
+    regs->AF.B.l = flags;
+  }
+  regs->R.W = (regs->R.W & 0x80) | ((regs->R.W + trips * loop.instructions) & 0x7F);
+  regs->cycles -= trips * loop.tstates;
+  skippedTStates += trips * loop.tstates;
+  // the read will be different now so start again
+  haveLastRead = false;
+  return true;
+}
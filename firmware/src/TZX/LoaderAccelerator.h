@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+class ZXSpectrum;
+
+// What we know about a tape loader's edge detection loop
+struct LoaderLoop
+{
+  // T-states and R register increments for one trip round the loop
+  int tstates = 0;
+  int instructions = 0;
+  // the register that counts how long we've been waiting for an edge - nullptr if there isn't one
+  uint8_t *counter = nullptr;
+  bool counterIncrements = false;
+  // the loop gives up when the counter reaches zero
+  bool counterExits = false;
+};
+
+// Speeds up tape loaders by skipping over the loops that sit waiting for the next edge.
+//
+// Loaders wait for an edge with a tight loop round an IN A,(FE) - the ROM's LD-SAMPLE looks like this:
+//
+//   INC B / RET Z / LD A,7F / IN A,(FE) / RRA / RET NC / XOR C / AND 20 / JR Z,LD-SAMPLE
+//
+// When the same IN comes round again one loop later and reads the same value we know the loop will keep
+// going until the EAR level changes. If the loop only touches A, F and its counter we can move time on
+// to the trip round the loop that sees the next edge and update the counter, flags and R register just
+// as running the loop would have done.
+class LoaderAccelerator
+{
+private:
+  ZXSpectrum *spectrum;
+  // the last EAR read - where it was, when it was and what it read
+  bool haveLastRead = false;
+  uint16_t lastPC = 0;
+  int lastTState = 0;
+  uint8_t lastValue = 0;
+  // the last IN we looked at and the loop round it - a loader that rewrites its loop will no longer
+  // match the timing so we don't need to check the code every time
+  bool haveLoop = false;
+  uint16_t loopPC = 0;
+  bool loopValid = false;
+  LoaderLoop loop;
+  // how many T-states we've skipped
+  uint64_t skippedTStates = 0;
+  // work out what the loop round the IN A,(FE) at inAddress does - returns false if it's not one we can skip
+  bool analyse(uint16_t inAddress, LoaderLoop &loop);
+  // decode the instruction at address - returns its length or 0 if it's not allowed in a loader loop
+  int decode(uint16_t address, uint16_t inAddress, bool beforeIn, bool afterCounter, LoaderLoop &loop, bool &loopsBack);
+  uint8_t *registerFor(uint8_t index);
+
+public:
+  LoaderAccelerator(ZXSpectrum *spectrum) : spectrum(spectrum) {}
+  void reset()
+  {
+    haveLastRead = false;
+    haveLoop = false;
+  }
+  // Called on every EAR read while the tape is playing with the PC after the IN opcode, the t-state of the
+  // read, what it read and when the tape next changes. Returns true if time has been moved on.
+  bool skip(uint16_t pc, int tstate, uint8_t value, int nextEdge);
+  void endFrame(int frameTStates)
+  {
+    lastTState -= frameTStates;
+  }
+  uint64_t getSkippedTStates()
+  {
+    return skippedTStates;
+  }
+};
@@ -0,0 +1,155 @@
+#include "TapeDeck.h"
+#include "tzx_cas.h"
+#include "ZXSpectrumTapeListener.h"
+#include "LoaderAccelerator.h"
+
+TapeDeck::TapeDeck(ZXSpectrum *spectrum) : spectrum(spectrum), nextLevel(PULSE_KEEP)
+{
+  listener = new ZXSpectrumTapeListener(spectrum, nullptr);
+  tzxCas = new TzxCas();
+  accelerator = new LoaderAccelerator(spectrum);
+}
+
+TapeDeck::~TapeDeck()
+{
+  eject();
+  delete tzxCas;
+  delete listener;
+  delete accelerator;
+}
+
+bool TapeDeck::insert(TapeSource *source, bool isTap)
+{
+  if (!source->isReady())
+  {
+    // leave whatever tape was in there
+    Serial.printf("Not enough memory to play the tape\n");
+    delete source;
+    return false;
+  }
+  eject();
+  bool indexed = isTap ? tzxCas->index_tap(source) : tzxCas->index_tzx(source);
+  if (!indexed)
+  {
+    tzxCas->forget_source();
+    delete source;
+    return false;
+  }
+  this->source = source;
+  rewind();
+  return true;
+}
+
+void TapeDeck::eject()
+{
+  stop();
+  tzxCas->forget_source();
+  delete source;
+  source = nullptr;
+}
+
+void TapeDeck::play()
+{
+  if (!source || playing)
+  {
+    return;
+  }
+  if (finished)
+  {
+    rewind();
+  }
+  // 'stop the tape if in 48K mode' blocks need to know what we are
+  tzxCas->set_stops(true, spectrum->hwopt.hw_model != SPECMDL_128K);
+  // carry on from where the frame is now
+  nextEdge = spectrum->tstates;
+  accelerator->reset();
+  playing = true;
+}
+
+void TapeDeck::stop()
+{
+  playing = false;
+  // the ROM loader mustn't pick up a block we've stopped in the middle of
+  listener->offerBlock(nullptr, 0, 0);
+}
+
+void TapeDeck::rewind()
+{
+  stop();
+  tzxCas->rewind();
+  finished = false;
+  pulseCount = 0;
+  pulseIndex = 0;
+  position = 0;
+  level = false;
+  nextLevel = PULSE_KEEP;
+}
+
+void TapeDeck::setFlashLoad(bool enabled)
+{
+  listener->setFlashLoad(enabled);
+}
+
+uint64_t TapeDeck::getLength()
+{
+  return source ? tzxCas->get_total_ticks() : 0;
+}
+
+void TapeDeck::advance()
+{
+  // the pulse we were waiting on has finished
+  switch (nextLevel)
+  {
+  case PULSE_TOGGLE:
+    level = !level;
+    break;
+  case PULSE_LOW:
+    level = false;
+    break;
+  case PULSE_HIGH:
+    level = true;
+    break;
+  default:
+    break;
+  }
+  nextLevel = PULSE_KEEP;
+  if (pulseIndex == pulseCount)
+  {
+    pulseCount = tzxCas->next_pulses(listener, pulses, TAPE_DECK_BATCH);
+    pulseIndex = 0;
+    if (pulseCount == 0)
+    {
+      Serial.printf("End of tape\n");
+      stop();
+      finished = true;
+      return;
+    }
+  }
+  uint32_t pulse = pulses[pulseIndex++];
+  if (PULSE_LEVEL(pulse) == PULSE_STOP)
+  {
+    Serial.printf("Tape stopped\n");
+    stop();
+    return;
+  }
+  nextEdge += PULSE_TICKS(pulse);
+  position += PULSE_TICKS(pulse);
+  nextLevel = PULSE_LEVEL(pulse);
+}
+
+bool TapeDeck::skipLoaderLoop(uint16_t pc, int tstate, uint8_t value)
+{
+  return acceleration && accelerator->skip(pc, tstate, value, nextEdge);
+}
+
+uint64_t TapeDeck::getSkippedTStates()
+{
+  return accelerator->getSkippedTStates();
+}
+
+void TapeDeck::endFrame(int frameTStates)
+{
+  update(frameTStates);
+  nextEdge -= frameTStates;
+  accelerator->endFrame(frameTStates);
+}
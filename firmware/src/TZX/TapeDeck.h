@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+
+// how many pulses we get from the tape at once
+#define TAPE_DECK_BATCH 64
+
+class ZXSpectrum;
+class ZXSpectrumTapeListener;
+class TzxCas;
+class TapeSource;
+class LoaderAccelerator;
+
+// A tape deck plugged into the Spectrum's EAR socket.
+//
+// load_tzx and load_tap let the tape drive the CPU - the deck works the other way round. The frame
+// loop runs as normal and the deck pulls pulses from the tape as they are needed. The EAR level is
+// only worked out when something needs it - when the CPU reads port 0xFE and at the end of each
+// frame - so interrupts, the screen and the sound all carry on while a tape is loading.
+class TapeDeck
+{
+private:
+  ZXSpectrum *spectrum;
+  // offers standard speed blocks to the ROM loader so they can be flash loaded
+  ZXSpectrumTapeListener *listener;
+  TzxCas *tzxCas;
+  TapeSource *source = nullptr;
+  bool playing = false;
+  // we've reached the end of the tape
+  bool finished = false;
+  // frames to run for every real frame while the tape is playing
+  int speed = 1;
+  // the EAR level
+  bool level = false;
+  // frame t-state of the next edge and what happens to the level when we get there
+  int nextEdge = 0;
+  uint8_t nextLevel;
+  // packed pulses from the tape that we haven't played yet
+  uint32_t pulses[TAPE_DECK_BATCH];
+  int pulseCount = 0;
+  int pulseIndex = 0;
+  // skips over loader loops that are waiting for the next edge
+  LoaderAccelerator *accelerator;
+  bool acceleration = true;
+  // how far through the tape we are in T-states
+  uint64_t position = 0;
+  // move on to the next pulse
+  void advance();
+
+public:
+  TapeDeck(ZXSpectrum *spectrum);
+  ~TapeDeck();
+  // put a tape in the deck - the deck owns the source and deletes it when the tape is ejected. Returns false
+  // if the tape can't be read or there wasn't the memory to stream it
+  bool insert(TapeSource *source, bool isTap);
+  void eject();
+  bool hasTape()
+  {
+    return source != nullptr;
+  }
+  void play();
+  void stop();
+  void rewind();
+  bool isPlaying()
+  {
+    return playing;
+  }
+  // the EAR level the tape has got to
+  bool getLevel()
+  {
+    return level;
+  }
+  // has the whole tape been played
+  bool isFinished()
+  {
+    return finished;
+  }
+  void setSpeed(int speed)
+  {
+    this->speed = speed < 1 ? 1 : speed;
+  }
+  int getSpeed()
+  {
+    return speed;
+  }
+  // copy standard speed blocks straight into memory when the ROM loader is used
+  void setFlashLoad(bool enabled);
+  uint64_t getPosition()
+  {
+    return position;
+  }
+  // how long the tape is in T-states - this is an estimate for tapes streamed from a file
+  uint64_t getLength();
+  // play the tape up to the frame t-state and return the EAR level
+  inline bool update(int tstate)
+  {
+    while (playing && nextEdge <= tstate)
+    {
+      advance();
+    }
+    return level;
+  }
+  // Called when the CPU reads the EAR with the PC after the IN opcode, the t-state and what was read. If
+  // the CPU is in a loop waiting for the next edge this moves it on to when it sees the edge and returns true.
+  bool skipLoaderLoop(uint16_t pc, int tstate, uint8_t value);
+  void setLoaderAcceleration(bool enabled)
+  {
+    acceleration = enabled;
+  }
+  // how many T-states the loader loops have been skipped for
+  uint64_t getSkippedTStates();
+  // play the rest of the frame and get ready for the next one
+  void endFrame(int frameTStates);
+};
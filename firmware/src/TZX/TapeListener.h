@@ -3,9 +3,31 @@
 #include <stdint.h>
 #include <functional>
 
+class TapeSource;
+
 #define CPU_FREQ 3500000
 #define MILLI_SECOND (CPU_FREQ / 1000)
 
+// What happens to the tape signal at the end of a pulse
+enum TapePulseLevel : uint8_t
+{
+  PULSE_TOGGLE,
+  PULSE_LOW,
+  PULSE_HIGH,
+  // leave the level as it is
+  PULSE_KEEP,
+  // the tape should be stopped here - only generated when stops are enabled
+  PULSE_STOP,
+};
+
+// Pulses are handed to listeners in batches with each one packed into 32 bits - the T-states to
+// wait for in the bottom bits and what to do to the level afterwards in the top bits
+#define PULSE_LEVEL_SHIFT 29
+#define PULSE_TICKS_MASK ((1u << PULSE_LEVEL_SHIFT) - 1)
+#define PACK_PULSE(ticks, level) (((uint32_t)(level) << PULSE_LEVEL_SHIFT) | (uint32_t)(ticks))
+#define PULSE_TICKS(pulse) ((pulse) & PULSE_TICKS_MASK)
+#define PULSE_LEVEL(pulse) ((TapePulseLevel)((pulse) >> PULSE_LEVEL_SHIFT))
+
 class TapeListener {
 protected:
   uint64_t totalTicks = 0;
@@ -22,6 +44,40 @@ public:
   virtual void runForTicks(uint64_t ticks) = 0;
   virtual void pause1Millis() = 0;
   virtual void finish() = 0;
+  // offer a standard speed block so it can be copied straight into memory if the ROM loader
+  // picks it up - pass nullptr to withdraw it. Listeners that can't do this ignore it.
+  virtual void offerBlock(TapeSource * /* source */, uint32_t /* offset */, int /* length */) {}
+  // has the offered block been loaded
+  virtual bool blockLoaded() {
+    return false;
+  }
+  // does the listener want standard speed blocks offered to it
+  virtual bool acceptsBlocks() {
+    return false;
+  }
+  // play a batch of packed pulses - listeners should override this with something that doesn't
+  // need a virtual call for every pulse
+  virtual void playPulses(const uint32_t *pulses, int count) {
+    for (int i = 0; i < count; i++) {
+      uint32_t ticks = PULSE_TICKS(pulses[i]);
+      if (ticks > 0) {
+        runForTicks(ticks);
+      }
+      switch (PULSE_LEVEL(pulses[i])) {
+        case PULSE_TOGGLE:
+          toggleMicLevel();
+          break;
+        case PULSE_LOW:
+          setMicLow();
+          break;
+        case PULSE_HIGH:
+          setMicHigh();
+          break;
+        default:
+          break;
+      }
+    }
+  }
   uint64_t getTotalTicks() {
     return totalTicks;
   }
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include "Serial.h"
+#include "TapeRecorder.h"
+
+void TapeRecorder::setFilename(const std::string &filename)
+{
+  this->filename = filename;
+  blocksSaved = 0;
+  state = DecodeState::PILOT;
+  pilotPulses = 0;
+  if (!filename.empty())
+  {
+    Serial.printf("Saving to tape %s\n", filename.c_str());
+  }
+}
+
+std::string TapeRecorder::savedTapeName(const std::string &gameFilename)
+{
+  size_t dot = gameFilename.find_last_of('.');
+  size_t slash = gameFilename.find_last_of('/');
+  std::string name = gameFilename;
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+  {
+    name = gameFilename.substr(0, dot);
+  }
+  return name + "-saved.tap";
+}
+
+bool TapeRecorder::saveBlock(const uint8_t *data, int length)
+{
+  if (filename.empty() || length > 0xFFFF)
+  {
+    return false;
+  }
+  // open and close the file for each block so nothing is lost if the machine is switched off
+  FILE *fp = fopen(filename.c_str(), "ab");
+  if (!fp)
+  {
+    Serial.printf("Could not open %s to save to\n", filename.c_str());
+    return false;
+  }
+  uint8_t header[2] = {(uint8_t)(length & 0xFF), (uint8_t)(length >> 8)};
+  bool written = fwrite(header, 1, 2, fp) == 2 && fwrite(data, 1, length, fp) == (size_t)length;
+  fclose(fp);
+  if (written)
+  {
+    blocksSaved++;
+    Serial.printf("Saved block %d - flag %02X, %d bytes\n", blocksSaved, data[0], length);
+  }
+  return written;
+}
+
+void TapeRecorder::pulse(int length)
+{
+  switch (state)
+  {
+  case DecodeState::PILOT:
+    if (pilotPulses > 0 && length > pilotLength - pilotLength / 8 && length < pilotLength + pilotLength / 8)
+    {
+      // keep a running average so a pilot that drifts a little still counts
+      pilotPulses++;
+      pilotLength = (pilotLength * 7 + length) / 8;
+    }
+    else if (pilotPulses >= TAPE_RECORDER_MIN_PILOT && length < pilotLength / 2)
+    {
+      state = DecodeState::SYNC;
+    }
+    else
+    {
+      // start looking for a pilot again from this pulse
+      pilotPulses = 1;
+      pilotLength = length;
+    }
+    break;
+  case DecodeState::SYNC:
+    if (length < pilotLength / 2)
+    {
+      state = DecodeState::DATA;
+      block.clear();
+      firstHalf = 0;
+      byte = 0;
+      bits = 0;
+    }
+    else
+    {
+      state = DecodeState::PILOT;
+      pilotPulses = 1;
+      pilotLength = length;
+    }
+    break;
+  case DecodeState::DATA:
+    if (length > 2 * pilotLength)
+    {
+      // no more bits
+      endBlock();
+      break;
+    }
+    if (firstHalf == 0)
+    {
+      firstHalf = length;
+      break;
+    }
+    // a one is about 0.8 of a pilot pulse and a zero half that - split the difference
+    byte = (byte << 1) | ((firstHalf + length) * 50 > pilotLength * 59 ? 1 : 0);
+    firstHalf = 0;
+    if (++bits == 8)
+    {
+      block.push_back(byte);
+      bits = 0;
+    }
+    break;
+  }
+}
+
+void TapeRecorder::endBlock()
+{
+  state = DecodeState::PILOT;
+  pilotPulses = 0;
+  // anything that isn't a flag, some data and a good parity byte is probably just noise
+  uint8_t parity = 0;
+  for (uint8_t value : block)
+  {
+    parity ^= value;
+  }
+  if (block.size() >= 2 && parity == 0)
+  {
+    saveBlock(block.data(), block.size());
+  }
+  block.clear();
+}
+
+void TapeRecorder::endFrame(int frameTStates)
+{
+  // the last edge of a block is followed by silence
+  if (state == DecodeState::DATA && frameTStates - lastEdge > 2 * pilotLength)
+  {
+    endBlock();
+  }
+  lastEdge -= frameTStates;
+  // don't let the time since the last edge grow forever
+  if (lastEdge < -TAPE_RECORDER_MAX_GAP)
+  {
+    lastEdge = -TAPE_RECORDER_MAX_GAP;
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// pilots have to be at least this long before we'll take what follows as a block
+#define TAPE_RECORDER_MIN_PILOT 256
+// how long ago we remember the last edge for - far longer than any pulse
+#define TAPE_RECORDER_MAX_GAP (1 << 24)
+
+// A tape recorder plugged into the Spectrum's MIC socket that writes what is saved to a TAP file.
+//
+// The ROM's SA-BYTES is trapped so a SAVE from BASIC or a game that calls the ROM is written straight to
+// the file - see ZXSpectrum::trapSaveBlock. Savers with their own code still have to play their blocks
+// out of the MIC socket so we also time the edges and decode standard looking blocks from them - a pilot
+// tone, two short sync pulses and then two pulses for each bit with ones twice as long as zeros.
+class TapeRecorder
+{
+private:
+  // where saved blocks are written - empty if we aren't recording
+  std::string filename;
+  int blocksSaved = 0;
+  // whether saves from the ROM are trapped or played out of the MIC socket
+  bool trapSaves = true;
+  // the MIC level and the frame t-state it last changed at
+  bool mic = false;
+  int lastEdge = 0;
+  // decoding blocks from the edges
+  enum class DecodeState
+  {
+    PILOT,
+    SYNC,
+    DATA
+  };
+  DecodeState state = DecodeState::PILOT;
+  int pilotPulses = 0;
+  int pilotLength = 0;
+  // the first half of the bit we're in the middle of - 0 if we're waiting for a new bit
+  int firstHalf = 0;
+  uint8_t byte = 0;
+  int bits = 0;
+  std::vector<uint8_t> block;
+  void pulse(int length);
+  // the block has finished - save it if it looks good
+  void endBlock();
+
+public:
+  // start recording to filename - blocks are added to the end of the file if it is already there
+  void setFilename(const std::string &filename);
+  const std::string &getFilename()
+  {
+    return filename;
+  }
+  bool isRecording()
+  {
+    return !filename.empty();
+  }
+  void setTrapSaves(bool enabled)
+  {
+    trapSaves = enabled;
+  }
+  bool isTrappingSaves()
+  {
+    return trapSaves && isRecording();
+  }
+  // the TAP file name to save to for a game - it goes next to the game
+  static std::string savedTapeName(const std::string &gameFilename);
+  // write a block - the flag byte, the data and the parity byte - to the file
+  bool saveBlock(const uint8_t *data, int length);
+  int getBlocksSaved()
+  {
+    return blocksSaved;
+  }
+  // called when the CPU writes to port 0xFE with the frame t-state and the MIC bit
+  inline void setMic(int tstate, bool level)
+  {
+    if (level != mic)
+    {
+      mic = level;
+      pulse(tstate - lastEdge);
+      lastEdge = tstate;
+    }
+  }
+  // finish off a block that has stopped and get ready for the next frame
+  void endFrame(int frameTStates);
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// how much of a tape file we keep in memory at once
+#define TAPE_WINDOW_SIZE 4096
+
+// Gives the tape player access to a tape image. This is either an image that is already in memory
+// or a file that we read through a small window - so we never need the whole tape in RAM.
+class TapeSource
+{
+private:
+  FILE *fp = nullptr;
+  bool closeFile = false;
+  uint32_t length = 0;
+  // the bytes we currently have available and where they are in the tape
+  const uint8_t *window = nullptr;
+  uint32_t windowStart = 0;
+  uint32_t windowLength = 0;
+  uint8_t *buffer = nullptr;
+
+  void fill(uint32_t offset)
+  {
+    fseek(fp, offset, SEEK_SET);
+    size_t read = fread(buffer, 1, TAPE_WINDOW_SIZE, fp);
+    // anything past the end of the file reads as zero
+    memset(buffer + read, 0, TAPE_WINDOW_SIZE - read);
+    windowStart = offset;
+    windowLength = read;
+  }
+
+public:
+  TapeSource(const uint8_t *data, uint32_t length) : length(length), window(data), windowLength(length)
+  {
+  }
+  // set closeFile if the source should close the file when it is deleted
+  TapeSource(FILE *fp, bool closeFile = false) : fp(fp), closeFile(closeFile)
+  {
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    buffer = (uint8_t *)malloc(TAPE_WINDOW_SIZE);
+    if (buffer == nullptr)
+    {
+      // isReady says so - nothing can be read from it
+      printf("Failed to allocate tape window\n");
+      return;
+    }
+    window = buffer;
+    fill(0);
+  }
+  ~TapeSource()
+  {
+    free(buffer);
+    if (closeFile)
+    {
+      fclose(fp);
+    }
+  }
+  uint32_t size()
+  {
+    return length;
+  }
+  // false if we couldn't get the memory to read the file through
+  bool isReady()
+  {
+    return !fp || buffer != nullptr;
+  }
+  // are we reading from a file rather than memory
+  bool isStreamed()
+  {
+    return fp != nullptr;
+  }
+  inline uint8_t operator[](uint32_t offset)
+  {
+    if (offset - windowStart >= windowLength)
+    {
+      if (!fp || offset >= length)
+      {
+        return 0;
+      }
+      fill(offset);
+    }
+    return window[offset - windowStart];
+  }
+  // how many bytes from offset onwards we can read without going back to the file
+  uint32_t available(uint32_t offset)
+  {
+    if (offset - windowStart >= windowLength)
+    {
+      return 0;
+    }
+    return windowLength - (offset - windowStart);
+  }
+  // get count bytes starting at offset in one go - count must be no more than TAPE_WINDOW_SIZE
+  // and the pointer is only valid until the next read
+  const uint8_t *get(uint32_t offset, uint32_t count)
+  {
+    if (fp && (offset < windowStart || offset + count > windowStart + TAPE_WINDOW_SIZE))
+    {
+      fill(offset);
+    }
+    return window + (offset - windowStart);
+  }
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "Serial.h"
 #include "../Emulator/spectrum.h"
 #include "TapeListener.h"
@@ -6,6 +8,7 @@ class ZXSpectrumTapeListener:public TapeListener {
   private:
     ZXSpectrum *spectrum;
     uint64_t totalExecutionTime = 0;
+    bool flashLoad = false;
   public:
   ZXSpectrumTapeListener(ZXSpectrum *spectrum, ProgressEvent progressEvent) : TapeListener(progressEvent) {
     this->spectrum = spectrum;
@@ -50,9 +53,52 @@ class ZXSpectrumTapeListener:public TapeListener {
     uint64_t endUs = get_usecs();
     totalExecutionTime += endUs - startUs;
   }
+  // run the whole batch without going back through the virtual functions for each pulse
+  virtual void playPulses(const uint32_t *pulses, int count) {
+    uint64_t startUs = get_usecs();
+    uint64_t batchTicks = 0;
+    for (int i = 0; i < count; i++) {
+      uint32_t ticks = PULSE_TICKS(pulses[i]);
+      if (ticks > 0) {
+        batchTicks += ticks;
+        this->spectrum->runForCycles(ticks);
+      }
+      switch (PULSE_LEVEL(pulses[i])) {
+        case PULSE_TOGGLE:
+          ZXSpectrumTapeListener::toggleMicLevel();
+          break;
+        case PULSE_LOW:
+          ZXSpectrumTapeListener::setMicLow();
+          break;
+        case PULSE_HIGH:
+          ZXSpectrumTapeListener::setMicHigh();
+          break;
+        default:
+          break;
+      }
+    }
+    uint64_t endUs = get_usecs();
+    totalExecutionTime += endUs - startUs;
+    addTicks(batchTicks);
+  }
   virtual void finish() {
     // what should we do here?
   }
+  // load standard speed blocks directly into memory when the ROM loader is used
+  void setFlashLoad(bool enabled) {
+    flashLoad = enabled;
+  }
+  virtual void offerBlock(TapeSource *source, uint32_t offset, int length) {
+    if (flashLoad || source == nullptr) {
+      this->spectrum->offerFlashLoad(source, offset, length);
+    }
+  }
+  virtual bool acceptsBlocks() {
+    return flashLoad;
+  }
+  virtual bool blockLoaded() {
+    return this->spectrum->flashLoadDone;
+  }
   uint64_t getTotalExecutionTime() {
     return totalExecutionTime;
   }
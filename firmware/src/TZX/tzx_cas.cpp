@@ -1,55 +1,20 @@
 #include "tzx_cas.h"
 #include "Serial.h"
 #include <string.h>
-#include <cmath>
-
-int compute_log2(int val)
-{
-	int count = 0;
-
-	while(val > 1)
-	{
-		if (val & 1)
-			return -1;
-		val /= 2;
-		count++;
-	}
-	return (val == 0) ? -1 : count;
-}
 
 static const uint8_t TZX_HEADER[8] = { 'Z','X','T','a','p','e','!',0x1a };
 
-void TzxCas::TzxCas::toggle_wave_data(TapeListener *tapeListener)
-{
-	tapeListener->toggleMicLevel();
-}
-
-void TzxCas::TzxCas::tzx_cas_get_blocks(const uint8_t *casdata, int caslen)
+void TzxCas::TzxCas::tzx_cas_get_blocks()
 {
-	int pos = sizeof(TZX_HEADER) + 2;
-	int max_block_count = INITIAL_MAX_BLOCK_COUNT;
-	int loopcount = 0, loopoffset = 0;
-	blocks = (uint8_t**)malloc(max_block_count * sizeof(uint8_t*));
-	memset(blocks,0,max_block_count);
-	block_count = 0;
+	uint32_t pos = sizeof(TZX_HEADER) + 2;
+	block_index.clear();
 
-	while (pos < caslen)
+	while (pos < source->size())
 	{
 		uint32_t datasize;
-		uint8_t blocktype = casdata[pos];
+		uint8_t blocktype = (*source)[pos];
 
-		if (block_count == max_block_count)
-		{
-			void *old_blocks = blocks;
-			int old_max_block_count = max_block_count;
-			max_block_count = max_block_count + BLOCK_COUNT_INCREMENTS;
-			blocks = (uint8_t**)malloc(max_block_count * sizeof(uint8_t*));
-			memset(blocks, 0, max_block_count);
-			memcpy(blocks, old_blocks, old_max_block_count * sizeof(uint8_t*));
-			free(old_blocks);
-		}
-
-		blocks[block_count] = (uint8_t*)&casdata[pos];
+		block_index.push_back({blocktype, pos, tzx_block_ticks(pos)});
 
 		pos += 1;
 
@@ -57,29 +22,29 @@ void TzxCas::TzxCas::tzx_cas_get_blocks(const uint8_t *casdata, int caslen)
 		{
 		case 0x10:
 			pos += 2;
-			datasize = get_u16le(&casdata[pos]);
+			datasize = get_u16le(source->get(pos, 4));
 			pos += 2 + datasize;
 			break;
 		case 0x11:
 			pos += 0x0f;
-			datasize = get_u24le(&casdata[pos]);
+			datasize = get_u24le(source->get(pos, 4));
 			pos += 3 + datasize;
 			break;
 		case 0x12:
 			pos += 4;
 			break;
 		case 0x13:
-			datasize = casdata[pos];
+			datasize = (*source)[pos];
 			pos += 1 + 2 * datasize;
 			break;
 		case 0x14:
 			pos += 7;
-			datasize = get_u24le(&casdata[pos]);
+			datasize = get_u24le(source->get(pos, 4));
 			pos += 3 + datasize;
 			break;
 		case 0x15:
 			pos += 5;
-			datasize = get_u24le(&casdata[pos]);
+			datasize = get_u24le(source->get(pos, 4));
 			pos += 3 + datasize;
 			break;
 		case 0x20: case 0x23:
@@ -87,44 +52,38 @@ void TzxCas::TzxCas::tzx_cas_get_blocks(const uint8_t *casdata, int caslen)
 			break;
 
 		case 0x24:
-			loopcount = get_u16le(&casdata[pos]);
+			// loops are played by tzx_cas_do_work - we just need the blocks
 			pos +=2;
-			loopoffset = pos;
 			break;
 
 		case 0x21: case 0x30:
-			datasize = casdata[pos];
+			datasize = (*source)[pos];
 			pos += 1 + datasize;
 			break;
 		case 0x22: case 0x27:
 			break;
 
 		case 0x25:
-			if (loopcount>0)
-			{
-				pos = loopoffset;
-				loopcount--;
-			}
 			break;
 
 		case 0x26:
-			datasize = get_u16le(&casdata[pos]);
+			datasize = get_u16le(source->get(pos, 4));
 			pos += 2 + 2 * datasize;
 			break;
 		case 0x28: case 0x32:
-			datasize = get_u16le(&casdata[pos]);
+			datasize = get_u16le(source->get(pos, 4));
 			pos += 2 + datasize;
 			break;
 		case 0x31:
 			pos += 1;
-			datasize = casdata[pos];
+			datasize = (*source)[pos];
 			pos += 1 + datasize;
 			break;
 		case 0x33:
 			// TODO - hardware type block
 			// haven't seen this in the wild yet - but it could let us
 			// work out the correct machine to emulate
-			datasize = casdata[pos];
+			datasize = (*source)[pos];
 			pos += 1 + 3 * datasize;
 			break;
 		case 0x34:
@@ -132,169 +91,666 @@ void TzxCas::TzxCas::tzx_cas_get_blocks(const uint8_t *casdata, int caslen)
 			break;
 		case 0x35:
 			pos += 0x10;
-			datasize = get_u32le(&casdata[pos]);
+			datasize = get_u32le(source->get(pos, 4));
 			pos += 4 + datasize;
 			break;
 		case 0x40:
 			pos += 1;
-			datasize = get_u24le(&casdata[pos]);
+			datasize = get_u24le(source->get(pos, 4));
 			pos += 3 + datasize;
 			break;
 		case 0x5A:
 			pos += 9;
 			break;
 		default:
-			datasize = get_u32le(&casdata[pos]);
+			datasize = get_u32le(source->get(pos, 4));
 			pos += 4 + datasize;
 			break;
 		}
-
-		block_count++;
 	}
 }
 
-void TzxCas::tzx_cas_handle_block(TapeListener *tapeListener, const uint8_t *bytes, int pause, int data_size, int pilot, int pilot_length, int sync1, int sync2, int bit0, int bit1, int bits_in_last_byte)
+void TzxCas::start_standard_block(TapeListener *tapeListener, uint32_t offset, int pause, int data_size, int pilot, int pilot_length, int sync1, int sync2, int bit0, int bit1, int bits_in_last_byte, bool flash_loadable)
 {
 	Serial.printf("tzx_cas_handle_block: loading %d bytes\n", data_size);
-	/* PILOT */
-	for ( ; pilot_length > 0; pilot_length--)
+	play.offset = offset;
+	play.pause = pause;
+	play.data_size = data_size;
+	play.pilot = pilot;
+	play.pilot_length = pilot_length;
+	play.sync1 = sync1;
+	play.sync2 = sync2;
+	play.bit0 = bit0;
+	play.bit1 = bit1;
+	play.bits_in_last_byte = bits_in_last_byte;
+	play.flash_loadable = flash_loadable && tapeListener->acceptsBlocks();
+	play.offered = false;
+	play.count = 0;
+	play.phase = PlayPhase::PILOT;
+}
+
+void TzxCas::start_pause(int pause)
+{
+	if (pause > 0)
 	{
-		tapeListener->runForTicks(pilot);
-		toggle_wave_data(tapeListener);
+		Serial.printf("Pause for %d ms\n", pause);
 	}
-	/* SYNC1 */
-	if (sync1 > 0)
+	play.pause = pause;
+	play.count = 0;
+	play.phase = PlayPhase::PAUSE;
+}
+
+void TzxCas::start_symbol_data()
+{
+	if (play.totd == 0)
 	{
-		tapeListener->runForTicks(sync1);
-		toggle_wave_data(tapeListener);
+		start_pause(play.pause);
+		return;
 	}
-	/* SYNC2 */
-	if (sync2 > 0)
+	Serial.printf("data block table %04x (has %0d symbols, max symbol length is %d)\n", play.totd, play.asd, play.npd);
+	// the data symbols follow the pilot symbols and the pilot RLE table
+	uint32_t offset = play.offset;
+	if (play.totp > 0)
 	{
-		tapeListener->runForTicks(sync2);
-		toggle_wave_data(tapeListener);
+		offset += ((2 * play.npp + 1) * play.asp) + play.totp * 3;
 	}
-	/* data */
-	for (int data_index = 0; data_index < data_size; data_index++)
-	{
-		uint8_t byte = bytes[data_index];
-		int bits_to_go = (data_index == (data_size - 1)) ? bits_in_last_byte : 8;
+	read_symbol_table(play.symbols, offset, play.npd, play.asd);
+	play.data_stream = SymbolStream();
+	play.data_stream.offset = offset + (2 * play.npd + 1) * play.asd;
+	play.symbol_bits = generalized_symbol_bits(play.asd); // number of bits needed to represent each symbol
+	play.count = 0;
+	play.phase = PlayPhase::SYMBOL_DATA;
+}
 
-		for ( ; bits_to_go > 0; byte <<= 1, bits_to_go--)
+bool TzxCas::next_symbol_pulse(TapePulse &pulse)
+{
+	while (play.symbol >= 0)
+	{
+		if (play.symbol_pulse < 0)
 		{
-			int bit_length = (byte & 0x80) ? bit1 : bit0;
-			tapeListener->runForTicks(bit_length);
-			toggle_wave_data(tapeListener);
-			tapeListener->runForTicks(bit_length);
-			toggle_wave_data(tapeListener);
+			play.symbol_pulse = 0;
+			switch (play.symbols.polarity[play.symbol])
+			{
+			case 0x00:
+				// pulse level has already been toggled so don't change
+				break;
+			case 0x01:
+				// pulse level has already been toggled so revert
+				pulse = {0, PULSE_TOGGLE};
+				return true;
+			case 0x02:
+				// force low
+				pulse = {0, PULSE_LOW};
+				return true;
+			case 0x03:
+				// force high
+				pulse = {0, PULSE_HIGH};
+				return true;
+			default:
+				printf("SYMDEF invalid - bad starting polarity");
+			}
+			continue;
 		}
-	}
-	/* pause */
-	if (pause > 0)
-	{
-		Serial.printf("Pause for %d ms\n", pause);
-		tapeListener->pause1Millis();
-		tapeListener->setMicLow();
-		for(int i = 0; i < pause - 1; i++) {
-			tapeListener->pause1Millis();
+		if (play.symbol_pulse < play.symbols.pulse_count[play.symbol])
+		{
+			pulse = {play.symbols.pulses[play.symbol * play.symbols.max_pulses + play.symbol_pulse], PULSE_TOGGLE};
+			play.symbol_pulse++;
+			return true;
 		}
+		play.symbol = -1;
 	}
+	return false;
 }
 
-void TzxCas::tzx_handle_direct(TapeListener *tapeListener, const uint8_t *bytes, int pause, int data_size, int tstates, int bits_in_last_byte)
+bool TzxCas::next_pulse(TapeListener *tapeListener, TapePulse &pulse)
 {
-	Serial.printf("tzx_handle_direct: loading %d bytes\n", data_size);
-	/* data */
-	for (int data_index = 0; data_index < data_size; data_index++)
+	while (true)
 	{
-		uint8_t byte = bytes[data_index];
-		int bits_to_go = (data_index == (data_size - 1)) ? bits_in_last_byte : 8;
-
-		for ( ; bits_to_go > 0; byte <<= 1, bits_to_go--)
+		switch (play.phase)
 		{
-			if (byte & 0x80) {
-				tapeListener->setMicHigh();
+		case PlayPhase::START:
+			// the signal starts off low
+			play.phase = PlayPhase::NEXT_BLOCK;
+			pulse = {0, PULSE_LOW};
+			return true;
+		case PlayPhase::NEXT_BLOCK:
+			if (play.current_block >= (int)block_index.size())
+			{
+				play.phase = PlayPhase::END_OF_TAPE;
+				break;
 			}
-			else {
-				tapeListener->setMicLow();
+			start_block(tapeListener);
+			break;
+		case PlayPhase::PILOT:
+			/* standard blocks can be picked up by the ROM loader while the pilot is playing */
+			if (play.flash_loadable && !play.offered)
+			{
+				if (hold_offers)
+				{
+					// an empty pulse to let the listener catch up - see next_pulses
+					pulse = {0, PULSE_KEEP};
+					return true;
+				}
+				tapeListener->offerBlock(source, play.offset, play.data_size);
+				play.offered = true;
+			}
+			if (play.count < (uint32_t)play.pilot_length && !(play.flash_loadable && play.count > 0 && tapeListener->blockLoaded()))
+			{
+				play.count++;
+				pulse = {(uint32_t)play.pilot, PULSE_TOGGLE};
+				return true;
+			}
+			play.phase = PlayPhase::SYNC1;
+			if (play.flash_loadable)
+			{
+				bool loaded = tapeListener->blockLoaded();
+				tapeListener->offerBlock(nullptr, 0, 0);
+				if (loaded)
+				{
+					/* the block is already in memory - skip straight to the pause */
+					Serial.printf("tzx_cas_handle_block: flash loaded\n");
+					start_pause(play.pause);
+				}
+			}
+			break;
+		case PlayPhase::SYNC1:
+			play.phase = PlayPhase::SYNC2;
+			if (play.sync1 > 0)
+			{
+				pulse = {(uint32_t)play.sync1, PULSE_TOGGLE};
+				return true;
+			}
+			break;
+		case PlayPhase::SYNC2:
+			play.phase = PlayPhase::DATA;
+			play.count = 0;
+			play.bit = 0;
+			play.second_half = false;
+			if (play.sync2 > 0)
+			{
+				pulse = {(uint32_t)play.sync2, PULSE_TOGGLE};
+				return true;
+			}
+			break;
+		case PlayPhase::DATA:
+			{
+				if (play.count >= play.data_size)
+				{
+					start_pause(play.pause);
+					break;
+				}
+				int bits_to_go = (play.count == (play.data_size - 1)) ? play.bits_in_last_byte : 8;
+				if (play.bit >= bits_to_go)
+				{
+					play.count++;
+					play.bit = 0;
+					break;
+				}
+				// every bit is two pulses of the same length
+				uint8_t byte = (*source)[play.offset + play.count] << play.bit;
+				pulse = {(uint32_t)((byte & 0x80) ? play.bit1 : play.bit0), PULSE_TOGGLE};
+				if (play.second_half)
+				{
+					play.bit++;
+				}
+				play.second_half = !play.second_half;
+				return true;
+			}
+		case PlayPhase::PULSES:
+			if (play.count < play.data_size)
+			{
+				pulse = {get_u16le(source->get(play.offset + 2 * play.count, 2)), PULSE_TOGGLE};
+				play.count++;
+				return true;
+			}
+			play.phase = PlayPhase::NEXT_BLOCK;
+			break;
+		case PlayPhase::DIRECT:
+			{
+				// each bit sets the level for tstates - so there's one more pulse than there are bits
+				uint32_t bits = play.data_size > 0 ? (play.data_size - 1) * 8 + play.bits_in_last_byte : 0;
+				if (bits == 0 || play.count > bits)
+				{
+					start_pause(play.pause);
+					break;
+				}
+				if (play.count == bits)
+				{
+					pulse = {(uint32_t)play.tstates, PULSE_KEEP};
+				}
+				else
+				{
+					uint8_t byte = (*source)[play.offset + play.count / 8] << (play.count & 7);
+					pulse = {play.count == 0 ? 0 : (uint32_t)play.tstates, (byte & 0x80) ? PULSE_HIGH : PULSE_LOW};
+				}
+				play.count++;
+				return true;
+			}
+		case PlayPhase::SYMBOL_PILOT:
+			if (next_symbol_pulse(pulse))
+			{
+				return true;
+			}
+			if (play.repetitions > 0)
+			{
+				play.repetitions--;
+				play.symbol = play.current_symbol;
+				play.symbol_pulse = -1;
+				break;
+			}
+			if (play.count < play.totp)
+			{
+				// the pilot and sync data stream has an RLE encoding
+				uint32_t entry = play.stream + play.count * 3;
+				play.current_symbol = (*source)[entry];
+				play.repetitions = get_u16le(source->get(entry + 1, 2));
+				play.count++;
+				break;
+			}
+			start_symbol_data();
+			break;
+		case PlayPhase::SYMBOL_DATA:
+			if (next_symbol_pulse(pulse))
+			{
+				return true;
+			}
+			if (play.count < play.totd)
+			{
+				play.symbol = read_symbol(play.data_stream, play.symbol_bits);
+				play.symbol_pulse = -1;
+				play.count++;
+				break;
+			}
+			start_pause(play.pause);
+			break;
+		case PlayPhase::CSW:
+			{
+				if (play.count >= play.data_size || play.offset >= play.csw_end)
+				{
+					start_pause(play.pause);
+					break;
+				}
+				// RLE - each byte is the length of a pulse in samples, or 0 followed by a 32 bit length
+				uint32_t samples = (*source)[play.offset++];
+				if (samples == 0)
+				{
+					samples = get_u32le(source->get(play.offset, 4));
+					play.offset += 4;
+				}
+				pulse = {csw_pulse_ticks(samples, play.csw_rate, play.csw_remainder), PULSE_TOGGLE};
+				play.count++;
+				return true;
+			}
+		case PlayPhase::LEVEL:
+			play.phase = PlayPhase::NEXT_BLOCK;
+			pulse = {0, play.level};
+			return true;
+		case PlayPhase::PAUSE:
+			if (play.count < (uint32_t)play.pause)
+			{
+				// the first millisecond finishes off the last edge and then the signal goes low
+				pulse = {MILLI_SECOND, play.count == 0 ? PULSE_LOW : PULSE_KEEP};
+				play.count++;
+				return true;
+			}
+			play.phase = PlayPhase::NEXT_BLOCK;
+			break;
+		case PlayPhase::STOP:
+			play.phase = PlayPhase::NEXT_BLOCK;
+			pulse = {0, PULSE_STOP};
+			return true;
+		case PlayPhase::END_OF_TAPE:
+			play.phase = PlayPhase::FINISHED;
+			if (!is_tap)
+			{
+				// Adding 1 ms. pause to ensure that the last edge is properly finished at the end of tape
+				pulse = {MILLI_SECOND, PULSE_KEEP};
+				return true;
 			}
-			tapeListener->runForTicks(tstates);
+			break;
+		case PlayPhase::FINISHED:
+			return false;
 		}
 	}
+}
 
-	/* pause */
-	if (pause > 0)
+int TzxCas::generalized_symbol_bits(int asd)
+{
+	// enough bits to hold any of the asd symbols
+	int bits = 0;
+	while ((1 << bits) < asd)
 	{
-		tapeListener->pause1Millis();
-		tapeListener->setMicLow();
-		for(int i = 0; i < pause - 1; i++) {
-			tapeListener->pause1Millis();
-		}
+		bits++;
 	}
+	return bits;
 }
 
-void TzxCas::tzx_handle_generalized(TapeListener *tapeListener, const uint8_t *bytes, int pause, uint32_t totp, int npp, int asp, uint32_t totd, int npd, int asd)
+uint64_t TzxCas::data_ticks(uint32_t offset, int data_size, int bit0, int bit1, int bits_in_last_byte)
 {
-	if (totp > 0)
+	if (data_size <= 0)
+	{
+		return 0;
+	}
+	// every bit is two pulses of the same length so we only need to count the ones
+	uint64_t bits = (uint64_t)(data_size - 1) * 8 + bits_in_last_byte;
+	uint64_t ones = 0;
+	if (source->isStreamed() && source->available(offset) < (uint32_t)data_size)
 	{
-	//  Serial.printf("pilot block table %04x\n", totp);
+		// don't read the whole file just to find out how long it is - count the ones in
+		// the part of the block we already have and assume the rest looks the same
+		uint32_t sample = source->available(offset);
+		if (sample == 0)
+		{
+			return bits * (bit0 + bit1);
+		}
+		for (uint32_t data_index = 0; data_index < sample; data_index++)
+		{
+			ones += __builtin_popcount((*source)[offset + data_index]);
+		}
+		ones = ones * bits / ((uint64_t)sample * 8);
+		return 2 * (ones * bit1 + (bits - ones) * bit0);
+	}
+	for (int data_index = 0; data_index < data_size - 1; data_index++)
+	{
+		ones += __builtin_popcount((*source)[offset + data_index]);
+	}
+	// only the top bits of the last byte are used
+	ones += __builtin_popcount((*source)[offset + data_size - 1] >> (8 - bits_in_last_byte));
+	return 2 * (ones * bit1 + (bits - ones) * bit0);
+}
 
-		const uint8_t *symtable = bytes;
-		const uint8_t *table2 = symtable + (2 * npp + 1)*asp;
+uint64_t TzxCas::symbol_ticks(const SymbolTable &table, int symbol)
+{
+	uint64_t ticks = 0;
+	for (int i = 0; i < table.pulse_count[symbol]; i++)
+	{
+		ticks += table.pulses[symbol * table.max_pulses + i];
+	}
+	return ticks;
+}
 
-		// the Pilot and sync data stream has an RLE encoding
+uint64_t TzxCas::generalized_ticks(uint32_t offset, uint32_t totp, int npp, int asp, uint32_t totd, int npd, int asd)
+{
+	uint64_t ticks = 0;
+	SymbolTable table;
+	if (totp > 0)
+	{
+		read_symbol_table(table, offset, npp, asp);
+		uint32_t table2 = offset + (2 * npp + 1)*asp;
 		for (uint32_t i = 0; i < totp*3; i+=3)
 		{
-			uint8_t symbol = table2[i + 0];
-			uint16_t repetitions = get_u16le(&table2[i + 1]);
-			//Serial.printf("symbol %02x repetitions %04x\n", symbol, repetitions); // does 1 mean repeat once, or that it only occurs once?
+			ticks += symbol_ticks(table, (*source)[table2 + i + 0]) * get_u16le(source->get(table2 + i + 1, 2));
+		}
+		offset += ((2 * npp + 1)*asp) + totp * 3;
+	}
+	if (totd > 0)
+	{
+		read_symbol_table(table, offset, npd, asd);
+		int NB = generalized_symbol_bits(asd);
+		// work out how long each symbol is once rather than for every symbol in the stream
+		uint64_t lengths[256];
+		uint64_t total_length = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			lengths[i] = symbol_ticks(table, i);
+			total_length += lengths[i];
+		}
+		if (source->isStreamed())
+		{
+			// assume the symbols are used equally rather than reading the data stream
+			return ticks + totd * total_length / asd;
+		}
+		SymbolStream stream;
+		stream.offset = offset + (2 * npd + 1)*asd;
+		for (uint32_t i = 0; i < totd; i++)
+		{
+			ticks += lengths[read_symbol(stream, NB)];
+		}
+	}
+	return ticks;
+}
 
-			for (int j = 0; j < repetitions; j++)
+void TzxCas::read_symbol_table(SymbolTable &table, uint32_t offset, int maxp, int count)
+{
+	// room for every possible symbol so a bad symbol in the stream plays as silence rather than reading off the end
+	table.max_pulses = maxp;
+	table.pulses.assign(maxp * 256, 0);
+	memset(table.polarity, 0, sizeof(table.polarity));
+	memset(table.pulse_count, 0, sizeof(table.pulse_count));
+	for (int symbol = 0; symbol < count; symbol++)
+	{
+		uint32_t definition = offset + (2 * maxp + 1) * symbol;
+		table.polarity[symbol] = (*source)[definition];
+		for (int i = 0; i < maxp; i++)
+		{
+			uint16_t pulse_length = (*source)[definition + 1 + 2 * i] | ((*source)[definition + 2 + 2 * i] << 8);
+			// shorter lists can be terminated with a pulse_length of 0
+			if (pulse_length == 0)
 			{
-				tzx_handle_symbol(tapeListener, symtable, symbol, npp);
+				break;
 			}
+			table.pulses[symbol * maxp + i] = pulse_length;
+			table.pulse_count[symbol]++;
 		}
-
-		// advance to after this data
-		bytes += ((2 * npp + 1)*asp) + totp * 3;
 	}
+}
 
-	if (totd > 0)
+uint64_t TzxCas::csw_ticks(uint32_t offset, uint32_t end, uint32_t pulses, uint32_t rate)
+{
+	uint64_t samples = 0;
+	uint32_t counted = 0;
+	uint32_t limit = end;
+	if (source->isStreamed() && source->available(offset) < end - offset)
 	{
-	 Serial.printf("data block table %04x (has %0d symbols, max symbol length is %d)\n", totd, asd, npd);
-
-		const uint8_t *symtable = bytes;
-		const uint8_t *table2 = bytes + (2 * npd + 1)*asd;
-
-		int NB = std::ceil(compute_log2(asd)); // number of bits needed to represent each symbol
-
-		uint8_t stream_bit = 0;
-		uint32_t stream_byte = 0;
-
-		for (uint32_t i = 0; i < totd; i++)
+		// don't read the whole file just to find out how long it is - add up the part of the
+		// recording we already have and assume the rest looks the same
+		limit = offset + source->available(offset);
+	}
+	while (counted < pulses && offset < limit)
+	{
+		uint32_t length = (*source)[offset++];
+		if (length == 0)
 		{
-			uint8_t symbol = 0;
+			length = get_u32le(source->get(offset, 4));
+			offset += 4;
+		}
+		samples += length;
+		counted++;
+	}
+	if (counted == 0)
+	{
+		return 0;
+	}
+	if (limit != end && counted < pulses)
+	{
+		samples = samples * pulses / counted;
+	}
+	return samples * CPU_FREQ / rate;
+}
 
-			for (int j = 0; j < NB; j++)
+uint64_t TzxCas::tzx_block_ticks(uint32_t offset)
+{
+	const uint8_t *cur_block = source->get(offset, TZX_BLOCK_HEADER_SIZE);
+	uint64_t ticks = 0;
+	int pause_time = 0;
+	int data_size, pilot_length;
+	switch (cur_block[0])
+	{
+	case 0x10:  /* Standard Speed Data Block (.TAP block) */
+		pause_time = get_u16le(&cur_block[1]);
+		data_size = get_u16le(&cur_block[3]);
+		pilot_length = (cur_block[5] < 128) ?  8063 : 3223;
+		ticks = 2168 * pilot_length + 667 + 735 + data_ticks(offset + 5, data_size, 855, 1710, 8);
+		break;
+	case 0x11:  /* Turbo Loading Data Block */
+		pause_time = get_u16le(&cur_block[14]);
+		ticks = (uint64_t)get_u16le(&cur_block[1]) * get_u16le(&cur_block[11]) + get_u16le(&cur_block[3]) + get_u16le(&cur_block[5]);
+		ticks += data_ticks(offset + 19, get_u24le(&cur_block[16]), get_u16le(&cur_block[7]), get_u16le(&cur_block[9]), cur_block[13]);
+		break;
+	case 0x12:  /* Pure Tone */
+		ticks = (uint64_t)get_u16le(&cur_block[1]) * get_u16le(&cur_block[3]);
+		break;
+	case 0x13:  /* Sequence of Pulses of Different Lengths */
+		for (int i = 0; i < cur_block[1]; i++)
+		{
+			ticks += get_u16le(&cur_block[2 + 2 * i]);
+		}
+		break;
+	case 0x14:  /* Pure Data Block */
+		pause_time = get_u16le(&cur_block[6]);
+		ticks = data_ticks(offset + 11, get_u24le(&cur_block[8]), get_u16le(&cur_block[1]), get_u16le(&cur_block[3]), cur_block[5]);
+		break;
+	case 0x15:  /* Direct Recording */
+		pause_time = get_u16le(&cur_block[3]);
+		data_size = get_u24le(&cur_block[6]);
+		if (data_size > 0)
+		{
+			ticks = ((uint64_t)(data_size - 1) * 8 + cur_block[5]) * get_u16le(&cur_block[1]);
+		}
+		break;
+	case 0x19:  /* Generalized Data Block */
+		{
+			pause_time = get_u16le(&cur_block[5]);
+			uint32_t totp = get_u32le(&cur_block[7]);
+			int npp = cur_block[11];
+			int asp = cur_block[12];
+			if (asp == 0 && totp > 0) asp = 256;
+			uint32_t totd = get_u32le(&cur_block[13]);
+			int npd = cur_block[17];
+			int asd = cur_block[18];
+			if (asd == 0 && totd > 0) asd = 256;
+			ticks = generalized_ticks(offset + 19, totp, npp, asp, totd, npd, asd);
+		}
+		break;
+	case 0x18:  /* CSW Recording */
+		{
+			pause_time = get_u16le(&cur_block[5]);
+			uint32_t end = offset + 5 + get_u32le(&cur_block[1]);
+			uint32_t rate = get_u24le(&cur_block[7]);
+			uint32_t pulses = get_u32le(&cur_block[11]);
+			// we can only play RLE recordings
+			if (cur_block[10] == 0x01 && rate > 0)
 			{
-				symbol |= stream_get_bit(table2, stream_bit, stream_byte) << j;
+				ticks = csw_ticks(offset + 15, end, pulses, rate);
 			}
-			tzx_handle_symbol(tapeListener, symtable, symbol, npd);
 		}
+		break;
+	case 0x20:  /* Pause (Silence) or 'Stop the Tape' Command */
+		pause_time = get_u16le(&cur_block[1]);
+		if (pause_time == 0)
+		{
+			// we play a stop the tape as a 5 second pause
+			pause_time = 5000;
+		}
+		break;
 	}
+	return ticks + (uint64_t)pause_time * MILLI_SECOND;
+}
 
-	/* pause */
-	if (pause > 0)
+int TzxCas::follow_control_block(int block, ControlState &state)
+{
+	uint32_t offset = block_index[block].offset;
+	int next = block + 1;
+	switch ((*source)[offset])
 	{
-		tapeListener->pause1Millis();
-		tapeListener->setMicLow();
-		for(int i = 0; i < pause - 1; i++) {
-			tapeListener->pause1Millis();
+	case 0x23:  /* Jump To Block */
+		{
+			int jump = (int16_t)get_u16le(source->get(offset + 1, 2));
+			// a jump of 0 would play this block forever
+			if (jump != 0)
+			{
+				next = block + jump;
+			}
 		}
+		break;
+	case 0x24:  /* Loop Start */
+		state.loop_count = get_u16le(source->get(offset + 1, 2));
+		state.loop_block = block + 1;
+		break;
+	case 0x25:  /* Loop End */
+		// the blocks in the loop are played loop_count times altogether
+		if (state.loop_count > 1)
+		{
+			state.loop_count--;
+			next = state.loop_block;
+		}
+		else
+		{
+			state.loop_count = 0;
+		}
+		break;
+	case 0x26:  /* Call Sequence */
+		{
+			// the calls are relative to the call sequence block
+			int calls = get_u16le(source->get(offset + 1, 2));
+			int call = (int16_t)get_u16le(source->get(offset + 3, 2));
+			if (calls > 0 && call != 0)
+			{
+				state.call_block = block;
+				state.call_index = 0;
+				next = block + call;
+			}
+		}
+		break;
+	case 0x27:  /* Return From Sequence */
+		if (state.call_block >= 0)
+		{
+			uint32_t call_offset = block_index[state.call_block].offset;
+			int calls = get_u16le(source->get(call_offset + 1, 2));
+			state.call_index++;
+			int call = state.call_index < calls ? (int16_t)get_u16le(source->get(call_offset + 3 + 2 * state.call_index, 2)) : 0;
+			if (call != 0)
+			{
+				next = state.call_block + call;
+			}
+			else
+			{
+				// that was the last call so carry on after the call sequence
+				next = state.call_block + 1;
+				state.call_block = -1;
+			}
+		}
+		break;
+	case 0x28:  /* Select Block */
+		{
+			// there's nobody to ask so we take the first choice
+			int jump = (*source)[offset + 3] > 0 ? (int16_t)get_u16le(source->get(offset + 4, 2)) : 0;
+			if (jump != 0)
+			{
+				next = block + jump;
+			}
+		}
+		break;
+	}
+	// jumping off either end of the tape finishes it
+	if (next < 0 || next > (int)block_index.size())
+	{
+		next = block_index.size();
 	}
+	return next;
 }
 
-
+void TzxCas::tzx_cas_sum_ticks()
+{
+	// walk the blocks the same way they are played so that loops, jumps and calls are counted
+	total_ticks = 0;
+	ControlState state;
+	int current_block = 0;
+	int steps = 0;
+	while (current_block < (int)block_index.size() && steps++ < TZX_MAX_BLOCK_STEPS)
+	{
+		const TapeBlockInfo &info = block_index[current_block];
+		if (info.type >= 0x23 && info.type <= 0x28)
+		{
+			current_block = follow_control_block(current_block, state);
+			continue;
+		}
+		total_ticks += info.ticks;
+		current_block++;
+	}
+	// the 1ms at the end of the tape
+	total_ticks += MILLI_SECOND;
+}
 
 void TzxCas::ascii_block_common_log( const char *block_type_string, uint8_t block_type)
 {
@@ -322,287 +778,412 @@ const char *const hw_info[] =
 	"Tape does not run on this machine / this hardware",
 };
 
-void TzxCas::tzx_cas_do_work(TapeListener *tapeListener)
+void TzxCas::start_block(TapeListener *tapeListener)
 {
-	int current_block = 0;
-
-	tapeListener->setMicLow();
+	int pause_time;
+	uint32_t data_size;
+	uint32_t text_size, total_size, i;
+	int pilot, pilot_length, sync1, sync2;
+	int bit0, bit1, bits_in_last_byte;
+	uint32_t block_offset = block_index[play.current_block].offset;
 
-	int loopcount = 0, loopoffset = 0;
+	// blocks that don't make a sound just move on to the next one
+	play.phase = PlayPhase::NEXT_BLOCK;
 
-	while (current_block < block_count)
+	if (is_tap)
 	{
-		int pause_time;
-		uint32_t data_size;
-		uint32_t text_size, total_size, i;
-		int pilot, pilot_length, sync1, sync2;
-		int bit0, bit1, bits_in_last_byte;
-		uint8_t *cur_block = blocks[current_block];
-		uint8_t block_type = cur_block[0];
-		uint16_t tstates = 0;
+		data_size = get_u16le(source->get(block_offset, 2));
+		pilot_length = ((*source)[block_offset + 2] == 0x00) ? 8063 : 3223;
+		Serial.printf("tap_cas_fill_wave: Handling TAP block containing 0x%X bytes\n", data_size);
+		start_standard_block(tapeListener, block_offset + 2, 1000, data_size, 2168, pilot_length, 667, 735, 855, 1710, 8, true);
+		play.current_block++;
+		return;
+	}
+
+	const uint8_t *cur_block = source->get(block_offset, TZX_BLOCK_HEADER_SIZE);
+	uint8_t block_type = cur_block[0];
 
 	/* Uncomment this to include into error.log a list of the types each block */
-	Serial.printf("tzx_cas_fill_wave: block %d, block_type %02x\n", current_block, block_type);
+	Serial.printf("tzx_cas_fill_wave: block %d, block_type %02x\n", play.current_block, block_type);
 
-		switch (block_type)
+	play.current_block++;
+
+	switch (block_type)
+	{
+	case 0x10:  /* Standard Speed Data Block (.TAP block) */
+		pause_time = get_u16le(&cur_block[1]);
+		data_size = get_u16le(&cur_block[3]);
+		pilot_length = (cur_block[5] < 128) ?  8063 : 3223;
+		start_standard_block(tapeListener, block_offset + 5, pause_time, data_size, 2168, pilot_length, 667, 735, 855, 1710, 8, true);
+		break;
+	case 0x11:  /* Turbo Loading Data Block */
+		pilot = get_u16le(&cur_block[1]);
+		sync1 = get_u16le(&cur_block[3]);
+		sync2 = get_u16le(&cur_block[5]);
+		bit0 = get_u16le(&cur_block[7]);
+		bit1 = get_u16le(&cur_block[9]);
+		pilot_length = get_u16le(&cur_block[11]);
+		bits_in_last_byte = cur_block[13];
+		pause_time = get_u16le(&cur_block[14]);
+		data_size = get_u24le(&cur_block[16]);
+		start_standard_block(tapeListener, block_offset + 19, pause_time, data_size, pilot, pilot_length, sync1, sync2, bit0, bit1, bits_in_last_byte);
+		break;
+	case 0x12:  /* Pure Tone */
+		pilot = get_u16le(&cur_block[1]);
+		pilot_length = get_u16le(&cur_block[3]);
+		start_standard_block(tapeListener, block_offset, 0, 0, pilot, pilot_length, 0, 0, 0, 0, 0);
+		break;
+	case 0x13:  /* Sequence of Pulses of Different Lengths */
+		play.offset = block_offset + 2;
+		play.data_size = cur_block[1];
+		play.count = 0;
+		play.phase = PlayPhase::PULSES;
+		break;
+	case 0x14:  /* Pure Data Block */
+		bit0 = get_u16le(&cur_block[1]);
+		bit1 = get_u16le(&cur_block[3]);
+		bits_in_last_byte = cur_block[5];
+		pause_time = get_u16le(&cur_block[6]);
+		data_size = get_u24le(&cur_block[8]);
+		start_standard_block(tapeListener, block_offset + 11, pause_time, data_size, 0, 0, 0, 0, bit0, bit1, bits_in_last_byte);
+		break;
+	case 0x20:  /* Pause (Silence) or 'Stop the Tape' Command */
+		pause_time = get_u16le(&cur_block[1]);
+		if (pause_time == 0)
 		{
-		case 0x10:  /* Standard Speed Data Block (.TAP block) */
-			pause_time = get_u16le(&cur_block[1]);
-			data_size = get_u16le(&cur_block[3]);
-			pilot_length = (cur_block[5] < 128) ?  8063 : 3223;
-			tzx_cas_handle_block(tapeListener, &cur_block[5], pause_time, data_size, 2168, pilot_length, 667, 735, 855, 1710, 8);
-			current_block++;
-			break;
-		case 0x11:  /* Turbo Loading Data Block */
-			pilot = get_u16le(&cur_block[1]);
-			sync1 = get_u16le(&cur_block[3]);
-			sync2 = get_u16le(&cur_block[5]);
-			bit0 = get_u16le(&cur_block[7]);
-			bit1 = get_u16le(&cur_block[9]);
-			pilot_length = get_u16le(&cur_block[11]);
-			bits_in_last_byte = cur_block[13];
-			pause_time = get_u16le(&cur_block[14]);
-			data_size = get_u24le(&cur_block[16]);
-			tzx_cas_handle_block(tapeListener, &cur_block[19], pause_time, data_size, pilot, pilot_length, sync1, sync2, bit0, bit1, bits_in_last_byte);
-			current_block++;
-			break;
-		case 0x12:  /* Pure Tone */
-			pilot = get_u16le(&cur_block[1]);
-			pilot_length = get_u16le(&cur_block[3]);
-			tzx_cas_handle_block(tapeListener, cur_block, 0, 0, pilot, pilot_length, 0, 0, 0, 0, 0);
-			current_block++;
-			break;
-		case 0x13:  /* Sequence of Pulses of Different Lengths */
-			for (data_size = 0; data_size < cur_block[1]; data_size++)
+			if (stops_enabled)
 			{
-				pilot = cur_block[2 + 2 * data_size] + (cur_block[3 + 2 * data_size] << 8);
-				tzx_cas_handle_block(tapeListener, cur_block, 0, 0, pilot, 1, 0, 0, 0, 0, 0);
+				Serial.printf("Stop the tape\n");
+				play.phase = PlayPhase::STOP;
+				break;
 			}
-			current_block++;
-			break;
-		case 0x14:  /* Pure Data Block */
-			bit0 = get_u16le(&cur_block[1]);
-			bit1 = get_u16le(&cur_block[3]);
-			bits_in_last_byte = cur_block[5];
-			pause_time = get_u16le(&cur_block[6]);
-			data_size = get_u24le(&cur_block[8]);
-			tzx_cas_handle_block(tapeListener, &cur_block[11], pause_time, data_size, 0, 0, 0, 0, bit0, bit1, bits_in_last_byte);
-			current_block++;
-			break;
-		case 0x20:  /* Pause (Silence) or 'Stop the Tape' Command */
-			pause_time = get_u16le(&cur_block[1]);
-			if (pause_time == 0)
-			{
-				/* pause = 0 is used to let an emulator automagically stop the tape
-				   in MAME we do not do that, so we insert a 5 second pause. */
-				pause_time = 5000;
+			/* pause = 0 is used to let an emulator automagically stop the tape
+			   in MAME we do not do that, so we insert a 5 second pause. */
+			pause_time = 5000;
+		}
+		start_standard_block(tapeListener, block_offset, pause_time, 0, 0, 0, 0, 0, 0, 0, 0);
+		break;
+	case 0x2A:  /* Stop Tape if in 48K Mode */
+		if (stops_enabled && is_48k)
+		{
+			Serial.printf("Stop the tape in 48K mode\n");
+			play.phase = PlayPhase::STOP;
+		}
+		break;
+	case 0x16:  /* C64 ROM Type Data Block */       // Deprecated in TZX 1.20
+	case 0x17:  /* C64 Turbo Tape Data Block */     // Deprecated in TZX 1.20
+	case 0x34:  /* Emulation Info */                // Deprecated in TZX 1.20
+	case 0x40:  /* Snapshot Block */                // Deprecated in TZX 1.20
+		Serial.printf("Deprecated block type (%02x) encountered.\n", block_type);
+		Serial.printf("Please look for an updated .tzx file.\n");
+		break;
+	case 0x30:  /* Text Description */
+		ascii_block_common_log("Text Description Block", block_type);
+		for (data_size = 0; data_size < cur_block[1]; data_size++)
+			Serial.printf("%c", cur_block[2 + data_size]);
+		Serial.printf("\n");
+		break;
+	case 0x31:  /* Message Block */
+		ascii_block_common_log("Message Block", block_type);
+		Serial.printf("Expected duration of the message display: %02x\n", cur_block[1]);
+		Serial.printf("Message: \n");
+		for (data_size = 0; data_size < cur_block[2]; data_size++)
+		{
+			Serial.printf("%c", cur_block[3 + data_size]);
+			if (cur_block[3 + data_size] == 0x0d)
+				Serial.printf("\n");
+		}
+		Serial.printf("\n");
+		break;
+	case 0x32:  /* Archive Info */
+		ascii_block_common_log("Archive Info Block", block_type);
+		total_size = get_u16le(source->get(block_offset + 1, 2));
+		text_size = 0;
+		for (data_size = 0; data_size < (*source)[block_offset + 3]; data_size++)  // data_size = number of text blocks, in this case
+		{
+			if ((*source)[block_offset + 4 + text_size] < 0x09) {
+				Serial.printf("%s: \n", archive_ident[(*source)[block_offset + 4 + text_size]]);
 			}
-			tzx_cas_handle_block(tapeListener, cur_block, pause_time, 0, 0, 0, 0, 0, 0, 0, 0);
-			current_block++;
-			break;
-		case 0x16:  /* C64 ROM Type Data Block */       // Deprecated in TZX 1.20
-		case 0x17:  /* C64 Turbo Tape Data Block */     // Deprecated in TZX 1.20
-		case 0x34:  /* Emulation Info */                // Deprecated in TZX 1.20
-		case 0x40:  /* Snapshot Block */                // Deprecated in TZX 1.20
-			Serial.printf("Deprecated block type (%02x) encountered.\n", block_type);
-			Serial.printf("Please look for an updated .tzx file.\n");
-			current_block++;
-			break;
-		case 0x30:  /* Text Description */
-			ascii_block_common_log("Text Description Block", block_type);
-			for (data_size = 0; data_size < cur_block[1]; data_size++)
-				Serial.printf("%c", cur_block[2 + data_size]);
-			Serial.printf("\n");
-			current_block++;
-			break;
-		case 0x31:  /* Message Block */
-			ascii_block_common_log("Message Block", block_type);
-			Serial.printf("Expected duration of the message display: %02x\n", cur_block[1]);
-			Serial.printf("Message: \n");
-			for (data_size = 0; data_size < cur_block[2]; data_size++)
-			{
-				Serial.printf("%c", cur_block[3 + data_size]);
-				if (cur_block[3 + data_size] == 0x0d)
-					Serial.printf("\n");
+			else {
+				Serial.printf("Comment(s): \n");
 			}
-			Serial.printf("\n");
-			current_block++;
-			break;
-		case 0x32:  /* Archive Info */
-			ascii_block_common_log("Archive Info Block", block_type);
-			total_size = get_u16le(&cur_block[1]);
-			text_size = 0;
-			for (data_size = 0; data_size < cur_block[3]; data_size++)  // data_size = number of text blocks, in this case
-			{
-				if (cur_block[4 + text_size] < 0x09) {
-					Serial.printf("%s: \n", archive_ident[cur_block[4 + text_size]]);
-				}
-				else {
-					Serial.printf("Comment(s): \n");
-				}
 
-				for (i = 0; i < cur_block[4 + text_size + 1]; i++)
-				{
-					Serial.printf("%c", cur_block[4 + text_size + 2 + i]);
-				}
-				text_size += 2 + i;
-			}
-			Serial.printf("\n");
-			if (text_size != total_size)
-				Serial.printf("Malformed Archive Info Block (Text length different from the declared one).\n Please verify your tape image.\n");
-			current_block++;
-			break;
-		case 0x33:  /* Hardware Type */
-			ascii_block_common_log("Hardware Type Block", block_type);
-			for (data_size = 0; data_size < cur_block[1]; data_size++)  // data_size = number of hardware blocks, in this case
+			for (i = 0; i < (*source)[block_offset + 4 + text_size + 1]; i++)
 			{
-				Serial.printf("Hardware Type %02x - Hardware ID %02x - ", cur_block[2 + data_size * 3], cur_block[2 + data_size * 3 + 1]);
-				Serial.printf("%s \n ", hw_info[cur_block[2 + data_size * 3 + 2]]);
+				Serial.printf("%c", (*source)[block_offset + 4 + text_size + 2 + i]);
 			}
-			current_block++;
-			break;
-		case 0x35:  /* Custom Info Block */
-			ascii_block_common_log("Custom Info Block", block_type);
-			for (data_size = 0; data_size < 10; data_size++)
+			text_size += 2 + i;
+		}
+		Serial.printf("\n");
+		if (text_size != total_size)
+			Serial.printf("Malformed Archive Info Block (Text length different from the declared one).\n Please verify your tape image.\n");
+		break;
+	case 0x33:  /* Hardware Type */
+		ascii_block_common_log("Hardware Type Block", block_type);
+		for (data_size = 0; data_size < (*source)[block_offset + 1]; data_size++)  // data_size = number of hardware blocks, in this case
+		{
+			Serial.printf("Hardware Type %02x - Hardware ID %02x - ", (*source)[block_offset + 2 + data_size * 3], (*source)[block_offset + 2 + data_size * 3 + 1]);
+			Serial.printf("%s \n ", hw_info[(*source)[block_offset + 2 + data_size * 3 + 2]]);
+		}
+		break;
+	case 0x35:  /* Custom Info Block */
+		ascii_block_common_log("Custom Info Block", block_type);
+		for (data_size = 0; data_size < 10; data_size++)
+		{
+			Serial.printf("%c", (*source)[block_offset + 1 + data_size]);
+		}
+		Serial.printf(":\n");
+		text_size = get_u32le(source->get(block_offset + 11, 4));
+		for (data_size = 0; data_size < text_size; data_size++)
+			Serial.printf("%c", (*source)[block_offset + 15 + data_size]);
+		Serial.printf("\n");
+		break;
+	case 0x5A:  /* "Glue" Block */
+		Serial.printf("Glue Block (type %02x) encountered.\n", block_type);
+		Serial.printf("Please use a .tzx handling utility to split the merged tape files.\n");
+		break;
+	case 0x21:  /* Group Start */
+		ascii_block_common_log("Group Start Block", block_type);
+		for (data_size = 0; data_size < cur_block[1]; data_size++)
+			Serial.printf("%c", cur_block[2 + data_size]);
+		Serial.printf("\n");
+		break;
+	case 0x22:  /* Group End */
+		break;
+	case 0x28:  /* Select Block */
+		ascii_block_common_log("Select Block", block_type);
+		text_size = 0;
+		for (data_size = 0; data_size < (*source)[block_offset + 3]; data_size++)  // data_size = number of selections, in this case
+		{
+			Serial.printf("%d: ", (int16_t)get_u16le(source->get(block_offset + 4 + text_size, 2)));
+			for (i = 0; i < (*source)[block_offset + 4 + text_size + 2]; i++)
 			{
-				Serial.printf("%c", cur_block[1 + data_size]);
+				Serial.printf("%c", (*source)[block_offset + 4 + text_size + 3 + i]);
 			}
-			Serial.printf(":\n");
-			text_size = get_u32le(&cur_block[11]);
-			for (data_size = 0; data_size < text_size; data_size++)
-				Serial.printf("%c", cur_block[15 + data_size]);
 			Serial.printf("\n");
-			current_block++;
-			break;
-		case 0x5A:  /* "Glue" Block */
-			Serial.printf("Glue Block (type %02x) encountered.\n", block_type);
-			Serial.printf("Please use a .tzx handling utility to split the merged tape files.\n");
-			current_block++;
-			break;
-		case 0x24:  /* Loop Start */
-			loopcount = get_u16le(&cur_block[1]);
-			current_block++;
-			loopoffset = current_block;
+			text_size += 3 + i;
+		}
+		/* fall through */
+	case 0x23:  /* Jump To Block */
+	case 0x24:  /* Loop Start */
+	case 0x25:  /* Loop End */
+	case 0x26:  /* Call Sequence */
+	case 0x27:  /* Return From Sequence */
+		play.current_block = follow_control_block(play.current_block - 1, play.control);
+		Serial.printf("control block %02x - next block is %d\n", block_type, play.current_block);
+		break;
+	case 0x2B:  /* Set Signal Level */
+		play.level = cur_block[5] ? PULSE_HIGH : PULSE_LOW;
+		play.phase = PlayPhase::LEVEL;
+		break;
 
-			Serial.printf("loop start %d %d\n",  loopcount, current_block);
-			break;
-		case 0x25:  /* Loop End */
-			if (loopcount>0)
-			{
-				current_block = loopoffset;
-				loopcount--;
-				Serial.printf("do loop\n");
-			}
-			else
-			{
-				current_block++;
-			}
-			break;
+	default:
+		Serial.printf("Unsupported block type (%02x) encountered.\n", block_type);
+		break;
 
-		case 0x21:  /* Group Start */
-		case 0x22:  /* Group End */
-		case 0x23:  /* Jump To Block */
-		case 0x26:  /* Call Sequence */
-		case 0x27:  /* Return From Sequence */
-		case 0x28:  /* Select Block */
-		case 0x2A:  /* Stop Tape if in 48K Mode */
-		case 0x2B:  /* Set signal level */
-		default:
-			Serial.printf("Unsupported block type (%02x) encountered.\n", block_type);
-			current_block++;
-			break;
+	case 0x15:  /* Direct Recording */ // used on 'bombscar' in the cpc_cass list
+		// having this missing is fatal
+		play.tstates = get_u16le(&cur_block[1]);
+		play.pause = get_u16le(&cur_block[3]);
+		play.bits_in_last_byte = cur_block[5];
+		play.data_size = get_u24le(&cur_block[6]);
+		play.offset = block_offset + 9;
+		play.count = 0;
+		play.phase = PlayPhase::DIRECT;
+		Serial.printf("tzx_handle_direct: loading %d bytes\n", play.data_size);
+		break;
 
-		case 0x15:  /* Direct Recording */ // used on 'bombscar' in the cpc_cass list
-			// having this missing is fatal
-			tstates = get_u16le(&cur_block[1]);
-			pause_time = get_u16le(&cur_block[3]);
-			bits_in_last_byte = cur_block[5];
-			data_size = get_u24le(&cur_block[6]);
-			tzx_handle_direct(tapeListener, &cur_block[9], pause_time, data_size, tstates, bits_in_last_byte);
-			current_block++;
+	case 0x18:  /* CSW Recording */
+		play.pause = get_u16le(&cur_block[5]);
+		play.csw_end = block_offset + 5 + get_u32le(&cur_block[1]);
+		play.csw_rate = get_u24le(&cur_block[7]);
+		play.data_size = get_u32le(&cur_block[11]);
+		play.offset = block_offset + 15;
+		if (cur_block[10] != 0x01 || play.csw_rate == 0)
+		{
+			// Z-RLE recordings need zlib - play the pause so the blocks after it still line up
+			Serial.printf("Unsupported CSW compression (%02x) encountered.\n", cur_block[10]);
+			start_pause(play.pause);
 			break;
+		}
+		Serial.printf("tzx_handle_csw: %d pulses at %d Hz\n", play.data_size, play.csw_rate);
+		play.csw_remainder = 0;
+		play.count = 0;
+		play.phase = PlayPhase::CSW;
+		break;
 
-		case 0x18:  /* CSW Recording */
-			// having this missing is fatal
-			Serial.printf("Unsupported block type (0x15 - CSW Recording) encountered.\n");
-			current_block++;
-			break;
+	case 0x19:  /* Generalized Data Block */
+		// having this missing is fatal
+		// used crudely by batmanc in spectrum_cass list (which is just a redundant encoding of batmane ?)
+		play.pause = get_u16le(&cur_block[5]);
 
-		case 0x19:  /* Generalized Data Block */
-			{
-				// having this missing is fatal
-				// used crudely by batmanc in spectrum_cass list (which is just a redundant encoding of batmane ?)
-				data_size = get_u32le(&cur_block[1]);
-				pause_time = get_u16le(&cur_block[5]);
+		play.totp = get_u32le(&cur_block[7]);
+		play.npp = cur_block[11];
+		play.asp = cur_block[12];
+		if (play.asp == 0 && play.totp > 0) play.asp = 256;
 
-				uint32_t totp = get_u32le(&cur_block[7]);
-				int npp = cur_block[11];
-				int asp = cur_block[12];
-				if (asp == 0 && totp > 0) asp = 256;
+		play.totd = get_u32le(&cur_block[13]);
+		play.npd = cur_block[17];
+		play.asd = cur_block[18];
+		if (play.asd == 0 && play.totd > 0) play.asd = 256;
 
-				uint32_t totd = get_u32le(&cur_block[13]);
-				int npd = cur_block[17];
-				int asd = cur_block[18];
-				if (asd == 0 && totd > 0) asd = 256;
+		play.offset = block_offset + 19;
+		play.symbol = -1;
+		if (play.totp > 0)
+		{
+		//  Serial.printf("pilot block table %04x\n", totp);
+			read_symbol_table(play.symbols, play.offset, play.npp, play.asp);
+			play.stream = play.offset + (2 * play.npp + 1) * play.asp;
+			play.repetitions = 0;
+			play.count = 0;
+			play.phase = PlayPhase::SYMBOL_PILOT;
+		}
+		else
+		{
+			start_symbol_data();
+		}
+		break;
+	}
+}
 
-				tzx_handle_generalized(tapeListener, &cur_block[19], pause_time, totp, npp, asp, totd, npd, asd);
+void TzxCas::rewind()
+{
+	play = PlayState();
+	play.phase = is_tap ? PlayPhase::NEXT_BLOCK : PlayPhase::START;
+}
 
-				current_block++;
-			}
+int TzxCas::next_pulses(TapeListener *tapeListener, uint32_t *pulses, int max_pulses)
+{
+	int count = 0;
+	TapePulse pulse;
+	// only offer a block at the start of a batch - otherwise the listener would see the offer before it
+	// has played the end of the last block
+	hold_offers = false;
+	while (count < max_pulses && next_pulse(tapeListener, pulse))
+	{
+		hold_offers = true;
+		if (count > 0 && PULSE_LEVEL(pulses[count - 1]) == PULSE_KEEP && PULSE_TICKS(pulses[count - 1]) + pulse.ticks <= PULSE_TICKS_MASK)
+		{
+			// the last pulse didn't do anything to the level so this one can just carry on from it
+			pulses[count - 1] = PACK_PULSE(PULSE_TICKS(pulses[count - 1]) + pulse.ticks, pulse.level);
+		}
+		else
+		{
+			pulses[count++] = PACK_PULSE(pulse.ticks, pulse.level);
+		}
+		if (pulse.level == PULSE_STOP || (play.phase == PlayPhase::PILOT && play.flash_loadable))
+		{
 			break;
-
 		}
 	}
-	// Adding 1 ms. pause to ensure that the last edge is properly finished at the end of tape
-	tapeListener->pause1Millis();
+	hold_offers = false;
+	return count;
 }
 
-bool TzxCas::load_tzx(TapeListener *listener, uint8_t *casdata, int caslen)
+void TzxCas::tzx_cas_do_work(TapeListener *tapeListener)
 {
+	uint32_t pulses[TAPE_PULSE_BATCH];
+	rewind();
+	int count;
+	while ((count = next_pulses(tapeListener, pulses, TAPE_PULSE_BATCH)) > 0)
+	{
+		tapeListener->playPulses(pulses, count);
+	}
+}
+
+bool TzxCas::index_tzx(TapeSource *tapeSource)
+{
+	source = tapeSource;
+	is_tap = false;
 	/* Header size plus major and minor version number */
-	if (caslen < 10)
+	if (source->size() < 10)
 	{
 		Serial.printf("tzx_cas_to_wav_size: cassette image too small\n");
 		return false;
 	}
 
 	/* Check for correct header */
-	if (memcmp(casdata, TZX_HEADER, sizeof(TZX_HEADER)))
+	const uint8_t *header = source->get(0, 10);
+	if (memcmp(header, TZX_HEADER, sizeof(TZX_HEADER)))
 	{
 		Serial.printf("tzx_cas_to_wav_size: cassette image has incompatible header\n");
 		return false;
 	}
 
 	/* Check major version number in header */
-	if (casdata[0x08] > SUPPORTED_VERSION_MAJOR)
+	if (header[0x08] > SUPPORTED_VERSION_MAJOR)
 	{
 		Serial.printf("tzx_cas_to_wav_size: unsupported version\n");
 		return false;
 	}
-	tzx_cas_get_blocks(casdata, caslen);
-	Serial.printf("tzx_cas_to_wav_size: %d blocks found\n", block_count);
-	if (block_count == 0)
+	tzx_cas_get_blocks();
+	Serial.printf("tzx_cas_to_wav_size: %d blocks found\n", (int)block_index.size());
+	if (block_index.empty())
 	{
 		Serial.printf("tzx_cas_to_wav_size: no blocks found!\n");
 		return false;
 	}
-	tzx_cas_do_work(listener);
+	tzx_cas_sum_ticks();
 	return true;
 }
 
-bool TzxCas::load_tap(TapeListener *tapeListener, uint8_t *casdata, int caslen)
+bool TzxCas::index_tap(TapeSource *tapeSource)
 {
-	const uint8_t *p = casdata;
+	uint32_t pos = 0;
 
-	while (p < casdata + caslen)
+	source = tapeSource;
+	is_tap = true;
+	block_index.clear();
+	total_ticks = 0;
+	while (pos + 2 < source->size())
 	{
-		int data_size = get_u16le(&p[0]);
-		int pilot_length = (p[2] == 0x00) ? 8063 : 3223;
-		Serial.printf("tap_cas_fill_wave: Handling TAP block containing 0x%X bytes\n", data_size);
-		p += 2;
-		tzx_cas_handle_block(tapeListener, p, 1000, data_size, 2168, pilot_length, 667, 735, 855, 1710, 8);
-		p += data_size;
+		int data_size = get_u16le(source->get(pos, 2));
+		int pilot_length = ((*source)[pos + 2] == 0x00) ? 8063 : 3223;
+		uint64_t ticks = 2168 * pilot_length + 667 + 735 + data_ticks(pos + 2, data_size, 855, 1710, 8) + 1000 * MILLI_SECOND;
+		block_index.push_back({0x10, pos, ticks});
+		total_ticks += ticks;
+		pos += 2 + data_size;
+	}
+	return true;
+}
+
+bool TzxCas::load_tzx(TapeListener *listener, TapeSource *tapeSource)
+{
+	// always index it again - a source at the same address could be a different tape
+	if (!index_tzx(tapeSource))
+	{
+		return false;
 	}
+	tzx_cas_do_work(listener);
+	return true;
+}
+
+bool TzxCas::load_tap(TapeListener *tapeListener, TapeSource *tapeSource)
+{
+	index_tap(tapeSource);
+	tzx_cas_do_work(tapeListener);
 	return true;
 }
 
+void TzxCas::forget_source()
+{
+	source = nullptr;
+	block_index.clear();
+	total_ticks = 0;
+}
+
+bool TzxCas::load_tzx(TapeListener *tapeListener, uint8_t *casdata, int caslen)
+{
+	TapeSource tapeSource(casdata, caslen);
+	bool loaded = load_tzx(tapeListener, &tapeSource);
+	forget_source();
+	return loaded;
+}
+
+bool TzxCas::load_tap(TapeListener *tapeListener, uint8_t *casdata, int caslen)
+{
+	TapeSource tapeSource(casdata, caslen);
+	bool loaded = load_tap(tapeListener, &tapeSource);
+	forget_source();
+	return loaded;
+}
@@ -9,13 +9,22 @@
 #include <string_view>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "TapeListener.h"
+#include "TapeSource.h"
 
 #define SUPPORTED_VERSION_MAJOR 0x01
 
-#define INITIAL_MAX_BLOCK_COUNT 256
-#define BLOCK_COUNT_INCREMENTS 256
+// enough to cover the fixed part of any block
+#define TZX_BLOCK_HEADER_SIZE 0x200
+
+// how many packed pulses we hand to a listener in one go
+#define TAPE_PULSE_BATCH 256
+
+// a tape can jump back on itself forever so we stop following blocks after this many when working out
+// how long it is
+#define TZX_MAX_BLOCK_STEPS (1 << 22)
 
 enum class error
 {
@@ -27,10 +36,130 @@ enum class error
 	READ_WRITE_UNSUPPORTED // read/write is not supported by this image format
 };
 
+// What we know about a block without having to play it
+struct TapeBlockInfo
+{
+	uint8_t type;
+	// offset of the block in the tape file
+	uint32_t offset;
+	// how long the block takes to play in T-states, including any pause after it
+	uint64_t ticks;
+};
+
+// One step of the tape signal - hold the current level for ticks T-states and then change it. Pulses are
+// never longer than PULSE_TICKS_MASK.
+struct TapePulse
+{
+	uint32_t ticks;
+	TapePulseLevel level;
+};
+
+// Where we are in the block that is being played
+enum class PlayPhase
+{
+	START,
+	NEXT_BLOCK,
+	PILOT,
+	SYNC1,
+	SYNC2,
+	DATA,
+	PULSES,
+	DIRECT,
+	SYMBOL_PILOT,
+	SYMBOL_DATA,
+	CSW,
+	LEVEL,
+	PAUSE,
+	STOP,
+	END_OF_TAPE,
+	FINISHED
+};
+
+// Where loops and call sequences go back to
+struct ControlState
+{
+	int loop_count = 0;
+	int loop_block = 0;
+	// the call sequence block we're in and which of its calls we're playing - -1 if we aren't in one
+	int call_block = -1;
+	int call_index = 0;
+};
+
+// The symbol definitions of a generalized data block unpacked so that each pulse is a lookup
+struct SymbolTable
+{
+	int max_pulses = 0;
+	// how each symbol sets the level and how many pulses it has - undefined symbols have no pulses
+	uint8_t polarity[256] = {};
+	uint8_t pulse_count[256] = {};
+	// max_pulses pulse lengths for each symbol
+	std::vector<uint16_t> pulses;
+};
+
+// Reads the symbols of a generalized data stream, most significant bit first. The bits are kept in a
+// 32 bit buffer that is topped up from the tape so most symbols only need a shift.
+struct SymbolStream
+{
+	uint32_t offset = 0;
+	uint32_t buffer = 0;
+	int buffered = 0;
+};
+
+// Everything we need to carry on playing the tape from where we left off
+struct PlayState
+{
+	PlayPhase phase = PlayPhase::FINISHED;
+	int current_block = 0;
+	ControlState control;
+	// the block that is playing
+	uint32_t offset = 0;
+	uint32_t data_size = 0;
+	int pilot = 0, pilot_length = 0, sync1 = 0, sync2 = 0;
+	int bit0 = 0, bit1 = 0, bits_in_last_byte = 0;
+	int pause = 0;
+	int tstates = 0;
+	bool flash_loadable = false;
+	// has the block been offered to the listener yet
+	bool offered = false;
+	// how far through the current phase we are
+	uint32_t count = 0;
+	int bit = 0;
+	bool second_half = false;
+	// generalized data blocks
+	uint32_t totp = 0, totd = 0;
+	int npp = 0, asp = 0, npd = 0, asd = 0;
+	// the symbol definitions in use, where the pilot RLE table is and the data stream
+	SymbolTable symbols;
+	uint32_t stream = 0;
+	SymbolStream data_stream;
+	int symbol_bits = 0;
+	uint8_t current_symbol = 0;
+	uint32_t repetitions = 0;
+	// the symbol that is playing (-1 if there isn't one) and the next pulse in it - -1 if we haven't set
+	// the starting level yet
+	int symbol = -1;
+	int symbol_pulse = -1;
+	// CSW recordings - where the data ends, the sample rate and the part of a T-state left over from
+	// the last pulse
+	uint32_t csw_end = 0;
+	uint32_t csw_rate = 0;
+	uint32_t csw_remainder = 0;
+	// set signal level blocks
+	TapePulseLevel level = PULSE_KEEP;
+};
+
 class TzxCas
 {
-	int block_count = 0;
-	uint8_t **blocks = nullptr;
+	TapeSource *source = nullptr;
+	std::vector<TapeBlockInfo> block_index;
+	uint64_t total_ticks = 0;
+	bool is_tap = false;
+	PlayState play;
+	// stop the tape at 'stop the tape' blocks instead of playing them as a pause
+	bool stops_enabled = false;
+	bool is_48k = false;
+	// don't offer a block to the listener until the pulses before it have been played
+	bool hold_offers = false;
 
 	constexpr uint16_t get_u16le(uint8_t const *buf) noexcept
 	{
@@ -53,83 +182,94 @@ class TzxCas
 	{
 		return std::make_signed_t<T>(value << (8 * sizeof(value) - width)) >> (8 * sizeof(value) - width);
 	}
-	void toggle_wave_data(TapeListener *tapeListener);
-	void tzx_cas_get_blocks(const uint8_t *casdata, int caslen);
-	void tzx_cas_handle_block(TapeListener *tapeListener, const uint8_t *bytes, int pause, int data_size, int pilot, int pilot_length, int sync1, int sync2, int bit0, int bit1, int bits_in_last_byte);
-	void tzx_handle_direct(TapeListener *tapeListener, const uint8_t *bytes, int pause, int data_size, int tstates, int bits_in_last_byte);
-	inline void tzx_handle_symbol(TapeListener *tapeListener, const uint8_t *symtable, uint8_t symbol, int maxp)
+	void tzx_cas_get_blocks();
+	// set up the play state for the block at play.current_block
+	void start_block(TapeListener *tapeListener);
+	void start_standard_block(TapeListener *tapeListener, uint32_t offset, int pause, int data_size, int pilot, int pilot_length, int sync1, int sync2, int bit0, int bit1, int bits_in_last_byte, bool flash_loadable = false);
+	void start_pause(int pause);
+	void start_symbol_data();
+	// the next pulse of the generalized symbol that is playing - returns false once it has finished
+	bool next_symbol_pulse(TapePulse &pulse);
+	inline int read_symbol(SymbolStream &stream, int bits)
 	{
-		const uint8_t *cursymb = symtable + (2 * maxp + 1) * symbol;
-
-		uint8_t starttype = cursymb[0];
-
-		switch (starttype)
+		if (bits == 0)
 		{
-		case 0x00:
-			// pulse level has already been toggled so don't change
-			break;
-
-		case 0x01:
-			// pulse level has already been toggled so revert
-			tapeListener->toggleMicLevel();
-			break;
-
-		case 0x02:
-			// force low
-			tapeListener->setMicLow();
-			break;
-
-		case 0x03:
-			// force high
-			tapeListener->setMicHigh();
-			break;
-
-		default:
-			printf("SYMDEF invalid - bad starting polarity");
-		};
-
-		for (int i = 0; i < maxp; i++)
+			return 0;
+		}
+		if (stream.buffered < bits)
 		{
-			uint16_t pulse_length = get_u16le(&cursymb[1 + (i * 2)]);
-
-			// shorter lists can be terminated with a pulse_length of 0
-			if (pulse_length != 0)
-			{
-				tapeListener->runForTicks(pulse_length);
-				tapeListener->toggleMicLevel();
-			}
-			else
+			// fill up the buffer a byte at a time - a symbol is never more than 8 bits so this is
+			// only needed every few symbols
+			while (stream.buffered <= 24)
 			{
-				break;
+				stream.buffer |= (uint32_t)(*source)[stream.offset++] << (24 - stream.buffered);
+				stream.buffered += 8;
 			}
 		}
-	};
-
-	inline int stream_get_bit(const uint8_t *bytes, uint8_t &stream_bit, uint32_t &stream_byte)
+		int symbol = stream.buffer >> (32 - bits);
+		stream.buffer <<= bits;
+		stream.buffered -= bits;
+		return symbol;
+	}
+	// how long a CSW pulse of samples is in T-states - remainder carries the part of a T-state that is
+	// left over on to the next pulse
+	inline uint32_t csw_pulse_ticks(uint32_t samples, uint32_t rate, uint32_t &remainder)
 	{
-		// get bit here
-		uint8_t retbit = 0;
-
-		uint8_t byte = bytes[stream_byte];
-		byte = byte << stream_bit;
-
-		if (byte & 0x80)
-			retbit = 1;
-
-		stream_bit++;
-
-		if (stream_bit == 8)
-		{
-			stream_bit = 0;
-			stream_byte++;
-		}
-
-		return retbit;
-	};
-	void tzx_handle_generalized(TapeListener *tapeListener, const uint8_t *bytes, int pause, uint32_t totp, int npp, int asp, uint32_t totd, int npd, int asd);
+		uint64_t total = (uint64_t)samples * CPU_FREQ + remainder;
+		uint64_t ticks = total / rate;
+		remainder = total % rate;
+		return ticks > PULSE_TICKS_MASK ? PULSE_TICKS_MASK : ticks;
+	}
+	// jump, loop, call sequence and select blocks - returns the block to play after the control block
+	int follow_control_block(int block, ControlState &state);
 	void ascii_block_common_log(const char *block_type_string, uint8_t block_type);
 	void tzx_cas_do_work(TapeListener *tapeListener);
+	// block durations worked out from the block headers and data rather than by playing the pulses
+	uint64_t tzx_block_ticks(uint32_t offset);
+	uint64_t data_ticks(uint32_t offset, int data_size, int bit0, int bit1, int bits_in_last_byte);
+	uint64_t symbol_ticks(const SymbolTable &table, int symbol);
+	uint64_t generalized_ticks(uint32_t offset, uint32_t totp, int npp, int asp, uint32_t totd, int npd, int asd);
+	uint64_t csw_ticks(uint32_t offset, uint32_t end, uint32_t pulses, uint32_t rate);
+	// symbol definitions are copied out of the tape so they stay put while we read the data stream
+	void read_symbol_table(SymbolTable &table, uint32_t offset, int maxp, int count);
+	void tzx_cas_sum_ticks();
+	int generalized_symbol_bits(int asd);
 public:
+	// find the blocks in the tape and work out how long each one is - load_tzx and load_tap do this for you.
+	// The source must stay around while the tape is being played.
+	bool index_tzx(TapeSource *tapeSource);
+	bool index_tap(TapeSource *tapeSource);
+	// call this before the source is deleted so nothing is read from it afterwards
+	void forget_source();
+	const std::vector<TapeBlockInfo> &get_index()
+	{
+		return block_index;
+	}
+	// how long the whole tape takes to play in T-states
+	uint64_t get_total_ticks()
+	{
+		return total_ticks;
+	}
+	// Play the tape a pulse at a time - call rewind after indexing the tape and then next_pulse until it
+	// returns false. The listener is only used to offer standard speed blocks for flash loading.
+	void rewind();
+	bool next_pulse(TapeListener *tapeListener, TapePulse &pulse);
+	// Fill pulses with up to max_pulses packed pulses and return how many there are - 0 at the end of the
+	// tape. Runs of pulses that don't change the level are merged together. A batch ends early on a stop
+	// and on the pilot of a block that has been offered for flash loading as the listener has to play
+	// it before we know if the block has been loaded.
+	int next_pulses(TapeListener *tapeListener, uint32_t *pulses, int max_pulses);
+	// stop at 'stop the tape' blocks (and 'stop the tape if in 48K mode' blocks on a 48K machine)
+	// rather than playing them as a pause
+	void set_stops(bool enabled, bool is_48k)
+	{
+		stops_enabled = enabled;
+		this->is_48k = is_48k;
+	}
+	// play the whole tape to the listener
+	bool load_tzx(TapeListener *tapeListener, TapeSource *tapeSource);
+	bool load_tap(TapeListener *tapeListener, TapeSource *tapeSource);
+	// play a tape that is already in memory
 	bool load_tzx(TapeListener *tapeListener, uint8_t *casdata, int caslen);
 	bool load_tap(TapeListener *tapeListener, uint8_t *casdata, int caslen);
 };
\ No newline at end of file
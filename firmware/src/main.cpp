@@ -198,6 +198,10 @@ void setup(void)
   {
     Serial.println("Failed to create /snapshots directory");
   }
+  if (!files->createDirectory("/cache"))
+  {
+    Serial.println("Failed to create /cache directory");
+  }
   MainMenuScreen menuPicker(*tft, hdmiDisplay, audioOutput, files);
   navigationStack->push(&menuPicker);
   // start off the keyboard and feed keys into the active scene